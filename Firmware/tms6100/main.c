@@ -42,6 +42,7 @@
 //
 // PHROM_ACORN - The Acorn Speech System PHROM data
 // PHROM_US - The TI American speech PHROM data
+// PHROM_CUSTOM - romdata_custom.h as written by phromtool build
 //
 #ifdef PHROM_ACORN
 	// Acorn PHROM data
@@ -51,6 +52,10 @@
 	// TI US PHROM data
 	#pragma message ("Using American TI Speech System PHROM data")
 	#include "romdata_us.h"
+#elif PHROM_CUSTOM
+	// PHROM data built by phromtool
+	#pragma message ("Using custom PHROM data (romdata_custom.h)")
+	#include "romdata_custom.h"
 #else
 	// No PHROM was defined (or an unknown PHROM)
 	#pragma message ("Using Acorn Speech System PHROM data (default)")
@@ -87,11 +87,11 @@
 	167        EFD     ANSWER
 	168        F72     ANY
 	169        FCF     AVAILABLE
-	170        065     B,BEE,BE
+	170        1065    B,BEE,BE
 	171        10BD    BAD
-	172        13B     BETWEEN
-	173        1B1     BOTH
-	174        1F8     BUTTON
+	172        113B    BETWEEN
+	173        11B1    BOTH
+	174        11F8    BUTTON
 	175        124D    C,SEE,SEA
 	176        12B1    CASSETTE
 	177        1326    CHARACTER
@@ -116,7 +116,7 @@
 	196        1A5D    FEW
 	197        1AAB    FILE
 	198        1B1E    FIRST
-	199        1896    FOUND
+	199        1B96    FOUND
 	200        1C11    FROM
 	201        1C6B    G
 	202        1CC9    GOOD
@@ -189,7 +189,7 @@
 	269        377E    THIRD
 	270        3808    THIS
 	271        3874    TIME
-	272        3800    TRY
+	272        38E2    TRY
 	273        3953    TWELVE
 	274        39D2    TYPE
 	275        3A21    U,YOU
@@ -0,0 +1,180 @@
+/************************************************************************
+	batchrender.c
+
+    Parallel rendering of every word in a PHROM image
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "batchrender.h"
+#include "lpcframe.h"
+#include "lpcrender.h"
+#include "lpcsynth.h"
+#include "wavfile.h"
+
+// With lanes each task renders this many words per lane, so the lanes
+// stay busy as words of different lengths finish
+#define BATCHRENDER_LANE_WORDS	4
+
+// Rendering of a slice of the word list; each task owns its slice so no
+// locking is needed
+typedef struct {
+	const phromImage_t *image;
+	const lpcSettings_t *settings;
+	int lanes;
+	int sliceWords;
+	int16_t **samples;
+	uint32_t *lengths;
+} batchRenderWords_t;
+
+// Build "NNN_WORD.wav" keeping only characters that are safe in file names
+static void wordFileName(char *name, size_t size, const char *directory, const phromWord_t *word)
+{
+	char text[64];
+	size_t length = 0;
+	
+	for (const char *p = word->word; *p && length < sizeof(text) - 1; p++) {
+		if (isalnum((unsigned char)*p)) text[length++] = *p;
+		else if (length > 0 && text[length - 1] != '_') text[length++] = '_';
+	}
+	while (length > 0 && text[length - 1] == '_') length--;
+	text[length] = '\0';
+	
+	snprintf(name, size, "%s/%03u_%s.wav", directory, word->number, text);
+}
+
+static void renderSlice(int slice, void *argument)
+{
+	batchRenderWords_t *render = argument;
+	const phromImage_t *image = render->image;
+	int first = slice * render->sliceWords;
+	int count = image->wordCount - first < render->sliceWords ? image->wordCount - first : render->sliceWords;
+	lpcLaneJob_t jobs[16 * BATCHRENDER_LANE_WORDS];
+	lpcFrame_t frames[LPC_MAX_WORD_FRAMES];
+	int jobCount = 0;
+	
+	// The frames are parsed into a scratch buffer and kept at their exact size
+	for (int i = first; i < first + count; i++) {
+		int frameCount = lpcParse(render->settings, image, image->words[i].address, frames, LPC_MAX_WORD_FRAMES, NULL);
+		if (frameCount < 0) continue;
+		
+		lpcFrame_t *kept = malloc(frameCount * sizeof(lpcFrame_t));
+		render->samples[i] = malloc(frameCount * lpcFrameSamples(render->settings) * sizeof(int16_t));
+		if (kept == NULL || render->samples[i] == NULL) {
+			free(kept);
+			free(render->samples[i]);
+			render->samples[i] = NULL;
+			continue;
+		}
+		memcpy(kept, frames, frameCount * sizeof(lpcFrame_t));
+		
+		jobs[jobCount].frames = kept;
+		jobs[jobCount].frameCount = frameCount;
+		jobs[jobCount].output = render->samples[i];
+		jobCount++;
+		render->lengths[i] = frameCount * lpcFrameSamples(render->settings);
+	}
+	
+	if (jobCount > 0) lpcRenderWords(render->settings, render->lanes, jobs, jobCount);
+	for (int i = 0; i < jobCount; i++) free((void *)jobs[i].frames);
+}
+
+// Render every listed word of an image into malloc'd buffers
+int batchRenderWords(const phromImage_t *image, const lpcSettings_t *settings, int lanes,
+	threadPool_t *pool, int16_t **samples, uint32_t *lengths)
+{
+	batchRenderWords_t render = { image, settings, lanes, lanes ? lanes * BATCHRENDER_LANE_WORDS : 1, samples, lengths };
+	if (lanes && !lpcLanesSupported(settings, lanes)) return -1;
+	
+	for (int i = 0; i < image->wordCount; i++) {
+		samples[i] = NULL;
+		lengths[i] = 0;
+	}
+	
+	int slices = (image->wordCount + render.sliceWords - 1) / render.sliceWords;
+	threadPoolParallelFor(pool, slices, renderSlice, &render);
+	return 0;
+}
+
+// Render every listed word of an image into directory
+int batchRenderImage(const phromImage_t *image, const char *directory, const lpcSettings_t *settings,
+	int lanes, threadPool_t *pool, batchRenderStats_t *stats)
+{
+	struct timespec start, end;
+	char name[1024];
+	int result = 0;
+	
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	
+	int16_t **samples = calloc(image->wordCount ? image->wordCount : 1, sizeof(int16_t *));
+	uint32_t *lengths = calloc(image->wordCount ? image->wordCount : 1, sizeof(uint32_t));
+	if (samples == NULL || lengths == NULL || batchRenderWords(image, settings, lanes, pool, samples, lengths) != 0) {
+		free(samples);
+		free(lengths);
+		return -1;
+	}
+	
+	// Write the words, and concatenate them into the sample bank (in list
+	// order)
+	snprintf(name, sizeof(name), "%s/bank.wav", directory);
+	FILE *bank = wavOpen(name, LPC_SAMPLE_RATE);
+	snprintf(name, sizeof(name), "%s/bank.txt", directory);
+	FILE *index = fopen(name, "w");
+	if (bank == NULL || index == NULL) result = -1;
+	
+	stats->words = stats->failures = 0;
+	stats->samples = 0;
+	
+	for (int i = 0; i < image->wordCount; i++) {
+		const phromWord_t *word = &image->words[i];
+		
+		wordFileName(name, sizeof(name), directory, word);
+		if (samples[i] == NULL || wavWriteFile(name, samples[i], lengths[i], LPC_SAMPLE_RATE) != 0) {
+			stats->failures++;
+		} else {
+			if (bank && index) {
+				fprintf(index, "%-8u %04X  %-9ld %-6u %s\n", word->number, word->address,
+					stats->samples, lengths[i], word->word);
+				if (wavWrite(bank, samples[i], lengths[i]) != 0) result = -1;
+			}
+			stats->words++;
+			stats->samples += lengths[i];
+		}
+		
+		free(samples[i]);
+	}
+	
+	if (bank && wavClose(bank) != 0) result = -1;
+	if (index && fclose(index) != 0) result = -1;
+	free(samples);
+	free(lengths);
+	
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	stats->seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	
+	return (result == 0 && stats->failures == 0) ? 0 : -1;
+}
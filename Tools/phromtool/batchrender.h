@@ -0,0 +1,57 @@
+/************************************************************************
+	batchrender.h
+
+    Parallel rendering of every word in a PHROM image
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef BATCHRENDER_H_
+#define BATCHRENDER_H_
+
+#include "lpcrender.h"
+#include "phromimage.h"
+#include "threadpool.h"
+
+typedef struct {
+	int words;			// Words rendered
+	int failures;		// Words that did not parse or could not be written
+	long samples;		// Total samples rendered
+	double seconds;		// Wall-clock time taken
+} batchRenderStats_t;
+
+// Render every listed word of an image into malloc'd buffers (samples[i]
+// stays NULL, and lengths[i] 0, for a word that cannot be rendered), one
+// word per task, or with lanes (4, 8 or 16) several words per task through
+// the lane renderer; the PCM is the same either way (see lpcRenderWords())
+// Returns 0, or -1 if the lanes cannot render the settings
+int batchRenderWords(const phromImage_t *image, const lpcSettings_t *settings, int lanes,
+	threadPool_t *pool, int16_t **samples, uint32_t *lengths);
+
+// Render every listed word of an image into directory as one WAV file per
+// word (NNN_WORD.wav) plus bank.wav (all words concatenated in list order)
+// and bank.txt (the sample offset and length of each word within bank.wav),
+// parsed and rendered with the given settings (and lanes, as above)
+// Returns 0 on success or -1 if anything failed
+int batchRenderImage(const phromImage_t *image, const char *directory, const lpcSettings_t *settings,
+	int lanes, threadPool_t *pool, batchRenderStats_t *stats);
+
+#endif /* BATCHRENDER_H_ */
@@ -0,0 +1,145 @@
+/************************************************************************
+	bitreader.h
+
+    Buffered bit reader for PHROM serial data
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef BITREADER_H_
+#define BITREADER_H_
+
+#include <stdint.h>
+#include <string.h>
+
+// The TMS6100 shifts each byte out LSB first and the VSP assembles each
+// field MSB first from the serial stream.  Rather than following that bit
+// by bit the reader keeps a 64-bit register holding the stream with the
+// next serial bit at bit 63, so a field of any width up to 32 bits is a
+// single shift.  The register is refilled with one unaligned 64-bit load.
+
+typedef struct {
+	const uint8_t *data;
+	uint32_t size;			// Size of the data in bytes
+	uint32_t bitPointer;	// Serial bit position of the next field
+	uint64_t buffer;		// Serial bits from bitPointer (next bit at bit 63)
+	uint32_t bufferBits;	// Number of valid bits in the buffer
+} bitReader_t;
+
+// Reverse the bit order of a 64-bit value
+static inline uint64_t bitReaderReverse64(uint64_t value)
+{
+	value = ((value >> 1) & 0x5555555555555555ULL) | ((value & 0x5555555555555555ULL) << 1);
+	value = ((value >> 2) & 0x3333333333333333ULL) | ((value & 0x3333333333333333ULL) << 2);
+	value = ((value >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((value & 0x0F0F0F0F0F0F0F0FULL) << 4);
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	// On a big-endian host the bytes are already in serial order
+	return value;
+#else
+	value = ((value >> 8) & 0x00FF00FF00FF00FFULL) | ((value & 0x00FF00FF00FF00FFULL) << 8);
+	value = ((value >> 16) & 0x0000FFFF0000FFFFULL) | ((value & 0x0000FFFF0000FFFFULL) << 16);
+	return (value >> 32) | (value << 32);
+#endif
+}
+
+// Load 8 bytes from bytePointer in serial order (bytes past the end read as 0)
+static inline uint64_t bitReaderLoad(const bitReader_t *reader, uint32_t bytePointer)
+{
+	uint64_t value = 0;
+	
+	if (bytePointer + 8 <= reader->size) {
+		memcpy(&value, reader->data + bytePointer, 8);
+	} else if (bytePointer < reader->size) {
+		memcpy(&value, reader->data + bytePointer, reader->size - bytePointer);
+	}
+	
+	return bitReaderReverse64(value);
+}
+
+// Refill the register from the current bit position (leaves at least 57 bits)
+static inline void bitReaderRefill(bitReader_t *reader)
+{
+	uint32_t shift = reader->bitPointer & 7;
+	reader->buffer = bitReaderLoad(reader, reader->bitPointer >> 3) << shift;
+	reader->bufferBits = 64 - shift;
+}
+
+// Position the reader at a bit offset
+static inline void bitReaderSeek(bitReader_t *reader, uint32_t bitPointer)
+{
+	reader->bitPointer = bitPointer;
+	bitReaderRefill(reader);
+}
+
+static inline void bitReaderInitialise(bitReader_t *reader, const uint8_t *data, uint32_t size, uint32_t bitPointer)
+{
+	reader->data = data;
+	reader->size = size;
+	bitReaderSeek(reader, bitPointer);
+}
+
+// Make sure at least count (up to 57) bits are buffered
+static inline void bitReaderEnsure(bitReader_t *reader, uint32_t count)
+{
+	if (reader->bufferBits < count) bitReaderRefill(reader);
+}
+
+// Return the next count (1-32) bits without consuming them
+// Note: the caller must have ensured the bits are buffered
+static inline uint32_t bitReaderPeek(const bitReader_t *reader, uint32_t count)
+{
+	return (uint32_t)(reader->buffer >> (64 - count));
+}
+
+// Consume count (0-57) buffered bits
+static inline void bitReaderSkip(bitReader_t *reader, uint32_t count)
+{
+	// Shift in two steps so a count of 0 (or 64) is well defined
+	reader->buffer = (reader->buffer << (count >> 1)) << (count - (count >> 1));
+	reader->bufferBits -= count;
+	reader->bitPointer += count;
+}
+
+// Read a count (1-32) bit field
+static inline uint32_t bitReaderRead(bitReader_t *reader, uint32_t count)
+{
+	bitReaderEnsure(reader, count);
+	uint32_t value = bitReaderPeek(reader, count);
+	bitReaderSkip(reader, count);
+	return value;
+}
+
+// Append count serial bits (MSB aligned in bits) to the register of a
+// reader its caller feeds rather than loading from data; there must be
+// room for them
+static inline void bitReaderAppend(bitReader_t *reader, uint64_t bits, uint32_t count)
+{
+	reader->buffer |= bits >> reader->bufferBits;
+	reader->bufferBits += count;
+}
+
+// Return the serial bit position of the next field
+static inline uint32_t bitReaderTell(const bitReader_t *reader)
+{
+	return reader->bitPointer;
+}
+
+#endif /* BITREADER_H_ */
@@ -0,0 +1,195 @@
+/************************************************************************
+	bustrace.c
+
+    Speech reconstruction from captured TMS6100 bus traces
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bustrace.h"
+#include "lpcstream.h"
+#include "lpcsynth.h"
+#include "wavfile.h"
+
+const busTraceChannels_t busTraceDefaultChannels = { 0, 1, 2, 3, 4, 5 };
+
+// Capture read size
+#define BUSTRACE_BLOCK	(1 << 20)
+
+typedef struct {
+	const busTraceChannels_t *channels;
+	const phromImage_t *image;
+	const lpcSettings_t *settings;
+	FILE *wav;
+	busTraceCallback_t callback;
+	void *argument;
+	busTraceStats_t *stats;
+	
+	uint32_t address;			// Address register (as the PHROM keeps it)
+	uint8_t ready;				// The ready pulse has been seen since the last load
+	uint8_t add8;				// ADD8 while M0 was last high
+	uint8_t active;				// An utterance is in progress
+	busTraceUtterance_t utterance;
+	lpcStream_t stream;
+	int16_t pcm[LPC_MAX_FRAME_SAMPLES];
+	int result;
+} busTraceDecoder_t;
+
+static void endUtterance(busTraceDecoder_t *decoder)
+{
+	if (!decoder->active) return;
+	decoder->active = 0;
+	decoder->utterance.frames = decoder->stream.frames;
+	decoder->utterance.complete = decoder->stream.stopped;
+	decoder->stats->utterances++;
+	if (decoder->callback) decoder->callback(&decoder->utterance, decoder->argument);
+}
+
+// Play whatever PCM the stream has ready
+static void drainStream(busTraceDecoder_t *decoder)
+{
+	int count;
+	while ((count = lpcStreamRead(&decoder->stream, decoder->pcm, LPC_MAX_FRAME_SAMPLES)) > 0) {
+		decoder->utterance.samples += count;
+		decoder->stats->pcmSamples += count;
+		if (decoder->wav && wavWrite(decoder->wav, decoder->pcm, count) != 0) decoder->result = -1;
+	}
+}
+
+// A data bit read on the falling edge of M0
+static void dataBit(busTraceDecoder_t *decoder, uint64_t sampleOffset, int bit)
+{
+	decoder->stats->reads++;
+	
+	if (!decoder->active) {
+		memset(&decoder->utterance, 0, sizeof(busTraceUtterance_t));
+		decoder->utterance.sampleOffset = sampleOffset;
+		decoder->utterance.address = decoder->address;
+		lpcStreamInitialise(&decoder->stream, decoder->settings);
+		decoder->active = 1;
+	}
+	
+	// Check the bit against the image when the read is from its bank
+	busTraceUtterance_t *utterance = &decoder->utterance;
+	uint32_t bitAddress = (utterance->address & 0x3FFF) * 8 + utterance->bits;
+	if (decoder->image && ((utterance->address >> 14) & 0xF) == decoder->image->bank && bitAddress < PHROM_SIZE * 8) {
+		if (((decoder->image->data[bitAddress / 8] >> (bitAddress % 8)) & 1) != bit) utterance->mismatchedBits++;
+	}
+	utterance->bits++;
+	
+	// The VSP reads on past the stop frame; those bits are not speech
+	if (!decoder->stream.stopped) {
+		lpcStreamWriteBit(&decoder->stream, bit);
+		drainStream(decoder);
+	}
+}
+
+// Handle the edges between two successive samples
+static void busEdges(busTraceDecoder_t *decoder, uint64_t sampleOffset, uint8_t previous, uint8_t sample)
+{
+	const busTraceChannels_t *channels = decoder->channels;
+	uint8_t m0 = (sample >> channels->m0) & 1, m1 = (sample >> channels->m1) & 1;
+	uint8_t wasM0 = (previous >> channels->m0) & 1, wasM1 = (previous >> channels->m1) & 1;
+	
+	if (m1 && !wasM1) {
+		// LOAD ADDRESS: a new address ends the current utterance
+		uint32_t nibble = ((sample >> channels->add1) & 1) | ((sample >> channels->add2) & 1) << 1 |
+			((sample >> channels->add4) & 1) << 2 | ((sample >> channels->add8) & 1) << 3;
+		endUtterance(decoder);
+		decoder->address = (decoder->address >> 4) | (nibble << 16);
+		decoder->ready = 0;
+		decoder->stats->loads++;
+	}
+	
+	if (m0 && !wasM0) {
+		// The ready pulse (ready 2 until it falls) carries no data
+		if (!decoder->ready) decoder->ready = 2;
+	} else if (!m0 && wasM0) {
+		if (decoder->ready == 2) decoder->ready = 1;
+		else if (decoder->ready) dataBit(decoder, sampleOffset, decoder->add8);
+	}
+	
+	if (m0) decoder->add8 = (sample >> channels->add8) & 1;
+}
+
+// Decode a capture
+int busTraceDecode(FILE *capture, const busTraceChannels_t *channels, const phromImage_t *image,
+	const lpcSettings_t *settings, FILE *wav, busTraceCallback_t callback, void *argument,
+	busTraceStats_t *stats)
+{
+	busTraceDecoder_t *decoder = calloc(1, sizeof(busTraceDecoder_t));
+	uint8_t *block = malloc(BUSTRACE_BLOCK);
+	if (decoder == NULL || block == NULL) {
+		free(decoder);
+		free(block);
+		return -1;
+	}
+	
+	memset(stats, 0, sizeof(busTraceStats_t));
+	decoder->channels = channels;
+	decoder->image = image;
+	decoder->settings = settings;
+	decoder->wav = wav;
+	decoder->callback = callback;
+	decoder->argument = argument;
+	decoder->stats = stats;
+	
+	// Only edges of M0 and M1 matter; runs of samples where neither
+	// changes are skipped eight at a time
+	const uint8_t mask = (1 << channels->m0) | (1 << channels->m1);
+	const uint64_t maskLanes = mask * 0x0101010101010101ULL;
+	uint8_t previous = 0;
+	uint64_t offset = 0;
+	size_t length;
+	
+	while ((length = fread(block, 1, BUSTRACE_BLOCK, capture)) > 0) {
+		size_t i = 0;
+		while (i < length) {
+			uint64_t lanes;
+			if (i + 8 <= length) {
+				memcpy(&lanes, block + i, 8);
+				if (((lanes ^ ((previous & mask) * 0x0101010101010101ULL)) & maskLanes) == 0) {
+					// ADD8 may still change while M0 is high
+					if (previous & (1 << channels->m0)) decoder->add8 = (block[i + 7] >> channels->add8) & 1;
+					previous = block[i + 7];
+					i += 8;
+					continue;
+				}
+			}
+			
+			if ((block[i] ^ previous) & mask) busEdges(decoder, offset + i, previous, block[i]);
+			else if (block[i] & (1 << channels->m0)) decoder->add8 = (block[i] >> channels->add8) & 1;
+			previous = block[i++];
+		}
+		offset += length;
+	}
+	
+	endUtterance(decoder);
+	stats->samples = offset;
+	int result = ferror(capture) ? -1 : decoder->result;
+	
+	free(block);
+	free(decoder);
+	return result;
+}
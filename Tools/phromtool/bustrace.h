@@ -0,0 +1,87 @@
+/************************************************************************
+	bustrace.h
+
+    Speech reconstruction from captured TMS6100 bus traces
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef BUSTRACE_H_
+#define BUSTRACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "lpcrender.h"
+#include "phromimage.h"
+
+// A capture is a stream of logic analyser samples, one byte per sample,
+// with each bus signal on one bit (the raw binary output of most logic
+// analysers).  The decoder follows the firmware's view of the bus:
+//
+//   M1 rising edge	LOAD ADDRESS - ADD1-ADD8 hold the next address nibble
+//					(least significant first, 5 nibbles per address)
+//   M0 rising edge	The first after a load is the "ready" pulse; the rest
+//					are data reads, ADD8 holding the next bit (LSB first)
+//					until M0 falls
+//
+// The bits read after each load form one utterance, which is played
+// through lpcstream.c as the bits arrive.  Only the decoder state and one
+// frame of PCM are held, so captures of any length take constant memory.
+
+// Bit positions of the signals within each sample byte
+typedef struct {
+	uint8_t m0, m1;
+	uint8_t add1, add2, add4, add8;
+} busTraceChannels_t;
+
+// The default mapping (M0, M1, ADD1, ADD2, ADD4, ADD8 on bits 0-5)
+extern const busTraceChannels_t busTraceDefaultChannels;
+
+// One utterance (the reads following a LOAD ADDRESS)
+typedef struct {
+	uint64_t sampleOffset;		// Capture sample of the first data read
+	uint32_t address;			// 20-bit address loaded (bank in bits 14-17)
+	uint32_t bits;				// Data bits read
+	uint32_t frames;			// Frames decoded (up to the stop frame)
+	uint32_t samples;			// PCM samples produced
+	uint32_t mismatchedBits;	// Bits differing from the image (if its bank)
+	uint8_t complete;			// The stop frame was reached
+} busTraceUtterance_t;
+
+typedef struct {
+	uint64_t samples;			// Capture samples processed
+	uint64_t loads;				// LOAD ADDRESS nibbles
+	uint64_t reads;				// Data bits read
+	uint64_t utterances;
+	uint64_t pcmSamples;
+} busTraceStats_t;
+
+typedef void (*busTraceCallback_t)(const busTraceUtterance_t *utterance, void *argument);
+
+// Decode a capture, appending the speech to wav (if not NULL) and calling
+// callback (if not NULL) as each utterance ends.  image is used to check
+// the bits read from its bank.  Returns 0 or -1 on a read error.
+int busTraceDecode(FILE *capture, const busTraceChannels_t *channels, const phromImage_t *image,
+	const lpcSettings_t *settings, FILE *wav, busTraceCallback_t callback, void *argument,
+	busTraceStats_t *stats);
+
+#endif /* BUSTRACE_H_ */
@@ -0,0 +1,285 @@
+/************************************************************************
+	corpus.c
+
+    Vocabulary encoding from a manifest of recordings
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "corpus.h"
+#include "lpcencode.h"
+#include "lpcframe.h"
+#include "lpcsynth.h"
+#include "phromimage.h"
+#include "resampler.h"
+#include "wavfile.h"
+
+// Load a manifest of recordings
+int corpusLoadManifest(corpus_t *corpus, const char *path, const lpcEncodeSettings_t *settings)
+{
+	FILE *file = fopen(path, "r");
+	if (file == NULL) return -1;
+	
+	// Recordings are relative to the manifest's directory
+	const char *slash = strrchr(path, '/');
+	int directoryLength = slash ? (int)(slash - path) + 1 : 0;
+	
+	corpusWord_t *words = NULL;
+	int wordCount = 0, capacity = 0;
+	char line[512], recording[256];
+	
+	while (fgets(line, sizeof(line), file)) {
+		unsigned number;
+		int textStart;
+		
+		if (sscanf(line, " %u %255s %n", &number, recording, &textStart) != 2) continue;
+		if (number > 0xFFFF || line[textStart] == '\0') continue;
+		
+		// Trim the trailing white space from the word text
+		char *text = line + textStart;
+		size_t length = strlen(text);
+		while (length > 0 && (text[length - 1] == '\n' || text[length - 1] == '\r' ||
+			text[length - 1] == ' ' || text[length - 1] == '\t')) length--;
+		if (length == 0) continue;
+		
+		if (wordCount == capacity) {
+			int larger = capacity ? capacity * 2 : 256;
+			corpusWord_t *grown = realloc(words, larger * sizeof(corpusWord_t));
+			if (grown == NULL) goto failed;
+			words = grown;
+			capacity = larger;
+		}
+		
+		corpusWord_t *word = &words[wordCount++];
+		memset(word, 0, sizeof(corpusWord_t));
+		word->number = number;
+		word->word = malloc(length + 1);
+		if (word->word == NULL) goto failed;
+		memcpy(word->word, text, length);
+		word->word[length] = '\0';
+		
+		int prefix = (recording[0] == '/') ? 0 : directoryLength;
+		word->path = malloc(prefix + strlen(recording) + 1);
+		if (word->path == NULL) goto failed;
+		memcpy(word->path, path, prefix);
+		strcpy(word->path + prefix, recording);
+	}
+	fclose(file);
+	
+	corpus->words = words;
+	corpus->wordCount = wordCount;
+	corpus->settings = *settings;
+	return wordCount;
+	
+failed:
+	// Out of memory: free the partial list
+	fclose(file);
+	corpus->words = words;
+	corpus->wordCount = wordCount;
+	corpusFree(corpus);
+	return -1;
+}
+
+void corpusFree(corpus_t *corpus)
+{
+	for (int i = 0; i < corpus->wordCount; i++) {
+		free(corpus->words[i].word);
+		free(corpus->words[i].path);
+		free(corpus->words[i].data);
+	}
+	free(corpus->words);
+	corpus->words = NULL;
+	corpus->wordCount = 0;
+}
+
+// Read a recording at 8KHz
+int corpusReadRecording(const char *path, int16_t **pcm)
+{
+	uint32_t sampleCount, rate;
+	
+	if (wavReadFile(path, pcm, &sampleCount, &rate) != 0) return -1;
+	if (rate == LPC_SAMPLE_RATE) return (int)sampleCount;
+	
+	resampler_t *resampler = resamplerCreate(rate, LPC_SAMPLE_RATE, RESAMPLER_BEST);
+	int16_t *resampled = resampler ? malloc((resamplerMaxOutput(resampler, sampleCount) + resamplerFlushOutput(resampler)) * sizeof(int16_t)) : NULL;
+	if (resampled == NULL) {
+		if (resampler) resamplerDestroy(resampler);
+		free(*pcm);
+		return -1;
+	}
+	
+	// Drop the filter's delay so the frames line up with the recording
+	int count = resamplerProcess(resampler, *pcm, sampleCount, resampled);
+	count += resamplerFlush(resampler, resampled + count);
+	int delay = (int)((uint64_t)resamplerDelay(resampler) * LPC_SAMPLE_RATE / rate);
+	if (delay > count) delay = count;
+	memmove(resampled, resampled + delay, (count - delay) * sizeof(int16_t));
+	
+	resamplerDestroy(resampler);
+	free(*pcm);
+	*pcm = resampled;
+	return count - delay;
+}
+
+// 64-bit FNV-1a hash, continued from hash
+static uint64_t hashBytes(uint64_t hash, const void *data, size_t size)
+{
+	const uint8_t *bytes = data;
+	
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001B3ULL;
+	}
+	
+	return hash;
+}
+
+// The cache key of a recording's samples
+static uint64_t recordingKey(const int16_t *pcm, int sampleCount, const lpcEncodeSettings_t *settings)
+{
+	uint32_t version[2] = { lpcEncodeSettingsKey(settings), LPC_ENCODE_VERSION };
+	uint64_t hash = hashBytes(0xCBF29CE484222325ULL, version, sizeof(version));
+	return hashBytes(hash, pcm, sampleCount * sizeof(int16_t));
+}
+
+// Parse packed frames into the word (which checks a cache entry is whole)
+static int parsePacked(corpusWord_t *word, int chip, uint8_t *data, uint32_t size)
+{
+	static __thread lpcFrame_t frames[LPC_MAX_WORD_FRAMES];
+	uint32_t endBit;
+	
+	int frameCount = lpcParseFrames(chip, data, size, 0, NULL, frames, NULL, LPC_MAX_WORD_FRAMES, &endBit);
+	if (frameCount < 0 || (endBit + 7) / 8 != size) return -1;
+	
+	word->data = realloc(data, size);
+	word->bits = endBit;
+	word->frameCount = frameCount;
+	return 0;
+}
+
+// Take a word from the cache
+static int readCache(corpusWord_t *word, int chip, const char *name)
+{
+	FILE *file = fopen(name, "rb");
+	if (file == NULL) return -1;
+	
+	uint8_t *data = malloc(PHROM_SIZE);
+	size_t size = data ? fread(data, 1, PHROM_SIZE, file) : 0;
+	fclose(file);
+	
+	if (size == 0 || parsePacked(word, chip, data, size) != 0) {
+		free(data);
+		return -1;
+	}
+	return 0;
+}
+
+// Add a word to the cache (written aside and renamed into place, so a
+// concurrent or interrupted run never sees part of an entry)
+static void writeCache(const corpusWord_t *word, const char *name, int index)
+{
+	char temporary[1024 + 32];
+	uint32_t size = (word->bits + 7) / 8;
+	
+	snprintf(temporary, sizeof(temporary), "%s.%ld.%d.tmp", name, (long)getpid(), index);
+	FILE *file = fopen(temporary, "wb");
+	if (file == NULL) return;
+	
+	int written = (fwrite(word->data, 1, size, file) == size);
+	if (fclose(file) == 0 && written && rename(temporary, name) == 0) return;
+	remove(temporary);
+}
+
+typedef struct {
+	corpus_t *corpus;
+	const char *cacheDirectory;
+} corpusJob_t;
+
+// Encode one word (or take it from the cache)
+static void encodeWord(int index, void *argument)
+{
+	static __thread lpcFrame_t frames[LPC_MAX_WORD_FRAMES];
+	corpusJob_t *job = argument;
+	corpusWord_t *word = &job->corpus->words[index];
+	const lpcEncodeSettings_t *settings = &job->corpus->settings;
+	int chip = settings->chip;
+	lpcEncodeStats_t stats;
+	char name[1024];
+	int16_t *pcm;
+	
+	free(word->data);
+	word->data = NULL;
+	word->cached = word->failed = 0;
+	word->plainBits = 0;
+	
+	int sampleCount = corpusReadRecording(word->path, &pcm);
+	if (sampleCount < 0) {
+		word->failed = 1;
+		return;
+	}
+	
+	word->key = recordingKey(pcm, sampleCount, settings);
+	if (job->cacheDirectory) {
+		snprintf(name, sizeof(name), "%s/%016llx.lpc", job->cacheDirectory, (unsigned long long)word->key);
+		if (readCache(word, chip, name) == 0) {
+			word->cached = 1;
+			free(pcm);
+			return;
+		}
+	}
+	
+	int frameCount = lpcEncode(settings, pcm, sampleCount, NULL, frames, LPC_MAX_WORD_FRAMES, settings->optimise ? &stats : NULL);
+	free(pcm);
+	
+	uint8_t *data = calloc(PHROM_SIZE, 1);
+	uint32_t endBit;
+	if (frameCount < 0 || data == NULL || lpcPackFrames(chip, frames, frameCount, data, PHROM_SIZE, 0, &endBit) != 0) {
+		free(data);
+		word->failed = 1;
+		return;
+	}
+	
+	word->data = realloc(data, (endBit + 7) / 8);
+	word->bits = endBit;
+	word->frameCount = frameCount;
+	word->plainBits = settings->optimise ? stats.plainBits : endBit;
+	if (job->cacheDirectory) writeCache(word, name, index);
+}
+
+// Encode a corpus
+int corpusEncode(corpus_t *corpus, threadPool_t *pool, const char *cacheDirectory)
+{
+	corpusJob_t job = { corpus, cacheDirectory };
+	int failures = 0;
+	
+	if (cacheDirectory && mkdir(cacheDirectory, 0777) != 0 && errno != EEXIST) job.cacheDirectory = NULL;
+	threadPoolParallelFor(pool, corpus->wordCount, encodeWord, &job);
+	
+	for (int i = 0; i < corpus->wordCount; i++) failures += corpus->words[i].failed;
+	return failures;
+}
@@ -0,0 +1,78 @@
+/************************************************************************
+	corpus.h
+
+    Vocabulary encoding from a manifest of recordings
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef CORPUS_H_
+#define CORPUS_H_
+
+#include <stdint.h>
+
+#include "lpcencode.h"
+#include "threadpool.h"
+
+// A manifest lists one word per line as "number recording word", where
+// the recording is a WAV file (relative to the manifest's directory) and
+// the word is the rest of the line; other lines are ignored.
+//
+// Encoded words are cached as packed frames in a directory, one file per
+// key.  The key hashes the recording's samples with the encoder settings
+// and LPC_ENCODE_VERSION, so only recordings that
+// have changed since the last run, or a change of settings, cause words
+// to be encoded again.
+
+typedef struct {
+	uint16_t number;
+	char *word;				// Word text
+	char *path;				// Recording
+	uint64_t key;			// Cache key (0 until the recording is read)
+	uint8_t *data;			// Packed frames, ending with the stop frame
+	uint32_t bits;			// Length of the frames in bits
+	int frameCount;
+	uint32_t plainBits;		// Bits of the plain encoding (if encoded this run)
+	uint8_t cached;			// Taken from the cache rather than encoded
+	uint8_t failed;			// The recording could not be read or encoded
+} corpusWord_t;
+
+typedef struct {
+	corpusWord_t *words;
+	int wordCount;
+	lpcEncodeSettings_t settings;
+} corpus_t;
+
+// Load a manifest (returns the number of words or -1 on failure)
+int corpusLoadManifest(corpus_t *corpus, const char *path, const lpcEncodeSettings_t *settings);
+void corpusFree(corpus_t *corpus);
+
+// Read a recording as 8KHz PCM (resampled if need be) into a malloc()ed
+// buffer; returns the sample count or -1 on failure
+int corpusReadRecording(const char *path, int16_t **pcm);
+
+// Encode every word across the pool, taking words whose recordings are
+// unchanged from the cache directory (NULL for none; it is created if
+// need be) and adding newly encoded words to it.  Returns the number of
+// words that failed.
+int corpusEncode(corpus_t *corpus, threadPool_t *pool, const char *cacheDirectory);
+
+#endif /* CORPUS_H_ */
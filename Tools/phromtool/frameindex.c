@@ -0,0 +1,121 @@
+/************************************************************************
+	frameindex.c
+
+    Per-word LPC frame index for seeking within words
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "frameindex.h"
+
+// Build the index of an image's listed words
+int frameIndexBuild(frameIndex_t *index, const phromImage_t *image, int chip)
+{
+	lpcFrame_t *frames = malloc(LPC_MAX_WORD_FRAMES * sizeof(lpcFrame_t));
+	uint32_t *frameBits = malloc(LPC_MAX_WORD_FRAMES * sizeof(uint32_t));
+	uint32_t capacity = 4096;
+	
+	index->image = image;
+	index->chip = chip;
+	index->entries = malloc(capacity * sizeof(frameIndexEntry_t));
+	index->entryCount = 0;
+	index->firstEntry = calloc(image->wordCount + 1, sizeof(uint32_t));
+	index->wordCount = image->wordCount;
+	
+	if (frames == NULL || frameBits == NULL || index->entries == NULL || index->firstEntry == NULL) {
+		free(frames);
+		free(frameBits);
+		frameIndexFree(index);
+		return -1;
+	}
+	
+	for (int i = 0; i < image->wordCount; i++) {
+		index->firstEntry[i] = index->entryCount;
+		
+		int frameCount = lpcParseFrames(chip, image->data, PHROM_SIZE, image->words[i].address * 8, NULL,
+			frames, frameBits, LPC_MAX_WORD_FRAMES, NULL);
+		if (frameCount < 1) continue;
+		
+		if (index->entryCount + frameCount > capacity) {
+			while (index->entryCount + frameCount > capacity) capacity *= 2;
+			frameIndexEntry_t *grown = realloc(index->entries, capacity * sizeof(frameIndexEntry_t));
+			if (grown == NULL) {
+				free(frames);
+				free(frameBits);
+				frameIndexFree(index);
+				return -1;
+			}
+			index->entries = grown;
+		}
+		
+		// Every parsed frame carries the K in force after it, so the K
+		// before a frame is the previous frame's
+		frameIndexEntry_t *entry = &index->entries[index->entryCount];
+		for (int f = 0; f < frameCount; f++, entry++) {
+			entry->bit = frameBits[f];
+			if (f == 0) memset(entry->previousK, 0, 10);
+			else memcpy(entry->previousK, frames[f - 1].k, 10);
+		}
+		index->entryCount += frameCount;
+	}
+	index->firstEntry[image->wordCount] = index->entryCount;
+	
+	free(frames);
+	free(frameBits);
+	return 0;
+}
+
+void frameIndexFree(frameIndex_t *index)
+{
+	free(index->entries);
+	free(index->firstEntry);
+	index->entries = NULL;
+	index->firstEntry = NULL;
+	index->entryCount = 0;
+	index->wordCount = 0;
+}
+
+// Frames of a listed word
+int frameIndexFrameCount(const frameIndex_t *index, int word)
+{
+	if (word < 0 || word >= index->wordCount) return 0;
+	return index->firstEntry[word + 1] - index->firstEntry[word];
+}
+
+// Entry for frame of word
+const frameIndexEntry_t *frameIndexSeek(const frameIndex_t *index, int word, int frame)
+{
+	if (frame < 0 || frame >= frameIndexFrameCount(index, word)) return NULL;
+	return &index->entries[index->firstEntry[word] + frame];
+}
+
+// Parse a word from frame to its stop frame
+int frameIndexParse(const frameIndex_t *index, int word, int frame, lpcFrame_t *frames, int maxFrames)
+{
+	const frameIndexEntry_t *entry = frameIndexSeek(index, word, frame);
+	if (entry == NULL) return LPC_PARSE_OVERRUN;
+	
+	return lpcParseFrames(index->chip, index->image->data, PHROM_SIZE, entry->bit, entry->previousK,
+		frames, NULL, maxFrames, NULL);
+}
@@ -0,0 +1,71 @@
+/************************************************************************
+	frameindex.h
+
+    Per-word LPC frame index for seeking within words
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef FRAMEINDEX_H_
+#define FRAMEINDEX_H_
+
+#include <stdint.h>
+
+#include "lpcframe.h"
+#include "phromimage.h"
+
+// LPC frames are variable length, so finding frame N of a word otherwise
+// means parsing every frame before it.  The index is built once per image
+// and records where each frame of each listed word starts together with the
+// K in force before it (a repeat frame takes the K of the frame before), so
+// parsing - and so synthesis - can start at any frame in constant time.
+
+typedef struct {
+	uint32_t bit;				// Serial bit offset of the frame in the image
+	uint8_t previousK[10];		// K indexes in force before the frame
+} frameIndexEntry_t;
+
+typedef struct {
+	const phromImage_t *image;
+	int chip;					// LPC_CHIP_ frame format
+	frameIndexEntry_t *entries;	// Every frame of every word (stop frames included)
+	uint32_t entryCount;
+	uint32_t *firstEntry;		// Per listed word, plus one past the last
+	int wordCount;
+} frameIndex_t;
+
+// Build and free the index of an image's listed words (words that do not
+// parse have no frames).  Returns 0 or -1 if out of memory.
+int frameIndexBuild(frameIndex_t *index, const phromImage_t *image, int chip);
+void frameIndexFree(frameIndex_t *index);
+
+// Frames of a listed word (by its position in the word list), stop frame
+// included
+int frameIndexFrameCount(const frameIndex_t *index, int word);
+
+// Entry for frame of word (NULL if out of range)
+const frameIndexEntry_t *frameIndexSeek(const frameIndex_t *index, int word, int frame);
+
+// Parse a word from frame to its stop frame; returns the number of frames
+// or a LPC_PARSE_ error (LPC_PARSE_OVERRUN if out of range)
+int frameIndexParse(const frameIndex_t *index, int word, int frame, lpcFrame_t *frames, int maxFrames);
+
+#endif /* FRAMEINDEX_H_ */
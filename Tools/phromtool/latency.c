@@ -0,0 +1,69 @@
+/************************************************************************
+	latency.c
+
+    Latency recording and percentiles
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "latency.h"
+
+void latencyReset(latencyRecorder_t *recorder)
+{
+	recorder->count = 0;
+	recorder->maximum = 0;
+}
+
+void latencyRecord(latencyRecorder_t *recorder, double microseconds)
+{
+	recorder->samples[recorder->count % LATENCY_SAMPLES] = microseconds;
+	recorder->count++;
+	if (microseconds > recorder->maximum) recorder->maximum = microseconds;
+}
+
+static int compareDoubles(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+// The p'th percentile (nearest rank) of the retained measurements
+double latencyPercentile(const latencyRecorder_t *recorder, double p)
+{
+	uint32_t count = recorder->count < LATENCY_SAMPLES ? recorder->count : LATENCY_SAMPLES;
+	if (count == 0) return 0;
+	
+	double *sorted = malloc(count * sizeof(double));
+	if (sorted == NULL) return 0;
+	memcpy(sorted, recorder->samples, count * sizeof(double));
+	qsort(sorted, count, sizeof(double), compareDoubles);
+	
+	uint32_t rank = (uint32_t)(p / 100.0 * count + 0.999999);
+	if (rank < 1) rank = 1;
+	if (rank > count) rank = count;
+	double result = sorted[rank - 1];
+	
+	free(sorted);
+	return result;
+}
@@ -0,0 +1,49 @@
+/************************************************************************
+	latency.h
+
+    Latency recording and percentiles
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <stdint.h>
+
+// Keeps the most recent LATENCY_SAMPLES measurements; percentiles are
+// taken over those (older ones are overwritten).  Not thread-safe.
+#define LATENCY_SAMPLES		65536
+
+typedef struct {
+	double samples[LATENCY_SAMPLES];
+	uint64_t count;			// Total recorded (including overwritten)
+	double maximum;
+} latencyRecorder_t;
+
+void latencyReset(latencyRecorder_t *recorder);
+void latencyRecord(latencyRecorder_t *recorder, double microseconds);
+
+// The p'th percentile (0 to 100) of the retained measurements, or 0 if
+// nothing has been recorded
+double latencyPercentile(const latencyRecorder_t *recorder, double p);
+
+#endif /* LATENCY_H_ */
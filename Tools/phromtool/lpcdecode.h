@@ -0,0 +1,98 @@
+/************************************************************************
+	lpcdecode.h
+
+    Per-frame LPC decoder shared by the parser and the stream
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef LPCDECODE_H_
+#define LPCDECODE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include "bitreader.h"
+#include "lpcframe.h"
+#include "lpctables.h"
+
+// The frame grammar (see lpcframe.h) in one place.  The decoder works on
+// the bits already in a bitReader_t's register and never refills it: the
+// parser buffers LPC_MAX_FRAME_BITS before each frame, and the stream
+// fills the register itself as bytes or bits arrive.  It is always
+// inlined so that, given one of the chip descriptors, the field widths
+// are constants.
+
+// The longest frame (a voiced frame) in bits
+#define LPC_MAX_FRAME_BITS	50
+
+// Take a field from the buffered bits
+static inline uint8_t lpcDecodeField(bitReader_t *reader, uint32_t count)
+{
+	uint8_t value = bitReaderPeek(reader, count);
+	bitReaderSkip(reader, count);
+	return value;
+}
+
+// Decode the frame at the reader's position.  available is the number of
+// buffered bits that hold data; if the frame runs past them nothing is
+// consumed and FALSE is returned.  previousK is the K in force before the
+// frame and is updated by it.
+static inline __attribute__((always_inline)) int lpcDecodeFrame(const lpcChip_t *chip,
+	bitReader_t *reader, uint32_t available, uint8_t *previousK, lpcFrame_t *frame)
+{
+	// Fields are taken from a copy so an incomplete frame leaves the
+	// reader as it was (bits past available read as zero)
+	bitReader_t fields = *reader;
+	int newK = 0;
+	if (available < 4) return 0;
+	
+	frame->energy = lpcDecodeField(&fields, 4);
+	frame->repeat = 0;
+	frame->pitch = 0;
+	
+	if (frame->energy == LPC_ENERGY_STOP || frame->energy == LPC_ENERGY_SILENT) {
+		// Stop and silent frames carry no further fields
+		frame->type = (frame->energy == LPC_ENERGY_STOP) ? LPC_FRAME_STOP : LPC_FRAME_SILENT;
+		memcpy(frame->k, previousK, 10);
+	} else {
+		frame->repeat = lpcDecodeField(&fields, 1);
+		frame->pitch = lpcDecodeField(&fields, chip->pitchBits);
+		frame->type = frame->pitch ? LPC_FRAME_VOICED : LPC_FRAME_UNVOICED;
+		
+		if (frame->repeat) {
+			memcpy(frame->k, previousK, 10);
+		} else {
+			// Unvoiced frames only carry K1-K4
+			int kCount = (frame->type == LPC_FRAME_VOICED) ? 10 : 4;
+			for (int i = 0; i < kCount; i++) frame->k[i] = lpcDecodeField(&fields, chip->kBits[i]);
+			for (int i = kCount; i < 10; i++) frame->k[i] = 0;
+			newK = 1;
+		}
+	}
+	
+	if (bitReaderTell(&fields) - bitReaderTell(reader) > available) return 0;
+	if (newK) memcpy(previousK, frame->k, 10);
+	*reader = fields;
+	return 1;
+}
+
+#endif /* LPCDECODE_H_ */
@@ -0,0 +1,768 @@
+/************************************************************************
+	lpcencode.c
+
+    LPC encoder (PCM to TMS5220 frames)
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+// Note: The window and autocorrelation work on 4-lane float vectors (GCC
+// vector extensions, so SSE, NEON or scalar code as the target allows);
+// the pitch comes from pitchtrack.c.  The Levinson-Durbin recursion is
+// tenth order and serial, so it stays in scalar double precision; it is
+// a small fraction of the work per frame.
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lpcencode.h"
+#include "pitchtrack.h"
+#include "lpcsynth.h"
+#include "lpctables.h"
+
+// M_PI is POSIX rather than C99
+#define PI	3.14159265358979323846
+
+// Analysis window (40ms), centred on the end of the frame where the
+// synthesiser reaches the frame's targets
+#define WINDOW_SAMPLES	320
+#define WINDOW_OFFSET	(LPC_FRAME_SAMPLES - WINDOW_SAMPLES / 2)
+
+// Autocorrelation lags computed: 0-10 for the LPC and 11 for the
+// pre-emphasis, which is a whole number of vectors
+#define LAGS			12
+
+// Voiced frames are analysed pre-emphasised, as the chirp excitation
+// already has the glottal pulse's falling spectrum
+#define PRE_EMPHASIS	0.9375
+
+// Frames are silent when quieter than this fraction of the loudest frame
+#define SILENCE_GATE		0.01f
+
+#define VECTOR_LANES	4
+typedef float vector_t __attribute__((vector_size(VECTOR_LANES * sizeof(float))));
+
+// Unaligned vector load and store
+static inline vector_t loadVector(const float *source)
+{
+	vector_t value;
+	memcpy(&value, source, sizeof(value));
+	return value;
+}
+
+static inline void storeVector(float *destination, vector_t value)
+{
+	memcpy(destination, &value, sizeof(value));
+}
+
+// The Hamming window, its power and the lag window
+static float hamming[WINDOW_SAMPLES];
+static double windowPower;
+static double lagWindow[LAGS];
+static pthread_once_t windowOnce = PTHREAD_ONCE_INIT;
+
+static void windowInitialise(void)
+{
+	windowPower = 0;
+	for (int n = 0; n < WINDOW_SAMPLES; n++) {
+		hamming[n] = (float)(0.54 - 0.46 * cos(2.0 * PI * n / (WINDOW_SAMPLES - 1)));
+		windowPower += hamming[n] * hamming[n];
+	}
+	
+	// A Gaussian lag window widens each formant by about 60Hz so that sharp
+	// resonances stay stable once their coefficients are quantised
+	for (int lag = 0; lag < LAGS; lag++) {
+		double x = 2.0 * PI * 60.0 * lag / LPC_SAMPLE_RATE;
+		lagWindow[lag] = exp(-0.5 * x * x);
+	}
+}
+
+// Window a segment and find its autocorrelation at lags 0-11.  All the
+// lags are summed at once: each sample multiplies the three vectors of
+// samples starting at it.
+static void autocorrelate(const float *segment, double *r)
+{
+	float windowed[WINDOW_SAMPLES + LAGS];
+	vector_t sum[LAGS / VECTOR_LANES] = { { 0 } };
+	
+	for (int n = 0; n < WINDOW_SAMPLES; n += VECTOR_LANES)
+		storeVector(windowed + n, loadVector(segment + n) * loadVector(hamming + n));
+	memset(windowed + WINDOW_SAMPLES, 0, LAGS * sizeof(float));
+	
+	for (int n = 0; n < WINDOW_SAMPLES; n++) {
+		vector_t sample = { windowed[n], windowed[n], windowed[n], windowed[n] };
+		for (int i = 0; i < LAGS / VECTOR_LANES; i++) sum[i] += sample * loadVector(windowed + n + i * VECTOR_LANES);
+	}
+	
+	for (int lag = 0; lag < LAGS; lag++) r[lag] = sum[lag / VECTOR_LANES][lag % VECTOR_LANES];
+}
+
+// Solve for the reflection coefficients of lags 0-10 by Levinson-Durbin
+// (after lag windowing and a -40dB noise floor).  The TMS5220's lattice
+// subtracts k * x, so its coefficients are the negated PARCOR values.
+static void levinsonDurbin(const double *autocorrelation, float *k)
+{
+	double r[11], a[11] = { 0 }, previous[11];
+	
+	for (int lag = 0; lag <= 10; lag++) r[lag] = autocorrelation[lag] * lagWindow[lag];
+	r[0] *= 1.0001;
+	double error = r[0];
+	
+	for (int i = 1; i <= 10; i++) {
+		if (error <= 0) {
+			k[i - 1] = 0;
+			continue;
+		}
+		
+		double sum = r[i];
+		for (int j = 1; j < i; j++) sum -= a[j] * r[i - j];
+		double reflection = sum / error;
+		
+		memcpy(previous, a, sizeof(a));
+		a[i] = reflection;
+		for (int j = 1; j < i; j++) a[j] = previous[j] - reflection * previous[i - j];
+		error *= 1.0 - reflection * reflection;
+		k[i - 1] = (float)-reflection;
+	}
+}
+
+// Analyse PCM a frame at a time
+int lpcAnalyse(int chip, const int16_t *pcm, int sampleCount, threadPool_t *pool, lpcAnalysis_t *analysis)
+{
+	int frameCount = (sampleCount + LPC_FRAME_SAMPLES - 1) / LPC_FRAME_SAMPLES;
+	pitchEstimate_t *estimates = malloc((frameCount + 1) * sizeof(pitchEstimate_t));
+	
+	pthread_once(&windowOnce, windowInitialise);
+	
+	// The PCM as floats with a window of silence either side
+	int signalCount = WINDOW_SAMPLES + frameCount * LPC_FRAME_SAMPLES + WINDOW_SAMPLES;
+	float *signal = calloc(signalCount, sizeof(float));
+	if (signal == NULL || estimates == NULL || pitchTrack(chip, pcm, sampleCount, pool, estimates) != 0) {
+		free(signal);
+		free(estimates);
+		return -1;
+	}
+	for (int n = 0; n < sampleCount; n++) signal[WINDOW_SAMPLES + n] = pcm[n] / 32768.0f;
+	
+	for (int frame = 0; frame < frameCount; frame++) {
+		const float *segment = signal + WINDOW_SAMPLES + frame * LPC_FRAME_SAMPLES + WINDOW_OFFSET;
+		lpcAnalysis_t *result = &analysis[frame];
+		double r[LAGS], emphasised[11];
+		
+		autocorrelate(segment, r);
+		result->rms = (float)sqrt(r[0] / windowPower);
+		levinsonDurbin(r, result->k);
+		
+		// The autocorrelation of x[n] - p * x[n - 1] follows from x's
+		for (int lag = 0; lag <= 10; lag++)
+			emphasised[lag] = (1.0 + PRE_EMPHASIS * PRE_EMPHASIS) * r[lag] - PRE_EMPHASIS * (r[lag ? lag - 1 : 1] + r[lag + 1]);
+		levinsonDurbin(emphasised, result->voicedK);
+		
+		result->pitch = estimates[frame].pitch;
+		result->periodicity = estimates[frame].periodicity;
+	}
+	
+	free(signal);
+	free(estimates);
+	return 0;
+}
+
+// The index of the table entry nearest value
+static uint8_t nearestIndex(const int16_t *table, int count, double value)
+{
+	int best = 0;
+	for (int i = 1; i < count; i++) {
+		if (fabs(table[i] - value) < fabs(table[best] - value)) best = i;
+	}
+	return (uint8_t)best;
+}
+
+// Output level (full scale 1.0) of a frame synthesised at energy 1.
+// Unvoiced frames are noise of +/-8 through the K1-K4 lattice, whose
+// power gain is 1 / product(1 - k^2).  Voiced frames depend on how the
+// chirp's spectrum meets the lattice's, so the chirp is played through it
+// for a window and measured.
+static double unvoicedLevel(const lpcTables_t *tables, const uint8_t *kIndex)
+{
+	double product = 1.0;
+	for (int i = 0; i < 4; i++) {
+		double k = tables->k[i][kIndex[i]] / 512.0;
+		product *= 1.0 - k * k;
+	}
+	return 16.0 * 8.0 / sqrt(product) / 32768.0;
+}
+
+static double voicedLevel(const lpcTables_t *tables, const uint8_t *kIndex, int period)
+{
+	double k[10], u[11], x[10] = { 0 }, power = 0;
+	uint32_t pitchCount = 0;
+	
+	for (int i = 0; i < 10; i++) k[i] = tables->k[i][kIndex[i]] / 512.0;
+	
+	// Play two windows to settle the filter and measure the second
+	for (int n = 0; n < 2 * WINDOW_SAMPLES; n++) {
+		u[10] = tables->chirp[pitchCount > 51 ? 51 : pitchCount] / 8.0;
+		if (++pitchCount >= (uint32_t)period) pitchCount = 0;
+		
+		for (int i = 9; i >= 0; i--) u[i] = u[i + 1] - k[i] * x[i];
+		for (int i = 9; i >= 1; i--) x[i] = x[i - 1] + k[i - 1] * u[i - 1];
+		x[0] = u[0];
+		
+		if (n >= WINDOW_SAMPLES) power += u[0] * u[0];
+	}
+	
+	return 16.0 * sqrt(power / WINDOW_SAMPLES) / 32768.0;
+}
+
+// The energy index nearest (in dB) to a level; 0 (silent) if the level is
+// under half the smallest energy
+static uint8_t nearestEnergy(const lpcTables_t *tables, double level)
+{
+	if (level < tables->energy[1] / 2.0) return LPC_ENERGY_SILENT;
+	
+	int best = 1;
+	for (int i = 2; i < LPC_ENERGY_STOP; i++) {
+		if (fabs(log(level / tables->energy[i])) < fabs(log(level / tables->energy[best]))) best = i;
+	}
+	return (uint8_t)best;
+}
+
+// Quantise a frame's analysis (repeat frames are chosen later)
+static void quantiseFrame(const lpcChip_t *descriptor, const lpcAnalysis_t *analysis, float gate, lpcFrame_t *frame)
+{
+	const lpcTables_t *tables = descriptor->tables;
+	double level;
+	
+	memset(frame, 0, sizeof(lpcFrame_t));
+	frame->type = LPC_FRAME_SILENT;
+	if (analysis->rms <= gate) return;
+	
+	if (analysis->pitch) {
+		for (int i = 0; i < 10; i++)
+			frame->k[i] = nearestIndex(tables->k[i], 1 << descriptor->kBits[i], analysis->voicedK[i] * 512.0);
+		frame->pitch = analysis->pitch;
+		level = voicedLevel(tables, frame->k, tables->pitch[frame->pitch]);
+	} else {
+		for (int i = 0; i < 4; i++)
+			frame->k[i] = nearestIndex(tables->k[i], 1 << descriptor->kBits[i], analysis->k[i] * 512.0);
+		level = unvoicedLevel(tables, frame->k);
+	}
+	
+	frame->energy = nearestEnergy(tables, analysis->rms / level);
+	if (frame->energy == LPC_ENERGY_SILENT) {
+		memset(frame, 0, sizeof(lpcFrame_t));
+		frame->type = LPC_FRAME_SILENT;
+	} else {
+		frame->type = frame->pitch ? LPC_FRAME_VOICED : LPC_FRAME_UNVOICED;
+	}
+}
+
+// Spectral distortion is measured between log power envelopes sampled
+// at SPECTRUM_BINS frequencies, each normalised to 0dB mean power so that
+// only the shape counts (the energy is re-quantised for whichever K a
+// frame ends up with)
+#define SPECTRUM_BINS	32
+
+// Playing a frame with the wrong voicing is charged as this much
+// distortion at full (or no) periodicity, nothing at the threshold
+#define VOICING_PENALTY	12.0
+
+// Repeat frames may re-use the K of a full frame at most this many
+// frames back
+#define REPEAT_REACH	32
+
+// Decisions for a frame in the optimiser's search
+#define CHOICE_SILENT	0
+#define CHOICE_REPEAT	1		// Repeat, voiced or unvoiced as the pitch says
+#define CHOICE_FULL		2
+
+// Bisection steps of the search for the Lagrange multiplier
+#define SEARCH_STEPS	24
+
+static double spectrumCos[SPECTRUM_BINS][10], spectrumSin[SPECTRUM_BINS][10];
+static pthread_once_t spectrumOnce = PTHREAD_ONCE_INIT;
+
+static void spectrumInitialise(void)
+{
+	for (int bin = 0; bin < SPECTRUM_BINS; bin++) {
+		double frequency = PI * (bin + 0.5) / SPECTRUM_BINS;
+		for (int j = 0; j < 10; j++) {
+			spectrumCos[bin][j] = cos((j + 1) * frequency);
+			spectrumSin[bin][j] = sin((j + 1) * frequency);
+		}
+	}
+}
+
+// The log power envelope of the lattice with coefficients k[0-count]
+// (the rest zero), normalised to 0dB mean power
+static void envelope(const double *k, int count, float *spectrum)
+{
+	double a[11] = { 0 }, previous[11], power[SPECTRUM_BINS], mean = 0;
+	
+	// Step up to the predictor polynomial (the PARCOR values are -k)
+	for (int i = 1; i <= count; i++) {
+		memcpy(previous, a, sizeof(a));
+		a[i] = -k[i - 1];
+		for (int j = 1; j < i; j++) a[j] = previous[j] + k[i - 1] * previous[i - j];
+	}
+	
+	for (int bin = 0; bin < SPECTRUM_BINS; bin++) {
+		double real = 1.0, imaginary = 0.0;
+		for (int j = 0; j < count; j++) {
+			real -= a[j + 1] * spectrumCos[bin][j];
+			imaginary += a[j + 1] * spectrumSin[bin][j];
+		}
+		power[bin] = 1.0 / (real * real + imaginary * imaginary + 1e-12);
+		mean += power[bin];
+	}
+	
+	mean /= SPECTRUM_BINS;
+	for (int bin = 0; bin < SPECTRUM_BINS; bin++) spectrum[bin] = (float)(10.0 * log10(power[bin] / mean));
+}
+
+// The envelope of quantised K indexes as a voiced (10) or unvoiced (4)
+// frame plays them
+static void indexEnvelope(const lpcTables_t *tables, const uint8_t *kIndex, int count, float *spectrum)
+{
+	double k[10];
+	for (int i = 0; i < count; i++) k[i] = tables->k[i][kIndex[i]] / 512.0;
+	envelope(k, count, spectrum);
+}
+
+// RMS difference of two envelopes in dB
+static float spectralDistance(const float *a, const float *b)
+{
+	float sum = 0;
+	for (int bin = 0; bin < SPECTRUM_BINS; bin++) sum += (a[bin] - b[bin]) * (a[bin] - b[bin]);
+	return sqrtf(sum / SPECTRUM_BINS);
+}
+
+// Per-frame targets and candidates of a word being encoded
+typedef struct {
+	const lpcChip_t *descriptor;
+	const lpcAnalysis_t *analysis;
+	int count;
+	float gate;
+	float (*target)[2][SPECTRUM_BINS];		// Unvoiced and voiced analysis envelopes
+	uint8_t (*fullK)[2][10];				// Best full frame K indexes (unvoiced, voiced)
+	float (*fullDistortion)[2];
+	float (*play)[2][2][SPECTRUM_BINS];		// Full frame K played unvoiced and voiced
+	uint8_t *pitch;							// Quantised pitch (0 if none was found)
+} encoderSearch_t;
+
+// The distortion charged for playing a frame with the given voicing
+static float voicingPenalty(const lpcAnalysis_t *analysis, int voiced)
+{
+	float miss = voiced ? PITCH_VOICED_THRESHOLD - analysis->periodicity : analysis->periodicity - PITCH_VOICED_THRESHOLD;
+	return miss > 0 ? (float)(VOICING_PENALTY * miss / PITCH_VOICED_THRESHOLD) : 0.0f;
+}
+
+// Combine an envelope distance with the voicing penalty
+static float frameCost(float distance, float penalty)
+{
+	return sqrtf(distance * distance + penalty * penalty);
+}
+
+// Distortion of leaving a frame silent: how far it is above the gate
+static float silentDistortion(const encoderSearch_t *search, int i)
+{
+	float rms = search->analysis[i].rms;
+	return (rms <= search->gate) ? 0.0f : (float)(20.0 * log10(rms / search->gate));
+}
+
+// The distortion of an encoded frame (k[] is the K in force, as parsed)
+static float frameDistortion(const encoderSearch_t *search, int i, const lpcFrame_t *frame)
+{
+	float spectrum[SPECTRUM_BINS];
+	
+	if (frame->type == LPC_FRAME_SILENT || frame->type == LPC_FRAME_STOP) return silentDistortion(search, i);
+	int voiced = (frame->type == LPC_FRAME_VOICED);
+	indexEnvelope(search->descriptor->tables, frame->k, voiced ? 10 : 4, spectrum);
+	return frameCost(spectralDistance(spectrum, search->target[i][voiced]), voicingPenalty(&search->analysis[i], voiced));
+}
+
+// Quantise a frame's K for the given voicing: the nearest entries, then
+// single steps of any coefficient while they bring the envelope closer
+static void refineK(const encoderSearch_t *search, int i, int voiced, uint8_t *kIndex)
+{
+	const lpcChip_t *descriptor = search->descriptor;
+	const float *k = voiced ? search->analysis[i].voicedK : search->analysis[i].k;
+	int count = voiced ? 10 : 4;
+	float spectrum[SPECTRUM_BINS];
+	
+	memset(kIndex, 0, 10);
+	for (int j = 0; j < count; j++) kIndex[j] = nearestIndex(descriptor->tables->k[j], 1 << descriptor->kBits[j], k[j] * 512.0);
+	indexEnvelope(descriptor->tables, kIndex, count, spectrum);
+	float best = spectralDistance(spectrum, search->target[i][voiced]);
+	
+	for (int pass = 0, improved = 1; pass < 3 && improved; pass++) {
+		improved = 0;
+		for (int j = 0; j < count; j++) {
+			for (int step = -1; step <= 1; step += 2) {
+				int original = kIndex[j], candidate = original + step;
+				if (candidate < 0 || candidate >= (1 << descriptor->kBits[j])) continue;
+				
+				kIndex[j] = (uint8_t)candidate;
+				indexEnvelope(descriptor->tables, kIndex, count, spectrum);
+				float distance = spectralDistance(spectrum, search->target[i][voiced]);
+				if (distance < best) {
+					best = distance;
+					improved = 1;
+				} else {
+					kIndex[j] = (uint8_t)original;
+				}
+			}
+		}
+	}
+}
+
+// Fill in the targets and full frame candidates of every frame
+static int searchInitialise(encoderSearch_t *search, const lpcChip_t *descriptor, const lpcAnalysis_t *analysis, int count, float gate)
+{
+	int n = count ? count : 1;
+	
+	pthread_once(&spectrumOnce, spectrumInitialise);
+	search->descriptor = descriptor;
+	search->analysis = analysis;
+	search->count = count;
+	search->gate = gate;
+	search->target = malloc(n * sizeof(*search->target));
+	search->fullK = malloc(n * sizeof(*search->fullK));
+	search->fullDistortion = malloc(n * sizeof(*search->fullDistortion));
+	search->play = malloc(n * sizeof(*search->play));
+	search->pitch = malloc(n);
+	if (!search->target || !search->fullK || !search->fullDistortion || !search->play || !search->pitch) return -1;
+	
+	for (int i = 0; i < count; i++) {
+		double k[10];
+		for (int j = 0; j < 10; j++) k[j] = analysis[i].k[j];
+		envelope(k, 10, search->target[i][0]);
+		for (int j = 0; j < 10; j++) k[j] = analysis[i].voicedK[j];
+		envelope(k, 10, search->target[i][1]);
+		
+		search->pitch[i] = analysis[i].pitch;
+		
+		for (int voiced = 0; voiced < 2; voiced++) {
+			refineK(search, i, voiced, search->fullK[i][voiced]);
+			
+			// As a repeat plays it (an unvoiced frame's K5-K10 are parsed
+			// as index 0)
+			for (int play = 0; play < 2; play++)
+				indexEnvelope(descriptor->tables, search->fullK[i][voiced], play ? 10 : 4, search->play[i][voiced][play]);
+			search->fullDistortion[i][voiced] = frameCost(
+				spectralDistance(search->play[i][voiced][voiced], search->target[i][voiced]),
+				voicingPenalty(&analysis[i], voiced));
+		}
+	}
+	
+	return 0;
+}
+
+static void searchFree(encoderSearch_t *search)
+{
+	free(search->target);
+	free(search->fullK);
+	free(search->fullDistortion);
+	free(search->play);
+	free(search->pitch);
+}
+
+// Search states are the K in force: that of the full frame age frames
+// back with the given voicing, or none before the first full frame
+#define STATE(age, voiced)	((age) * 2 + (voiced))
+#define STATE_NONE			STATE(REPEAT_REACH + 1, 0)
+#define STATES				(STATE_NONE + 1)
+
+typedef struct {
+	uint8_t choice;			// CHOICE_ taken into this state
+	uint8_t voiced;			// Voicing the frame is played with
+	uint8_t previous;		// State at the previous frame
+} searchStep_t;
+
+// Find the encoding minimising bits + lambda * distortion by dynamic
+// programming over the K in force.  Returns the total distortion and
+// fills steps[count][STATES] for the trace back through finalState.
+static float searchFrames(const encoderSearch_t *search, const float (*repeatCost)[STATES][2], double lambda,
+	searchStep_t (*steps)[STATES], int *finalState, uint32_t *bits)
+{
+	const lpcChip_t *descriptor = search->descriptor;
+	int header = 5 + descriptor->pitchBits, kBits[2] = { 0, 0 };
+	double cost[STATES], next[STATES];
+	
+	for (int j = 0; j < 10; j++) kBits[1] += descriptor->kBits[j];
+	for (int j = 0; j < 4; j++) kBits[0] += descriptor->kBits[j];
+	
+	for (int s = 0; s < STATES; s++) cost[s] = INFINITY;
+	cost[STATE_NONE] = 0;
+	
+	for (int i = 0; i < search->count; i++) {
+		int quiet = (search->analysis[i].rms <= search->gate);
+		int canVoice = (search->pitch[i] != 0);
+		double silent = 4 + lambda * silentDistortion(search, i);
+		
+		for (int s = 0; s < STATES; s++) next[s] = INFINITY;
+		
+		// Silent and repeat frames keep the K in force (one frame older,
+		// and no longer available to repeat once out of reach)
+		for (int s = 0; s < STATES; s++) {
+			if (cost[s] == INFINITY) continue;
+			int target = (s + 2 < STATE_NONE) ? s + 2 : STATE_NONE;
+			
+			double best = cost[s] + silent;
+			searchStep_t step = { CHOICE_SILENT, 0, (uint8_t)s };
+			for (int voiced = 0; !quiet && s != STATE_NONE && voiced <= canVoice; voiced++) {
+				double candidate = cost[s] + header + lambda * repeatCost[i][s][voiced];
+				if (candidate < best) {
+					best = candidate;
+					step.choice = CHOICE_REPEAT;
+					step.voiced = (uint8_t)voiced;
+				}
+			}
+			if (best < next[target]) {
+				next[target] = best;
+				steps[i][target] = step;
+			}
+		}
+		
+		// A full frame starts a new K from the cheapest state
+		int cheapest = 0;
+		for (int s = 1; s < STATES; s++) {
+			if (cost[s] < cost[cheapest]) cheapest = s;
+		}
+		for (int voiced = 0; !quiet && voiced <= canVoice; voiced++) {
+			next[STATE(0, voiced)] = cost[cheapest] + header + kBits[voiced] + lambda * search->fullDistortion[i][voiced];
+			steps[i][STATE(0, voiced)] = (searchStep_t){ CHOICE_FULL, (uint8_t)voiced, (uint8_t)cheapest };
+		}
+		
+		memcpy(cost, next, sizeof(cost));
+	}
+	
+	// Trace back for the distortion and bits of the best path
+	int state = 0;
+	for (int s = 1; s < STATES; s++) {
+		if (cost[s] < cost[state]) state = s;
+	}
+	*finalState = state;
+	
+	float distortion = 0;
+	*bits = 0;
+	for (int i = search->count - 1; i >= 0; i--) {
+		const searchStep_t *step = &steps[i][state];
+		if (step->choice == CHOICE_SILENT) {
+			*bits += 4;
+			distortion += silentDistortion(search, i);
+		} else if (step->choice == CHOICE_REPEAT) {
+			*bits += header;
+			distortion += repeatCost[i][step->previous][step->voiced];
+		} else {
+			*bits += header + kBits[step->voiced];
+			distortion += search->fullDistortion[i][step->voiced];
+		}
+		state = step->previous;
+	}
+	
+	return distortion;
+}
+
+// Choose frames minimising bits with mean distortion within budget,
+// writing them to frames (count of them, without the stop frame).
+// Returns the mean distortion, or -1 if out of memory (the frames are
+// then left as they were).
+static float optimiseFrames(const encoderSearch_t *search, float budget, lpcFrame_t *frames)
+{
+	const lpcTables_t *tables = search->descriptor->tables;
+	int count = search->count;
+	float (*repeatCost)[STATES][2] = malloc((count ? count : 1) * sizeof(*repeatCost));
+	searchStep_t (*steps)[STATES] = malloc((count ? count : 1) * sizeof(*steps));
+	uint8_t *choices = malloc(count ? count : 1);
+	int finalState = STATE_NONE;
+	uint32_t bits;
+	float distortion = 0;
+	
+	if (repeatCost == NULL || steps == NULL || choices == NULL) {
+		free(repeatCost);
+		free(steps);
+		free(choices);
+		return -1;
+	}
+	
+	// Cost of frame i repeating the K of each state after frame i - 1
+	for (int i = 0; i < count; i++) {
+		for (int s = 0; s < STATES; s++) {
+			int full = i - 1 - s / 2, voiced = s % 2;
+			for (int play = 0; play < 2; play++) {
+				repeatCost[i][s][play] = (s != STATE_NONE && full >= 0)
+					? frameCost(spectralDistance(search->play[full][voiced][play], search->target[i][play]),
+						voicingPenalty(&search->analysis[i], play))
+					: INFINITY;
+			}
+		}
+	}
+	
+	// The search only reads the costs (C99 needs the qualifier added by hand)
+	const float (*costs)[STATES][2] = (const float (*)[STATES][2])repeatCost;
+	
+	// The distortion falls as lambda rises; find the smallest lambda (so
+	// the fewest bits) within budget, searching in log lambda
+	double low = log(1e-3), high = log(1e5);
+	for (int iteration = 0; iteration < SEARCH_STEPS; iteration++) {
+		double middle = (low + high) / 2;
+		if (searchFrames(search, costs, exp(middle), steps, &finalState, &bits) <= budget * count) high = middle;
+		else low = middle;
+	}
+	distortion = searchFrames(search, costs, exp(high), steps, &finalState, &bits);
+	
+	// Trace back, then write the frames out forwards
+	int state = finalState;
+	for (int i = count - 1; i >= 0; i--) {
+		choices[i] = (uint8_t)(steps[i][state].choice | (steps[i][state].voiced << 2));
+		state = steps[i][state].previous;
+	}
+	
+	uint8_t currentK[10] = { 0 };
+	for (int i = 0; i < count; i++) {
+		const lpcAnalysis_t *analysis = &search->analysis[i];
+		lpcFrame_t *frame = &frames[i];
+		int choice = choices[i] & 3, voiced = choices[i] >> 2;
+		
+		memset(frame, 0, sizeof(lpcFrame_t));
+		if (choice == CHOICE_SILENT) {
+			frame->type = LPC_FRAME_SILENT;
+			memcpy(frame->k, currentK, 10);
+			continue;
+		}
+		
+		if (choice == CHOICE_FULL) memcpy(currentK, search->fullK[i][voiced], 10);
+		memcpy(frame->k, currentK, 10);
+		frame->repeat = (choice == CHOICE_REPEAT);
+		frame->type = voiced ? LPC_FRAME_VOICED : LPC_FRAME_UNVOICED;
+		frame->pitch = voiced ? search->pitch[i] : 0;
+		
+		// The energy suits the K actually played; a frame the search chose
+		// to play is never dropped to silence (that would change the K in
+		// force for the frames after it)
+		double level = voiced ? voicedLevel(tables, frame->k, tables->pitch[frame->pitch]) : unvoicedLevel(tables, frame->k);
+		frame->energy = nearestEnergy(tables, analysis->rms / level);
+		if (frame->energy == LPC_ENERGY_SILENT) frame->energy = 1;
+	}
+	
+	free(choices);
+	free(repeatCost);
+	free(steps);
+	return count ? distortion / count : 0;
+}
+
+// The settings as a single value (for cache keys)
+uint32_t lpcEncodeSettingsKey(const lpcEncodeSettings_t *settings)
+{
+	return settings->chip | (settings->optimise << 4) | (settings->distortion << 8);
+}
+
+// Encode PCM into frames
+int lpcEncode(const lpcEncodeSettings_t *settings, const int16_t *pcm, int sampleCount, threadPool_t *pool,
+	lpcFrame_t *frames, int maxFrames, lpcEncodeStats_t *stats)
+{
+	const lpcChip_t *descriptor = lpcGetChip(settings->chip) ? lpcGetChip(settings->chip) : &lpcChipTms5220;
+	int analysisCount = (sampleCount + LPC_FRAME_SAMPLES - 1) / LPC_FRAME_SAMPLES;
+	lpcAnalysis_t *analysis = malloc((analysisCount + 1) * sizeof(lpcAnalysis_t));
+	lpcFrame_t *quantised = malloc((analysisCount + 1) * sizeof(lpcFrame_t));
+	encoderSearch_t search = { 0 };
+	uint8_t currentK[10] = { 0 };
+	int frameCount = 0, result = -1;
+	
+	if (analysis == NULL || quantised == NULL || lpcAnalyse(settings->chip, pcm, sampleCount, pool, analysis) != 0) goto done;
+	
+	float loudest = 0;
+	for (int i = 0; i < analysisCount; i++) {
+		if (analysis[i].rms > loudest) loudest = analysis[i].rms;
+	}
+	for (int i = 0; i < analysisCount; i++) quantiseFrame(descriptor, &analysis[i], loudest * SILENCE_GATE, &quantised[i]);
+	
+	// Drop the silence at either end
+	int first = 0, last = analysisCount - 1;
+	while (first <= last && quantised[first].type == LPC_FRAME_SILENT) first++;
+	while (last >= first && quantised[last].type == LPC_FRAME_SILENT) last--;
+	if (last - first + 2 > maxFrames) goto done;
+	
+	for (int i = first; i <= last; i++) {
+		lpcFrame_t *frame = &frames[frameCount++];
+		*frame = quantised[i];
+		
+		// Silent frames leave the K in force (as the parser reports them)
+		if (frame->type == LPC_FRAME_SILENT) {
+			memcpy(frame->k, currentK, 10);
+			continue;
+		}
+		
+		// K indexes all within a step of those in force are repeated
+		int kCount = (frame->type == LPC_FRAME_VOICED) ? 10 : 4;
+		frame->repeat = 1;
+		for (int k = 0; k < kCount; k++) {
+			if (abs(frame->k[k] - currentK[k]) > 1) frame->repeat = 0;
+		}
+		
+		if (frame->repeat) memcpy(frame->k, currentK, 10);
+		else memcpy(currentK, frame->k, 10);
+	}
+	
+	if (settings->optimise || stats) {
+		if (searchInitialise(&search, descriptor, analysis + first, frameCount, loudest * SILENCE_GATE) != 0) goto done;
+		
+		float plainDistortion = 0;
+		uint32_t plainBits = 4;
+		for (int i = 0; i < frameCount; i++) {
+			plainDistortion += frameDistortion(&search, i, &frames[i]);
+			plainBits += lpcFrameBits(settings->chip, &frames[i]);
+		}
+		if (frameCount) plainDistortion /= frameCount;
+		if (stats) {
+			stats->plainBits = stats->bits = plainBits;
+			stats->plainDistortion = stats->distortion = plainDistortion;
+		}
+		
+		if (settings->optimise) {
+			float budget = settings->distortion ? settings->distortion / 10.0f : plainDistortion;
+			float distortion = optimiseFrames(&search, budget, frames);
+			if (distortion < 0) goto done;
+			
+			if (stats) {
+				stats->distortion = distortion;
+				stats->bits = 4;
+				for (int i = 0; i < frameCount; i++) stats->bits += lpcFrameBits(settings->chip, &frames[i]);
+			}
+			if (frameCount) memcpy(currentK, frames[frameCount - 1].k, 10);
+		}
+	}
+	
+	memset(&frames[frameCount], 0, sizeof(lpcFrame_t));
+	frames[frameCount].type = LPC_FRAME_STOP;
+	frames[frameCount].energy = LPC_ENERGY_STOP;
+	memcpy(frames[frameCount].k, currentK, 10);
+	result = frameCount + 1;
+	
+done:
+	searchFree(&search);
+	free(analysis);
+	free(quantised);
+	return result;
+}
@@ -0,0 +1,98 @@
+/************************************************************************
+	lpcencode.h
+
+    LPC encoder (PCM to TMS5220 frames)
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef LPCENCODE_H_
+#define LPCENCODE_H_
+
+#include <stdint.h>
+
+#include "lpcframe.h"
+#include "threadpool.h"
+
+// The encoder analyses 8KHz PCM a frame (200 samples) at a time: a 40ms
+// Hamming window centred on the end of the frame (where the synthesiser
+// reaches the frame's targets), a 10th order autocorrelation LPC solved
+// by Levinson-Durbin into reflection coefficients, and the pitch and
+// voicing from pitchtrack.c.  The results are quantised to the chip's
+// tables: K1-K10 to the nearest entries (the tracker's pitch already is)
+// and the energy so that the synthesised frame has the recording's level.
+// Frames more than 40dB below the loudest are silent (and silence at
+// either end is dropped); frames whose K indexes are all within a step of
+// the previous frame's become repeat frames.
+//
+// The optimising mode instead chooses each frame (full, repeat, voiced,
+// unvoiced or silent) and its K quantisation to use the fewest bits while
+// keeping the mean spectral distortion (the RMS dB difference of the
+// frame's envelope from the analysis, with penalties for playing a frame
+// with the wrong voicing or as silence) within a budget.  By default the
+// budget is the plain encoding's own distortion, so the words shrink at
+// no loss of fidelity by that measure.
+
+// Raised whenever a change to the encoder changes its output (it forms part
+// of the key of cached encodings)
+#define LPC_ENCODE_VERSION	2
+
+// Analysis of a single frame before quantisation
+typedef struct {
+	float rms;				// Level of the windowed speech (full scale 1.0)
+	float k[10];			// Reflection coefficients (TMS5220 sign convention)
+	float voicedK[10];		// The same for the pre-emphasised speech
+	uint8_t pitch;			// Pitch table index (0 for unvoiced)
+	float periodicity;		// The pitch tracker's score (see pitchtrack.h)
+} lpcAnalysis_t;
+
+// Encoder settings (all part of the key of a cached encoding)
+typedef struct {
+	uint8_t chip;			// LPC_CHIP_ variant (frame format and tables)
+	uint8_t optimise;		// Rate-distortion optimised frame selection
+	uint8_t distortion;		// Budget in tenths of a dB (0 for the plain encoding's)
+} lpcEncodeSettings_t;
+
+// Pack settings into a single value for use as (part of) a key
+uint32_t lpcEncodeSettingsKey(const lpcEncodeSettings_t *settings);
+
+// Size and mean spectral distortion (dB) of an encoding and of the plain
+// encoding of the same speech
+typedef struct {
+	uint32_t bits;
+	float distortion;
+	uint32_t plainBits;
+	float plainDistortion;
+} lpcEncodeStats_t;
+
+// Analyse PCM into frameCount = (sampleCount + 199) / 200 frames of
+// analysis (returns 0, or -1 if out of memory).  The pitch tracking runs
+// across the pool, if not NULL (pool tasks must pass NULL).
+int lpcAnalyse(int chip, const int16_t *pcm, int sampleCount, threadPool_t *pool, lpcAnalysis_t *analysis);
+
+// Encode 8KHz PCM into the chip's frames, ending with a stop frame.
+// Returns the number of frames or -1 if the word needs more than
+// maxFrames (or memory runs out).  pool (may be NULL) is as for
+// lpcAnalyse() and stats may be NULL.
+int lpcEncode(const lpcEncodeSettings_t *settings, const int16_t *pcm, int sampleCount, threadPool_t *pool,
+	lpcFrame_t *frames, int maxFrames, lpcEncodeStats_t *stats);
+
+#endif /* LPCENCODE_H_ */
@@ -0,0 +1,152 @@
+/************************************************************************
+	lpcframe.c
+
+    TMS5220 LPC-10 frame parser
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <string.h>
+
+#include "lpcframe.h"
+#include "bitreader.h"
+#include "lpcdecode.h"
+#include "lpctables.h"
+
+// Bit widths of the K1-K10 fields
+const uint8_t lpcKBits[10] = { 5, 5, 4, 4, 4, 4, 4, 3, 3, 3 };
+
+// Parse frames from startBit up to and including the stop frame.  This is
+// instantiated for each chip's descriptor, so the field widths are
+// constants.  previousK (NULL for none) is the K in force before the first
+// frame; frameBits (may be NULL) receives the bit offset of each frame.
+static inline __attribute__((always_inline)) int parseFrames(const lpcChip_t *chip,
+	const uint8_t *image, uint32_t imageSize, uint32_t startBit, const uint8_t *initialK,
+	lpcFrame_t *frames, uint32_t *frameBits, int maxFrames, uint32_t *endBit)
+{
+	bitReader_t reader;
+	uint32_t bitLimit = imageSize * 8;
+	uint8_t previousK[10] = { 0 };
+	int frameCount = 0;
+	
+	if (initialK) memcpy(previousK, initialK, 10);
+	bitReaderInitialise(&reader, image, imageSize, startBit);
+	
+	while (1) {
+		if (frameCount == maxFrames) return LPC_PARSE_TOOLONG;
+		
+		// Buffer enough bits for the longest frame so its fields are
+		// plain shifts
+		bitReaderEnsure(&reader, LPC_MAX_FRAME_BITS);
+		
+		if (frameBits) frameBits[frameCount] = bitReaderTell(&reader);
+		lpcFrame_t *frame = &frames[frameCount++];
+		lpcDecodeFrame(chip, &reader, LPC_MAX_FRAME_BITS, previousK, frame);
+		
+		if (bitReaderTell(&reader) > bitLimit) return LPC_PARSE_OVERRUN;
+		if (frame->type == LPC_FRAME_STOP) break;
+	}
+	
+	if (endBit) *endBit = bitReaderTell(&reader);
+	return frameCount;
+}
+
+// Parse a word of TMS5220 frames
+int lpcParseWord(const uint8_t *image, uint32_t imageSize, uint32_t address,
+	lpcFrame_t *frames, int maxFrames, uint32_t *endBit)
+{
+	return parseFrames(&lpcChipTms5220, image, imageSize, address * 8, NULL, frames, NULL, maxFrames, endBit);
+}
+
+// Parse a word of the given chip's frames
+int lpcParseWordChip(int chip, const uint8_t *image, uint32_t imageSize, uint32_t address,
+	lpcFrame_t *frames, int maxFrames, uint32_t *endBit)
+{
+	// The TMS5200 and TMS5220C share the TMS5220's frame format
+	if (chip == LPC_CHIP_TMS5110)
+		return parseFrames(&lpcChipTms5110, image, imageSize, address * 8, NULL, frames, NULL, maxFrames, endBit);
+	return parseFrames(&lpcChipTms5220, image, imageSize, address * 8, NULL, frames, NULL, maxFrames, endBit);
+}
+
+// Parse frames from any bit offset
+int lpcParseFrames(int chip, const uint8_t *image, uint32_t imageSize, uint32_t startBit,
+	const uint8_t *previousK, lpcFrame_t *frames, uint32_t *frameBits, int maxFrames, uint32_t *endBit)
+{
+	if (chip == LPC_CHIP_TMS5110)
+		return parseFrames(&lpcChipTms5110, image, imageSize, startBit, previousK, frames, frameBits, maxFrames, endBit);
+	return parseFrames(&lpcChipTms5220, image, imageSize, startBit, previousK, frames, frameBits, maxFrames, endBit);
+}
+
+// The number of bits a frame takes
+int lpcFrameBits(int chip, const lpcFrame_t *frame)
+{
+	const lpcChip_t *descriptor = lpcGetChip(chip) ? lpcGetChip(chip) : &lpcChipTms5220;
+	int bits = 4;
+	
+	if (frame->type == LPC_FRAME_SILENT || frame->type == LPC_FRAME_STOP) return bits;
+	bits += 1 + descriptor->pitchBits;
+	if (frame->repeat) return bits;
+	
+	int kCount = (frame->type == LPC_FRAME_VOICED) ? 10 : 4;
+	for (int i = 0; i < kCount; i++) bits += descriptor->kBits[i];
+	return bits;
+}
+
+// Write a field MSB first into the serial stream (bytes are shifted out
+// LSB first)
+static void putBits(uint8_t *data, uint32_t *bitPointer, uint32_t value, int count)
+{
+	for (int i = count - 1; i >= 0; i--) {
+		uint32_t bit = *bitPointer;
+		if ((value >> i) & 1) data[bit >> 3] |= (uint8_t)(1 << (bit & 7));
+		else data[bit >> 3] &= (uint8_t)~(1 << (bit & 7));
+		(*bitPointer)++;
+	}
+}
+
+// Pack frames into the serial bit stream
+int lpcPackFrames(int chip, const lpcFrame_t *frames, int frameCount,
+	uint8_t *data, uint32_t size, uint32_t startBit, uint32_t *endBit)
+{
+	const lpcChip_t *descriptor = lpcGetChip(chip) ? lpcGetChip(chip) : &lpcChipTms5220;
+	uint32_t bitPointer = startBit;
+	
+	for (int i = 0; i < frameCount; i++) {
+		const lpcFrame_t *frame = &frames[i];
+		if (bitPointer + lpcFrameBits(chip, frame) > size * 8) return -1;
+		
+		if (frame->type == LPC_FRAME_SILENT || frame->type == LPC_FRAME_STOP) {
+			putBits(data, &bitPointer, frame->type == LPC_FRAME_STOP ? LPC_ENERGY_STOP : LPC_ENERGY_SILENT, 4);
+			continue;
+		}
+		
+		putBits(data, &bitPointer, frame->energy, 4);
+		putBits(data, &bitPointer, frame->repeat, 1);
+		putBits(data, &bitPointer, frame->type == LPC_FRAME_VOICED ? frame->pitch : 0, descriptor->pitchBits);
+		if (frame->repeat) continue;
+		
+		int kCount = (frame->type == LPC_FRAME_VOICED) ? 10 : 4;
+		for (int k = 0; k < kCount; k++) putBits(data, &bitPointer, frame->k[k], descriptor->kBits[k]);
+	}
+	
+	if (endBit) *endBit = bitPointer;
+	return 0;
+}
@@ -0,0 +1,107 @@
+/************************************************************************
+	lpcframe.h
+
+    TMS5220 LPC-10 frame parser
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef LPCFRAME_H_
+#define LPCFRAME_H_
+
+#include <stdint.h>
+
+// TMS5220 frame format (as clocked out of the PHROM on ADD8):
+//
+// Energy (4 bits) - 0 is a silent frame and 15 is the stop frame
+// Repeat (1 bit)  - re-use the previous frame's K coefficients
+// Pitch (6 bits)  - 0 is an unvoiced frame (5 bits on the TMS5110)
+// K1-K4 (5, 5, 4, 4 bits) - present unless the frame is a repeat
+// K5-K10 (4, 4, 4, 3, 3, 3 bits) - present for voiced non-repeat frames
+//
+// Bytes are shifted out LSB first (see m0SignalHandler() in the firmware)
+// and the VSP assembles each field MSB first from that serial stream.
+
+// Frame types
+#define LPC_FRAME_SILENT	0
+#define LPC_FRAME_UNVOICED	1
+#define LPC_FRAME_VOICED	2
+#define LPC_FRAME_STOP		3
+
+// Energy indexes with special meanings
+#define LPC_ENERGY_SILENT	0x0
+#define LPC_ENERGY_STOP		0xF
+
+// The number of samples in a frame (25ms at 8KHz)
+#define LPC_FRAME_SAMPLES	200
+
+// Frame buffers are sized for words of up to 25.6 seconds; anything
+// longer is not a real utterance
+#define LPC_MAX_WORD_FRAMES	1024
+
+// Parser errors
+#define LPC_PARSE_OVERRUN	-1	// The word runs past the end of the image
+#define LPC_PARSE_TOOLONG	-2	// More frames than the caller allowed for
+
+// A parsed frame (K indexes of repeat frames are copied from the
+// previous frame so every frame is self-contained)
+typedef struct {
+	uint8_t type;
+	uint8_t energy;
+	uint8_t repeat;
+	uint8_t pitch;
+	uint8_t k[10];
+} lpcFrame_t;
+
+// Bit widths of the K1-K10 fields
+extern const uint8_t lpcKBits[10];
+
+// Parse the word starting at address into frames (the stop frame is
+// included).  Returns the number of frames or a LPC_PARSE_ error.
+// If endBit is not NULL it receives the bit offset following the stop frame.
+int lpcParseWord(const uint8_t *image, uint32_t imageSize, uint32_t address,
+	lpcFrame_t *frames, int maxFrames, uint32_t *endBit);
+
+// As lpcParseWord() for a chip variant (an LPC_CHIP_ number; the TMS5110's
+// frames have a 5-bit pitch field)
+int lpcParseWordChip(int chip, const uint8_t *image, uint32_t imageSize, uint32_t address,
+	lpcFrame_t *frames, int maxFrames, uint32_t *endBit);
+
+// Parse from any bit offset (e.g. part way through a word) up to and
+// including the stop frame.  previousK is the K in force before the first
+// frame, i.e. the k[] of the frame before it (NULL for zeros, as at the
+// start of a word).  frameBits, if not NULL, receives the bit offset of
+// each frame parsed.
+int lpcParseFrames(int chip, const uint8_t *image, uint32_t imageSize, uint32_t startBit,
+	const uint8_t *previousK, lpcFrame_t *frames, uint32_t *frameBits, int maxFrames, uint32_t *endBit);
+
+// Pack frames (as parsed: repeat frames flagged, unvoiced frames' K5-K10
+// ignored, ending with the stop frame) into data from startBit, the
+// inverse of lpcParseFrames().  Returns 0, or -1 if they do not fit in
+// size bytes.  If endBit is not NULL it receives the bit offset following
+// the last frame.
+int lpcPackFrames(int chip, const lpcFrame_t *frames, int frameCount,
+	uint8_t *data, uint32_t size, uint32_t startBit, uint32_t *endBit);
+
+// The number of bits a frame takes in the chip's frame format
+int lpcFrameBits(int chip, const lpcFrame_t *frame);
+
+#endif /* LPCFRAME_H_ */
@@ -0,0 +1,208 @@
+/************************************************************************
+	lpclanekernel.h
+
+    Lane renderer kernel (included once per lane count)
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+// This file is included by lpclanes.c once for each lane count with
+// LPC_LANES defined; it has no include guard on purpose.  LANE(name)
+// gives each instantiation's symbols a distinct name.
+
+#define LANE_PASTE(name, lanes)	name##lanes
+#define LANE_NAME(name, lanes)	LANE_PASTE(name, lanes)
+#define LANE(name)				LANE_NAME(name, LPC_LANES)
+
+typedef int32_t LANE(lanes_t) __attribute__((vector_size(LPC_LANES * sizeof(int32_t))));
+
+typedef struct {
+	LANE(lanes_t) energy, pitch, k[10];
+	LANE(lanes_t) targetEnergy, targetPitch, targetK[10];
+	LANE(lanes_t) previousEnergy;
+	LANE(lanes_t) pitchCount, rng;
+	LANE(lanes_t) u[11], x[10];
+	LANE(lanes_t) unvoiced;			// -1 where the previous frame was unvoiced
+	LANE(lanes_t) interpolating;	// -1 where interpolation is not inhibited
+	
+	uint8_t oldUnvoiced[LPC_LANES], oldSilent[LPC_LANES];
+	int job[LPC_LANES];				// -1 for an idle lane
+	int frame[LPC_LANES];
+} LANE(laneSynth_t);
+
+// Wrap and multiply as matrixMultiply() does, in every lane (a macro so
+// that no vector is passed by value across a call)
+#ifndef LANE_MULTIPLY
+#define LANE_MULTIPLY(a, b) \
+	(((((a) + 512) & 0x3FF) - 512) * ((((b) + 16384) & 0x7FFF) - 16384) >> 9)
+#endif
+
+// Reset one lane to the synthesiser's power-on state
+static void LANE(resetLane)(LANE(laneSynth_t) *synth, int lane)
+{
+	synth->energy[lane] = synth->pitch[lane] = 0;
+	synth->targetEnergy[lane] = synth->targetPitch[lane] = 0;
+	for (int i = 0; i < 10; i++) synth->k[i][lane] = synth->targetK[i][lane] = synth->x[i][lane] = 0;
+	for (int i = 0; i < 11; i++) synth->u[i][lane] = 0;
+	synth->previousEnergy[lane] = 0;
+	synth->pitchCount[lane] = 0;
+	synth->rng[lane] = 0x1FFF;
+	synth->oldUnvoiced[lane] = TRUE;
+	synth->oldSilent[lane] = TRUE;
+}
+
+// Load one lane's targets for its next frame (as loadFrame() does)
+static void LANE(loadLane)(LANE(laneSynth_t) *synth, int lane, const lpcFrame_t *frame)
+{
+	uint8_t newUnvoiced = (frame->type != LPC_FRAME_VOICED);
+	uint8_t newSilent = (frame->type == LPC_FRAME_SILENT || frame->type == LPC_FRAME_STOP);
+	
+	if (newSilent) {
+		synth->targetEnergy[lane] = 0;
+		synth->targetPitch[lane] = 0;
+		for (int i = 0; i < 10; i++) synth->targetK[i][lane] = 0;
+	} else {
+		synth->targetEnergy[lane] = tables->energy[frame->energy];
+		synth->targetPitch[lane] = tables->pitch[frame->pitch];
+		for (int i = 0; i < 4; i++) synth->targetK[i][lane] = tables->k[i][frame->k[i]];
+		for (int i = 4; i < 10; i++) synth->targetK[i][lane] = newUnvoiced ? 0 : tables->k[i][frame->k[i]];
+	}
+	
+	int inhibit = (synth->oldUnvoiced[lane] != newUnvoiced) || (synth->oldSilent[lane] && !newSilent);
+	synth->interpolating[lane] = inhibit ? 0 : -1;
+	synth->unvoiced[lane] = synth->oldUnvoiced[lane] ? -1 : 0;
+}
+
+// Play one frame in every lane into output[sample][lane]
+static void LANE(playFrame)(LANE(laneSynth_t) *synth, int32_t output[LPC_FRAME_SAMPLES][LPC_LANES])
+{
+	LANE(lanes_t) s = synth->unvoiced;
+	LANE(lanes_t) voiced = ~s;
+	int anyUnvoiced = 0, anyVoiced = 0;
+	int sample = 0;
+	
+	for (int lane = 0; lane < LPC_LANES; lane++) {
+		if (s[lane]) anyUnvoiced = 1;
+		else anyVoiced = 1;
+	}
+	
+	for (int subframe = 0; subframe < LPC_SUBFRAMES; subframe++) {
+		// Inhibited lanes only move at the last sub-frame
+		LANE(lanes_t) step = subframe == LPC_SUBFRAMES - 1 ? ~(LANE(lanes_t)){ 0 } : synth->interpolating;
+		int shift = tables->interpolationShift[subframe];
+		synth->energy += ((synth->targetEnergy - synth->energy) >> shift) & step;
+		synth->pitch += ((synth->targetPitch - synth->pitch) >> shift) & step;
+		for (int i = 0; i < 10; i++) synth->k[i] += ((synth->targetK[i] - synth->k[i]) >> shift) & step;
+		
+		for (int n = 0; n < LPC_SUBFRAME_SAMPLES; n++, sample++) {
+			// Noise: 20 LFSR clocks per sample from the table, only where unvoiced
+			LANE(lanes_t) excitation = { 0 };
+			if (anyUnvoiced) {
+				LANE(lanes_t) rng;
+				for (int lane = 0; lane < LPC_LANES; lane++) rng[lane] = lfsrStep20[synth->rng[lane]];
+				synth->rng = (rng & s) | (synth->rng & voiced);
+				excitation = (64 - ((synth->rng & 1) << 7)) & s;
+			}
+			
+			// Chirp: a table lookup per lane, only where voiced
+			if (anyVoiced) {
+				LANE(lanes_t) chirp;
+				for (int lane = 0; lane < LPC_LANES; lane++) {
+					int32_t count = synth->pitchCount[lane];
+					chirp[lane] = tables->chirp[count > 51 ? 51 : count];
+				}
+				excitation |= chirp & voiced;
+			}
+			
+			LANE(lanes_t) count = synth->pitchCount + 1;
+			count &= ~(count >= synth->pitch);
+			synth->pitchCount = count & 0x1FF;
+			
+			// Lattice filter
+			LANE(lanes_t) scaled = excitation * 64;
+			synth->u[10] = LANE_MULTIPLY(synth->previousEnergy, scaled);
+			for (int i = 9; i >= 0; i--) synth->u[i] = synth->u[i + 1] - LANE_MULTIPLY(synth->k[i], synth->x[i]);
+			for (int i = 9; i >= 1; i--) synth->x[i] = synth->x[i - 1] + LANE_MULTIPLY(synth->k[i - 1], synth->u[i - 1]);
+			synth->x[0] = synth->u[0];
+			synth->previousEnergy = synth->energy;
+			
+			// Wrap at 15 bits, clip to 12 and keep the DAC's top 8
+			LANE(lanes_t) value = ((synth->u[0] + 16384) & 0x7FFF) - 16384;
+			LANE(lanes_t) high = value > 2047, low = value < -2048;
+			value = (value & ~(high | low)) | (2047 & high) | (-2048 & low);
+			value &= ~0xF;
+			value = (value * 16) | ((value & 0x7F0) >> 3) | ((value & 0x400) >> 10);
+			
+			memcpy(output[sample], &value, sizeof(value));
+		}
+	}
+}
+
+static void LANE(render)(const lpcLaneJob_t *jobs, int jobCount)
+{
+	LANE(laneSynth_t) synth;
+	int32_t block[LPC_FRAME_SAMPLES][LPC_LANES];
+	int nextJob = 0;
+	
+	memset(&synth, 0, sizeof(synth));
+	for (int lane = 0; lane < LPC_LANES; lane++) synth.job[lane] = -1;
+	
+	while (1) {
+		int active = 0;
+		
+		// Refill lanes whose words have finished
+		for (int lane = 0; lane < LPC_LANES; lane++) {
+			if (synth.job[lane] < 0 || synth.frame[lane] == jobs[synth.job[lane]].frameCount) {
+				synth.job[lane] = -1;
+				while (nextJob < jobCount && jobs[nextJob].frameCount <= 0) nextJob++;
+				if (nextJob < jobCount) {
+					synth.job[lane] = nextJob++;
+					synth.frame[lane] = 0;
+					LANE(resetLane)(&synth, lane);
+				}
+			}
+			if (synth.job[lane] >= 0) {
+				LANE(loadLane)(&synth, lane, &jobs[synth.job[lane]].frames[synth.frame[lane]]);
+				active++;
+			}
+		}
+		if (active == 0) break;
+		
+		LANE(playFrame)(&synth, block);
+		
+		for (int lane = 0; lane < LPC_LANES; lane++) {
+			if (synth.job[lane] < 0) continue;
+			
+			const lpcLaneJob_t *job = &jobs[synth.job[lane]];
+			const lpcFrame_t *frame = &job->frames[synth.frame[lane]];
+			int16_t *output = job->output + synth.frame[lane] * LPC_FRAME_SAMPLES;
+			for (int sample = 0; sample < LPC_FRAME_SAMPLES; sample++) output[sample] = (int16_t)block[sample][lane];
+			
+			synth.oldUnvoiced[lane] = (frame->type != LPC_FRAME_VOICED);
+			synth.oldSilent[lane] = (frame->type == LPC_FRAME_SILENT || frame->type == LPC_FRAME_STOP);
+			synth.frame[lane]++;
+		}
+	}
+}
+
+#undef LANE
+#undef LANE_NAME
+#undef LANE_PASTE
@@ -0,0 +1,81 @@
+/************************************************************************
+	lpclanes.c
+
+    Multi-voice synthesis with one word per SIMD lane
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <pthread.h>
+#include <string.h>
+
+#include "lpclanes.h"
+#include "lpcsynth.h"
+#include "lpctables.h"
+
+// Some useful definitions
+#define FALSE	0
+#define TRUE	1
+
+static const lpcTables_t *tables = &lpcTablesTms5220;
+
+// The noise LFSR is clocked 20 times per sample; being only 13 bits wide
+// its state after 20 clocks is precomputed for every state
+static uint16_t lfsrStep20[8192];
+static pthread_once_t lfsrOnce = PTHREAD_ONCE_INIT;
+
+static void lfsrInitialise(void)
+{
+	for (uint32_t state = 0; state < 8192; state++) {
+		uint32_t rng = state;
+		for (int i = 0; i < 20; i++) {
+			uint32_t bit = ((rng >> 12) ^ (rng >> 3) ^ (rng >> 2) ^ rng) & 1;
+			rng = ((rng << 1) | bit) & 0x1FFF;
+		}
+		lfsrStep20[state] = (uint16_t)rng;
+	}
+}
+
+// Instantiate the kernel for each supported lane count
+#define LPC_LANES 4
+#include "lpclanekernel.h"
+#undef LPC_LANES
+
+#define LPC_LANES 8
+#include "lpclanekernel.h"
+#undef LPC_LANES
+
+#define LPC_LANES 16
+#include "lpclanekernel.h"
+#undef LPC_LANES
+
+// Render jobs 4, 8 or 16 at a time
+int lpcLanesRender(int lanes, const lpcLaneJob_t *jobs, int jobCount)
+{
+	pthread_once(&lfsrOnce, lfsrInitialise);
+	
+	switch (lanes) {
+		case 4: render4(jobs, jobCount); return 0;
+		case 8: render8(jobs, jobCount); return 0;
+		case 16: render16(jobs, jobCount); return 0;
+	}
+	return -1;
+}
@@ -0,0 +1,50 @@
+/************************************************************************
+	lpclanes.h
+
+    Multi-voice synthesis with one word per SIMD lane
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef LPCLANES_H_
+#define LPCLANES_H_
+
+#include <stdint.h>
+
+#include "lpcframe.h"
+
+// The lattice is a serial chain within one voice, so instead of
+// vectorising a voice the lane renderer runs several words side by side,
+// one per vector lane, in step a frame at a time.  When a lane's word ends
+// the next word is loaded into it.  The arithmetic is the reference
+// synthesiser's, lane-wise, so every word is bit-exact with lpcSynthWord().
+
+// One word to render (output must hold frameCount * LPC_FRAME_SAMPLES)
+typedef struct {
+	const lpcFrame_t *frames;
+	int frameCount;
+	int16_t *output;
+} lpcLaneJob_t;
+
+// Render jobs 4, 8 or 16 at a time; returns 0 or -1 for other lane counts
+int lpcLanesRender(int lanes, const lpcLaneJob_t *jobs, int jobCount);
+
+#endif /* LPCLANES_H_ */
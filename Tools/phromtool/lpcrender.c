@@ -0,0 +1,126 @@
+/************************************************************************
+	lpcrender.c
+
+    Word rendering
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+
+#include "lpcrender.h"
+#include "lpcsynth.h"
+#include "lpctables.h"
+
+// Pack settings into a single value for use as (part of) a key
+uint32_t lpcSettingsKey(const lpcSettings_t *settings)
+{
+	// Chip (4 bits), frame samples (9), pitch offset (7), pitch scale (8)
+	return (settings->chip & 0xF) | (uint32_t)lpcFrameSamples(settings) << 4 |
+		(uint32_t)(settings->pitchOffset & 0x7F) << 13 | (uint32_t)lpcPitchScale(settings) << 20;
+}
+
+// Pitch scale in percent
+int lpcPitchScale(const lpcSettings_t *settings)
+{
+	return settings->pitchScale ? settings->pitchScale : 100;
+}
+
+// Percentage for a pitch scale factor (-1 if out of range)
+int lpcScalePercent(double scale)
+{
+	if (!(scale >= 0.5 && scale <= 2.0)) return -1;
+	return (int)(scale * 100 + 0.5);
+}
+
+// Samples each frame is played for
+int lpcFrameSamples(const lpcSettings_t *settings)
+{
+	return settings->frameSamples ? settings->frameSamples : LPC_FRAME_SAMPLES;
+}
+
+// Frame length for a speed (-1 if out of range)
+int lpcSpeedFrameSamples(double speed)
+{
+	if (!(speed >= 0.5 && speed <= 2.0)) return -1;
+	
+	int frameSamples = (int)(LPC_FRAME_SAMPLES / speed + 0.5);
+	if (frameSamples < LPC_MIN_FRAME_SAMPLES) frameSamples = LPC_MIN_FRAME_SAMPLES;
+	if (frameSamples > LPC_MAX_FRAME_SAMPLES) frameSamples = LPC_MAX_FRAME_SAMPLES;
+	return frameSamples;
+}
+
+// Parse a word in the frame format of the settings' chip
+int lpcParse(const lpcSettings_t *settings, const phromImage_t *image, uint32_t address,
+	lpcFrame_t *frames, int maxFrames, uint32_t *endBit)
+{
+	return lpcParseWordChip(settings->chip, image->data, PHROM_SIZE, address, frames, maxFrames, endBit);
+}
+
+// Render parsed frames with the given settings
+int lpcRender(const lpcSettings_t *settings, const lpcFrame_t *frames, int frameCount, int16_t *output)
+{
+	lpcVoice_t voice;
+	int sampleCount = 0;
+	
+	lpcVoiceInitialise(&voice, settings);
+	for (int i = 0; i < frameCount; i++) sampleCount += lpcVoiceFrame(&voice, &frames[i], output + sampleCount);
+	return sampleCount;
+}
+
+// Render several parsed words, through the lane renderer if asked
+int lpcRenderWords(const lpcSettings_t *settings, int lanes, const lpcLaneJob_t *jobs, int jobCount)
+{
+	if (lanes == 0) {
+		for (int i = 0; i < jobCount; i++) lpcRender(settings, jobs[i].frames, jobs[i].frameCount, jobs[i].output);
+		return 0;
+	}
+	
+	if (!lpcLanesSupported(settings, lanes)) return -1;
+	return lpcLanesRender(lanes, jobs, jobCount);
+}
+
+// The lane renderer is the reference synthesiser with the TMS5220's tables
+// and fixed frame timing
+int lpcLanesSupported(const lpcSettings_t *settings, int lanes)
+{
+	return (lanes == 4 || lanes == 8 || lanes == 16) && settings->chip == LPC_CHIP_TMS5220 &&
+		lpcFrameSamples(settings) == LPC_FRAME_SAMPLES && settings->pitchOffset == 0 &&
+		lpcPitchScale(settings) == 100;
+}
+
+void lpcVoiceInitialise(lpcVoice_t *voice, const lpcSettings_t *settings)
+{
+	voice->settings = *settings;
+	lpcSynthInitialiseChip(&voice->synth, settings->chip);
+	voice->synth.frameSamples = lpcFrameSamples(settings);
+	
+	// The remapped pitch table is built once per voice; the synthesiser
+	// only looks it up as each frame is loaded
+	if (settings->pitchOffset != 0 || lpcPitchScale(settings) != 100)
+		lpcPitchTable(settings->chip, settings->pitchOffset, lpcPitchScale(settings), voice->synth.pitchTable);
+}
+
+// Play one frame
+int lpcVoiceFrame(lpcVoice_t *voice, const lpcFrame_t *frame, int16_t *output)
+{
+	lpcSynthFrame(&voice->synth, frame, output);
+	return lpcFrameSamples(&voice->settings);
+}
@@ -0,0 +1,89 @@
+/************************************************************************
+	lpcrender.h
+
+    Word rendering
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef LPCRENDER_H_
+#define LPCRENDER_H_
+
+#include <stdint.h>
+
+#include "lpcframe.h"
+#include "lpclanes.h"
+#include "lpcsynth.h"
+#include "phromimage.h"
+
+// Everything that changes the rendered PCM of a word (and so forms part of
+// the key of any cached rendering)
+typedef struct {
+	uint8_t chip;			// LPC_CHIP_ variant (frame format and tables)
+	uint16_t frameSamples;	// Samples per frame (0 for LPC_FRAME_SAMPLES)
+	int8_t pitchOffset;		// Pitch index offset (see lpcPitchTable())
+	uint8_t pitchScale;		// Pitch scale in percent (0 for 100)
+} lpcSettings_t;
+
+// Pack settings into a single value for use as (part of) a key
+uint32_t lpcSettingsKey(const lpcSettings_t *settings);
+
+// Pitch scale in percent, and the percentage for a scale factor (0.5 to
+// 2.0; returns -1 outside that range)
+int lpcPitchScale(const lpcSettings_t *settings);
+int lpcScalePercent(double scale);
+
+// Samples each frame is played for, and the frame length for a speed
+// (0.5 to 2.0 times normal; returns -1 outside that range)
+int lpcFrameSamples(const lpcSettings_t *settings);
+int lpcSpeedFrameSamples(double speed);
+
+// Parse a word in the frame format of the settings' chip
+int lpcParse(const lpcSettings_t *settings, const phromImage_t *image, uint32_t address,
+	lpcFrame_t *frames, int maxFrames, uint32_t *endBit);
+
+// Render parsed frames with the given settings
+// Returns the number of samples written (frameCount * lpcFrameSamples())
+int lpcRender(const lpcSettings_t *settings, const lpcFrame_t *frames, int frameCount, int16_t *output);
+
+// Render several parsed words (each job's output must hold frameCount *
+// lpcFrameSamples()).  With lanes 0 each word goes through lpcRender();
+// with 4, 8 or 16 they go through the lane renderer, which is faster and
+// gives the same PCM but only handles the TMS5220 at normal speed and
+// pitch.  Returns 0, or -1 if the lanes cannot render the settings.
+int lpcRenderWords(const lpcSettings_t *settings, int lanes, const lpcLaneJob_t *jobs, int jobCount);
+
+// TRUE if lpcRenderWords() can render the settings with the lanes given
+int lpcLanesSupported(const lpcSettings_t *settings, int lanes);
+
+// A synthesiser played a frame at a time (for callers that interleave or
+// stream frames rather than rendering whole words)
+typedef struct {
+	lpcSettings_t settings;
+	lpcSynth_t synth;
+} lpcVoice_t;
+
+void lpcVoiceInitialise(lpcVoice_t *voice, const lpcSettings_t *settings);
+
+// Play one frame; returns the number of samples written
+int lpcVoiceFrame(lpcVoice_t *voice, const lpcFrame_t *frame, int16_t *output);
+
+#endif /* LPCRENDER_H_ */
@@ -0,0 +1,112 @@
+/************************************************************************
+	lpcstream.c
+
+    Incremental synthesis from a stream of PHROM bits
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <string.h>
+
+#include "lpcstream.h"
+#include "lpcdecode.h"
+#include "lpctables.h"
+
+void lpcStreamInitialise(lpcStream_t *stream, const lpcSettings_t *settings)
+{
+	memset(stream, 0, sizeof(lpcStream_t));
+	lpcVoiceInitialise(&stream->voice, settings);
+}
+
+// Write PHROM bytes
+int lpcStreamWrite(lpcStream_t *stream, const uint8_t *data, int count)
+{
+	int accepted = 0;
+	
+	while (accepted < count && !stream->stopped) {
+		// Decoding first keeps the bit buffer from filling while a whole
+		// frame is already waiting in it
+		if (stream->pcmStart == stream->pcmEnd) lpcStreamRead(stream, NULL, 0);
+		if (stream->reader.bufferBits > 56) break;
+		
+		// The byte's bits in serial order
+		bitReader_t byte = { data + accepted++, 1, 0, 0, 0 };
+		bitReaderAppend(&stream->reader, bitReaderLoad(&byte, 0), 8);
+	}
+	
+	return accepted;
+}
+
+// Write one serial bit
+int lpcStreamWriteBit(lpcStream_t *stream, int bit)
+{
+	if (stream->stopped) return 0;
+	if (stream->pcmStart == stream->pcmEnd) lpcStreamRead(stream, NULL, 0);
+	if (stream->reader.bufferBits == 64) return 0;
+	
+	bitReaderAppend(&stream->reader, (uint64_t)(bit & 1) << 63, 1);
+	return 1;
+}
+
+// Decode the next frame if all its bits are in; returns TRUE if it was
+static int decodeFrame(lpcStream_t *stream, lpcFrame_t *frame)
+{
+	const lpcChip_t *chip = lpcGetChip(stream->voice.settings.chip);
+	if (chip == NULL) chip = &lpcChipTms5220;
+	
+	if (!lpcDecodeFrame(chip, &stream->reader, stream->reader.bufferBits, stream->previousK, frame)) return 0;
+	stream->frames++;
+	if (frame->type == LPC_FRAME_STOP) stream->stopped = 1;
+	return 1;
+}
+
+// Read up to maxSamples of PCM
+int lpcStreamRead(lpcStream_t *stream, int16_t *output, int maxSamples)
+{
+	int total = 0;
+	
+	while (1) {
+		int available = stream->pcmEnd - stream->pcmStart;
+		if (available == 0) {
+			// Nothing after the stop frame is decoded (the stop frame
+			// itself is played as soon as it is decoded)
+			lpcFrame_t frame;
+			if (stream->stopped || !decodeFrame(stream, &frame)) break;
+			
+			stream->pcmStart = 0;
+			stream->pcmEnd = lpcVoiceFrame(&stream->voice, &frame, stream->pcm);
+			available = stream->pcmEnd;
+		}
+		
+		if (total == maxSamples) break;
+		if (available > maxSamples - total) available = maxSamples - total;
+		memcpy(output + total, stream->pcm + stream->pcmStart, available * sizeof(int16_t));
+		stream->pcmStart += available;
+		total += available;
+	}
+	
+	return total;
+}
+
+int lpcStreamFinished(const lpcStream_t *stream)
+{
+	return stream->stopped && stream->pcmStart == stream->pcmEnd;
+}
@@ -0,0 +1,73 @@
+/************************************************************************
+	lpcstream.h
+
+    Incremental synthesis from a stream of PHROM bits
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef LPCSTREAM_H_
+#define LPCSTREAM_H_
+
+#include <stdint.h>
+
+#include "bitreader.h"
+#include "lpcframe.h"
+#include "lpcrender.h"
+
+// Bytes (or single ADD8 bits) are written in as they arrive and PCM is
+// read out; each frame is decoded and played the moment its last bit is
+// in.  The stream holds at most 64 bits of undecoded data and one frame
+// of unread PCM, so output trails input by less than a frame.
+//
+// A word produces exactly the PCM lpcRender() gives for its parsed frames
+// (including the stop frame).
+
+typedef struct {
+	lpcVoice_t voice;
+	bitReader_t reader;		// Undecoded bits (bufferBits of them) and the
+							// bits consumed by decoded frames (bitPointer)
+	uint8_t previousK[10];
+	uint8_t stopped;		// The stop frame has been decoded
+	int16_t pcm[LPC_MAX_FRAME_SAMPLES];
+	int pcmStart, pcmEnd;	// Unread PCM
+	uint32_t frames;		// Frames decoded
+} lpcStream_t;
+
+// Start a new word (the synthesiser is reset)
+void lpcStreamInitialise(lpcStream_t *stream, const lpcSettings_t *settings);
+
+// Write PHROM bytes (each shifted out LSB first); returns the number
+// accepted, which is less than count when the stream needs reading or has
+// reached the stop frame
+int lpcStreamWrite(lpcStream_t *stream, const uint8_t *data, int count);
+
+// Write one serial bit (as seen on ADD8); returns 1 if accepted
+int lpcStreamWriteBit(lpcStream_t *stream, int bit);
+
+// Read up to maxSamples of PCM; returns the number read (0 when more
+// input is needed or the word has finished)
+int lpcStreamRead(lpcStream_t *stream, int16_t *output, int maxSamples);
+
+// TRUE once the stop frame has been played and all PCM read
+int lpcStreamFinished(const lpcStream_t *stream);
+
+#endif /* LPCSTREAM_H_ */
@@ -0,0 +1,218 @@
+/************************************************************************
+	lpcsynth.c
+
+    Bit-exact TMS5220 LPC synthesiser
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+// Note: This is the reference synthesiser; its output is what the TMS5220
+// produces on its DAC (in 16-bit form) and any faster renderer is judged
+// against it.  Keep it integer only.
+
+#include <string.h>
+
+#include "lpcsynth.h"
+#include "lpctables.h"
+
+// Some useful definitions
+#define FALSE	0
+#define TRUE	1
+
+// The frame player is instantiated for each distinct set of tables (see
+// playFrame()); these helpers are always inlined into it so that every
+// table access is to a constant address
+#define SPECIALISED	static inline __attribute__((always_inline))
+
+void lpcSynthInitialise(lpcSynth_t *synth)
+{
+	lpcSynthInitialiseChip(synth, LPC_CHIP_TMS5220);
+}
+
+void lpcSynthInitialiseChip(lpcSynth_t *synth, int chip)
+{
+	int i;
+	
+	synth->chip = (uint8_t)chip;
+	synth->frameSamples = LPC_FRAME_SAMPLES;
+	memcpy(synth->pitchTable, (lpcGetChip(chip) ? lpcGetChip(chip) : &lpcChipTms5220)->tables->pitch, sizeof(synth->pitchTable));
+	
+	synth->energy = synth->pitch = 0;
+	synth->targetEnergy = synth->targetPitch = 0;
+	for (i = 0; i < 10; i++) synth->k[i] = synth->targetK[i] = synth->x[i] = 0;
+	for (i = 0; i < 11; i++) synth->u[i] = 0;
+	
+	synth->previousEnergy = 0;
+	synth->pitchCount = 0;
+	synth->rng = 0x1FFF;
+	
+	// The chip starts from silence
+	synth->oldUnvoiced = TRUE;
+	synth->oldSilent = TRUE;
+	synth->inhibit = FALSE;
+}
+
+// Multiply a 10-bit coefficient by a 15-bit sample as the lattice
+// multiplier does (both operands wrap, the product is truncated)
+SPECIALISED int32_t matrixMultiply(int32_t a, int32_t b)
+{
+	a = ((a + 512) & 0x3FF) - 512;
+	b = ((b + 16384) & 0x7FFF) - 16384;
+	return (a * b) >> 9;
+}
+
+// Clip the 14-bit lattice output to the DAC's 12 bits and scale to 16
+SPECIALISED int16_t clipAnalog(int32_t sample)
+{
+	if (sample > 2047) sample = 2047;
+	else if (sample < -2048) sample = -2048;
+	
+	// The DAC only takes the top 8 bits
+	sample &= ~0xF;
+	return (int16_t)((sample * 16) | ((sample & 0x7F0) >> 3) | ((sample & 0x400) >> 10));
+}
+
+// Load the targets for a new frame
+SPECIALISED void loadFrame(lpcSynth_t *synth, const lpcFrame_t *frame, const lpcTables_t *tables)
+{
+	uint8_t newUnvoiced = (frame->type != LPC_FRAME_VOICED);
+	uint8_t newSilent = (frame->type == LPC_FRAME_SILENT || frame->type == LPC_FRAME_STOP);
+	int i;
+	
+	if (newSilent) {
+		// Silent and stop frames ramp everything to zero
+		synth->targetEnergy = 0;
+		synth->targetPitch = 0;
+		for (i = 0; i < 10; i++) synth->targetK[i] = 0;
+	} else {
+		synth->targetEnergy = tables->energy[frame->energy];
+		synth->targetPitch = synth->pitchTable[frame->pitch];
+		for (i = 0; i < 4; i++) synth->targetK[i] = tables->k[i][frame->k[i]];
+		for (i = 4; i < 10; i++) synth->targetK[i] = newUnvoiced ? 0 : tables->k[i][frame->k[i]];
+	}
+	
+	// Interpolation is inhibited across voiced/unvoiced transitions and
+	// out of silence; the parameters then jump at the last sub-frame
+	synth->inhibit = (synth->oldUnvoiced != newUnvoiced) || (synth->oldSilent && !newSilent);
+}
+
+// Step the interpolated parameters towards their targets
+SPECIALISED void interpolate(lpcSynth_t *synth, int shift)
+{
+	synth->energy += (synth->targetEnergy - synth->energy) >> shift;
+	synth->pitch += (synth->targetPitch - synth->pitch) >> shift;
+	for (int i = 0; i < 10; i++) synth->k[i] += (synth->targetK[i] - synth->k[i]) >> shift;
+}
+
+// Generate a single sample
+SPECIALISED int16_t generateSample(lpcSynth_t *synth, const lpcTables_t *tables)
+{
+	int32_t excitation;
+	int i;
+	
+	if (synth->oldUnvoiced) {
+		// Unvoiced: the 13-bit LFSR is clocked 20 times per sample
+		for (i = 0; i < 20; i++) {
+			uint32_t bit = ((synth->rng >> 12) ^ (synth->rng >> 3) ^ (synth->rng >> 2) ^ synth->rng) & 1;
+			synth->rng = ((synth->rng << 1) | bit) & 0x1FFF;
+		}
+		excitation = (synth->rng & 1) ? -64 : 64;
+	} else {
+		// Voiced: play the chirp once per pitch period
+		excitation = tables->chirp[synth->pitchCount > 51 ? 51 : synth->pitchCount];
+	}
+	
+	synth->pitchCount++;
+	if (synth->pitchCount >= (uint32_t)synth->pitch) synth->pitchCount = 0;
+	synth->pitchCount &= 0x1FF;
+	
+	// Lattice filter - forward path then backward path
+	synth->u[10] = matrixMultiply(synth->previousEnergy, excitation * 64);
+	for (i = 9; i >= 0; i--) synth->u[i] = synth->u[i + 1] - matrixMultiply(synth->k[i], synth->x[i]);
+	for (i = 9; i >= 1; i--) synth->x[i] = synth->x[i - 1] + matrixMultiply(synth->k[i - 1], synth->u[i - 1]);
+	synth->x[0] = synth->u[0];
+	
+	synth->previousEnergy = synth->energy;
+	
+	// The lattice output wraps at 15 bits before reaching the DAC
+	return clipAnalog(((synth->u[0] + 16384) & 0x7FFF) - 16384);
+}
+
+// Play one frame into frameSamples samples of output
+SPECIALISED void playFrame(lpcSynth_t *synth, const lpcFrame_t *frame, int16_t *output, const lpcTables_t *tables)
+{
+	loadFrame(synth, frame, tables);
+	
+	for (int subframe = 0; subframe < LPC_SUBFRAMES; subframe++) {
+		if (!synth->inhibit || subframe == LPC_SUBFRAMES - 1)
+			interpolate(synth, tables->interpolationShift[subframe]);
+		
+		// Sub-frames are LPC_SUBFRAME_SAMPLES long at normal speed
+		int samples = (subframe + 1) * synth->frameSamples / LPC_SUBFRAMES - subframe * synth->frameSamples / LPC_SUBFRAMES;
+		for (int i = 0; i < samples; i++) *output++ = generateSample(synth, tables);
+	}
+	
+	synth->oldUnvoiced = (frame->type != LPC_FRAME_VOICED);
+	synth->oldSilent = (frame->type == LPC_FRAME_SILENT || frame->type == LPC_FRAME_STOP);
+}
+
+static void playFrameTms5220(lpcSynth_t *synth, const lpcFrame_t *frame, int16_t *output)
+{
+	playFrame(synth, frame, output, lpcChipTms5220.tables);
+}
+
+static void playFrameTms5200(lpcSynth_t *synth, const lpcFrame_t *frame, int16_t *output)
+{
+	playFrame(synth, frame, output, lpcChipTms5200.tables);
+}
+
+static void playFrameTms5110(lpcSynth_t *synth, const lpcFrame_t *frame, int16_t *output)
+{
+	playFrame(synth, frame, output, lpcChipTms5110.tables);
+}
+
+// Play one frame into frameSamples samples of output
+void lpcSynthFrame(lpcSynth_t *synth, const lpcFrame_t *frame, int16_t *output)
+{
+	// The TMS5220C shares the TMS5220's tables
+	switch (synth->chip) {
+		case LPC_CHIP_TMS5200: playFrameTms5200(synth, frame, output); break;
+		case LPC_CHIP_TMS5110: playFrameTms5110(synth, frame, output); break;
+		default: playFrameTms5220(synth, frame, output); break;
+	}
+}
+
+// Play a parsed word
+int lpcSynthWord(const lpcFrame_t *frames, int frameCount, int16_t *output)
+{
+	return lpcSynthWordChip(LPC_CHIP_TMS5220, frames, frameCount, output);
+}
+
+// Play a parsed word on a chip variant
+int lpcSynthWordChip(int chip, const lpcFrame_t *frames, int frameCount, int16_t *output)
+{
+	lpcSynth_t synth;
+	
+	lpcSynthInitialiseChip(&synth, chip);
+	for (int i = 0; i < frameCount; i++) lpcSynthFrame(&synth, &frames[i], output + i * LPC_FRAME_SAMPLES);
+	
+	return frameCount * LPC_FRAME_SAMPLES;
+}
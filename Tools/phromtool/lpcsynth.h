@@ -0,0 +1,91 @@
+/************************************************************************
+	lpcsynth.h
+
+    Bit-exact TMS5220 LPC synthesiser
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef LPCSYNTH_H_
+#define LPCSYNTH_H_
+
+#include <stdint.h>
+
+#include "lpcframe.h"
+
+// Each frame is played as 8 interpolation sub-frames of 25 samples
+#define LPC_SUBFRAMES			8
+#define LPC_SUBFRAME_SAMPLES	(LPC_FRAME_SAMPLES / LPC_SUBFRAMES)
+
+// Output sample rate
+#define LPC_SAMPLE_RATE			8000
+
+// Speech is time-scaled by changing the number of samples each frame is
+// played for (the sub-frames share them out, so interpolation still takes
+// 8 steps and the pitch is unchanged).  LPC_FRAME_SAMPLES is normal speed;
+// the limits are 2x and 0.5x.
+#define LPC_MIN_FRAME_SAMPLES	(LPC_FRAME_SAMPLES / 2)
+#define LPC_MAX_FRAME_SAMPLES	(LPC_FRAME_SAMPLES * 2)
+
+// Synthesiser state - this follows the TMS5220 datapath: 12 parameters
+// interpolated towards the frame targets, a chirp or LFSR noise excitation
+// and a 10 stage lattice filter with the chip's fixed-point truncation
+typedef struct {
+	// Current (interpolated) and target parameters
+	int32_t energy, pitch, k[10];
+	int32_t targetEnergy, targetPitch, targetK[10];
+	
+	// Excitation state
+	int32_t previousEnergy;
+	uint32_t pitchCount;
+	uint32_t rng;
+	
+	// Lattice filter state
+	int32_t u[11], x[10];
+	
+	// Flags of the previously played frame
+	uint8_t oldUnvoiced, oldSilent;
+	uint8_t inhibit;
+	
+	// Chip variant whose tables are used (an LPC_CHIP_ number)
+	uint8_t chip;
+	
+	// Samples per frame (LPC_FRAME_SAMPLES unless set after initialising)
+	uint16_t frameSamples;
+	
+	// Pitch index to period (the chip's table unless replaced after
+	// initialising, e.g. by lpcPitchTable())
+	int16_t pitchTable[64];
+} lpcSynth_t;
+
+// Initialise for a TMS5220 or for the given chip variant
+void lpcSynthInitialise(lpcSynth_t *synth);
+void lpcSynthInitialiseChip(lpcSynth_t *synth, int chip);
+
+// Play one frame into frameSamples samples of output
+void lpcSynthFrame(lpcSynth_t *synth, const lpcFrame_t *frame, int16_t *output);
+
+// Play a parsed word (frameCount * LPC_FRAME_SAMPLES samples of output)
+// Returns the number of samples written
+int lpcSynthWord(const lpcFrame_t *frames, int frameCount, int16_t *output);
+int lpcSynthWordChip(int chip, const lpcFrame_t *frames, int frameCount, int16_t *output);
+
+#endif /* LPCSYNTH_H_ */
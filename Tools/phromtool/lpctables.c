@@ -0,0 +1,175 @@
+/************************************************************************
+	lpctables.c
+
+    TMS5220 family coefficient ROM tables
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <stddef.h>
+#include <strings.h>
+
+#include "lpctables.h"
+
+// The energy, K, chirp and interpolation ROMs are common to the family;
+// the TMS5200 and TMS5110 differ in their pitch tables (and the TMS5110 in
+// having a 5-bit pitch field).  The TMS5220C uses the TMS5220's tables.
+#define LPC_ENERGY_TABLE \
+	{   0,   1,   2,   3,   4,   6,   8,  11, \
+	   16,  23,  33,  47,  63,  85, 114,   0 }
+
+#define LPC_K_TABLES \
+	{ \
+		{ -501, -498, -497, -495, -493, -491, -488, -482, \
+		  -478, -474, -469, -464, -459, -452, -445, -437, \
+		  -412, -380, -339, -288, -227, -158,  -81,   -1, \
+		    80,  157,  226,  287,  337,  379,  411,  436 }, \
+		{ -328, -303, -274, -244, -211, -175, -138,  -99, \
+		   -59,  -18,   24,   64,  105,  143,  180,  215, \
+		   248,  278,  306,  331,  354,  374,  392,  408, \
+		   422,  435,  445,  455,  463,  470,  476,  506 }, \
+		{ -441, -387, -333, -279, -225, -171, -117,  -63, \
+		    -9,   45,   98,  152,  206,  260,  314,  368 }, \
+		{ -328, -273, -217, -161, -106,  -50,    5,   61, \
+		   116,  172,  228,  283,  339,  394,  450,  506 }, \
+		{ -328, -282, -235, -189, -142,  -96,  -50,   -3, \
+		    43,   90,  136,  182,  229,  275,  322,  368 }, \
+		{ -256, -212, -168, -123,  -79,  -35,   10,   54, \
+		    98,  143,  187,  232,  276,  320,  365,  409 }, \
+		{ -308, -260, -212, -164, -117,  -69,  -21,   27, \
+		    75,  122,  170,  218,  266,  314,  361,  409 }, \
+		{ -256, -161,  -66,   29,  124,  219,  314,  409 }, \
+		{ -256, -176,  -96,  -15,   65,  146,  226,  307 }, \
+		{ -205, -132,  -59,   14,   87,  160,  234,  307 }, \
+	}
+
+#define LPC_CHIRP_TABLE \
+	{ 0x00, 0x03, 0x0F, 0x28, 0x4C, 0x6C, 0x71, 0x50, \
+	  0x25, 0x26, 0x4C, 0x44, 0x1A, 0x32, 0x3B, 0x13, \
+	  0x37, 0x1A, 0x25, 0x1F, 0x1D, 0x00, 0x00, 0x00, \
+	  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, \
+	  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, \
+	  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, \
+	  0x00, 0x00, 0x00, 0x00 }
+
+#define LPC_INTERPOLATION_SHIFTS \
+	{ 3, 3, 3, 2, 2, 1, 1, 0 }
+
+// Tables as decapped from the TMS5220 (as also used by the MAME emulation)
+const lpcTables_t lpcTablesTms5220 = {
+	// Energy
+	LPC_ENERGY_TABLE,
+	
+	// Pitch
+	{   0,  15,  16,  17,  18,  19,  20,  21,
+	   22,  23,  24,  25,  26,  27,  28,  29,
+	   30,  31,  32,  33,  34,  35,  36,  37,
+	   38,  39,  40,  41,  42,  44,  46,  48,
+	   50,  52,  53,  56,  58,  60,  62,  65,
+	   68,  70,  72,  76,  78,  80,  84,  86,
+	   91,  94,  98, 101, 105, 109, 114, 118,
+	  122, 127, 132, 137, 142, 148, 153, 159 },
+	
+	// K1-K10
+	LPC_K_TABLES,
+	
+	// Chirp
+	LPC_CHIRP_TABLE,
+	
+	// Interpolation shifts (the last sub-frame lands on the target)
+	LPC_INTERPOLATION_SHIFTS
+};
+
+// TMS5200 (the TMS5220's predecessor, whose pitch ROM reaches longer
+// periods); pitch table as used by the MAME emulation
+const lpcTables_t lpcTablesTms5200 = {
+	LPC_ENERGY_TABLE,
+	
+	// Pitch
+	{   0,  14,  15,  16,  17,  18,  19,  20,
+	   21,  22,  23,  24,  25,  26,  27,  28,
+	   29,  30,  31,  32,  34,  36,  38,  40,
+	   41,  43,  45,  48,  49,  51,  54,  55,
+	   57,  60,  62,  64,  68,  72,  74,  76,
+	   81,  85,  87,  90,  96,  99, 103, 107,
+	  112, 117, 122, 127, 133, 139, 145, 151,
+	  157, 164, 171, 178, 186, 194, 202, 211 },
+	
+	LPC_K_TABLES,
+	LPC_CHIRP_TABLE,
+	LPC_INTERPOLATION_SHIFTS
+};
+
+// TMS5110 (5-bit pitch field, so only the first 32 pitch entries are
+// reachable); pitch table as used by the MAME emulation
+const lpcTables_t lpcTablesTms5110 = {
+	LPC_ENERGY_TABLE,
+	
+	// Pitch
+	{   0,  15,  16,  17,  19,  21,  22,  25,
+	   26,  29,  32,  36,  40,  42,  46,  50,
+	   55,  60,  64,  68,  72,  76,  80,  84,
+	   88,  92,  96, 100, 104, 108, 112, 116 },
+	
+	LPC_K_TABLES,
+	LPC_CHIRP_TABLE,
+	LPC_INTERPOLATION_SHIFTS
+};
+
+static const lpcChip_t *chips[LPC_CHIPS] = {
+	&lpcChipTms5220, &lpcChipTms5200, &lpcChipTms5220c, &lpcChipTms5110
+};
+
+// Descriptor of a chip number (NULL if out of range)
+const lpcChip_t *lpcGetChip(int chip)
+{
+	if (chip < 0 || chip >= LPC_CHIPS) return NULL;
+	return chips[chip];
+}
+
+// Build a chip's pitch table with the voice moved
+void lpcPitchTable(int chip, int offset, int scale, int16_t table[64])
+{
+	const lpcChip_t *descriptor = lpcGetChip(chip) ? lpcGetChip(chip) : &lpcChipTms5220;
+	int last = (1 << descriptor->pitchBits) - 1;
+	
+	table[0] = 0;
+	for (int i = 1; i < 64; i++) {
+		int index = i + offset;
+		if (index < 1) index = 1;
+		if (index > last) index = last;
+		
+		// The period must fit the 9-bit pitch counter and be long enough
+		// to play some of the chirp
+		int period = (descriptor->tables->pitch[index] * 100 + scale / 2) / scale;
+		if (period < 8) period = 8;
+		if (period > 511) period = 511;
+		table[i] = (int16_t)period;
+	}
+}
+
+// Chip number of a name (-1 if unknown)
+int lpcFindChip(const char *name)
+{
+	for (int i = 0; i < LPC_CHIPS; i++)
+		if (strcasecmp(name, chips[i]->name) == 0) return i;
+	return -1;
+}
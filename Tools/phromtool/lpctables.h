@@ -0,0 +1,84 @@
+/************************************************************************
+	lpctables.h
+
+    TMS5220 coefficient ROM tables
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef LPCTABLES_H_
+#define LPCTABLES_H_
+
+#include <stdint.h>
+
+// The speech chip decodes the frame indexes through these ROM tables
+typedef struct {
+	int16_t energy[16];		// Energy index to amplitude
+	int16_t pitch[64];		// Pitch index to period (in samples)
+	int16_t k[10][32];		// K1-K10 index to reflection coefficient (Q9)
+	int8_t chirp[52];		// Voiced excitation waveform
+	uint8_t interpolationShift[8];	// Interpolation step shifts per sub-frame
+} lpcTables_t;
+
+extern const lpcTables_t lpcTablesTms5220;
+extern const lpcTables_t lpcTablesTms5200;
+extern const lpcTables_t lpcTablesTms5110;
+
+// Speech chip variants
+#define LPC_CHIP_TMS5220	0
+#define LPC_CHIP_TMS5200	1
+#define LPC_CHIP_TMS5220C	2
+#define LPC_CHIP_TMS5110	3
+#define LPC_CHIPS			4
+
+// A chip variant: its ROM tables and the widths of its frame fields
+typedef struct {
+	const char *name;
+	uint8_t pitchBits;				// 6 (64 periods) or 5 on the TMS5110
+	uint8_t kBits[10];				// K1-K10 field widths
+	const lpcTables_t *tables;
+} lpcChip_t;
+
+// The descriptors are defined here (rather than in lpctables.c) so that
+// code specialised on a chip sees them as constants: passing one of these
+// to an always_inline function folds the field widths and table addresses
+// into the instantiated loop
+static const lpcChip_t lpcChipTms5220 = {
+	"tms5220", 6, { 5, 5, 4, 4, 4, 4, 4, 3, 3, 3 }, &lpcTablesTms5220 };
+static const lpcChip_t lpcChipTms5200 = {
+	"tms5200", 6, { 5, 5, 4, 4, 4, 4, 4, 3, 3, 3 }, &lpcTablesTms5200 };
+static const lpcChip_t lpcChipTms5220c = {
+	"tms5220c", 6, { 5, 5, 4, 4, 4, 4, 4, 3, 3, 3 }, &lpcTablesTms5220 };
+static const lpcChip_t lpcChipTms5110 = {
+	"tms5110", 5, { 5, 5, 4, 4, 4, 4, 4, 3, 3, 3 }, &lpcTablesTms5110 };
+
+// Descriptor of a chip number (NULL if out of range) and the chip number
+// of a name (-1 if unknown)
+const lpcChip_t *lpcGetChip(int chip);
+int lpcFindChip(const char *name);
+
+// Build a chip's pitch table with the voice moved: each voiced index is
+// offset by offset table steps (positive is lower) and the resulting
+// period divided by scale percent (above 100 is higher).  Index 0 stays
+// unvoiced.
+void lpcPitchTable(int chip, int offset, int scale, int16_t table[64]);
+
+#endif /* LPCTABLES_H_ */
@@ -0,0 +1,1744 @@
+/************************************************************************
+	main.c
+
+    PHROM host tool (for use with TMS6100 PHROM images)
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+// This is a host-side companion to the emulator firmware.  It works on
+// the same phromData images and decodes the TMS5220 LPC speech within them.
+//
+// Build with: cc -O2 -pthread -o phromtool *.c -lm
+
+// Global includes
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "phromimage.h"
+#include "lpcframe.h"
+#include "lpctables.h"
+#include "lpcsynth.h"
+#include "lpcrender.h"
+#include "lpclanes.h"
+#include "batchrender.h"
+#include "wordscan.h"
+#include "phrase.h"
+#include "pcmcache.h"
+#include "samplebank.h"
+#include "resampler.h"
+#include "speechd.h"
+#include "latency.h"
+#include "scheduler.h"
+#include "lpcstream.h"
+#include "bustrace.h"
+#include "frameindex.h"
+#include "lpcencode.h"
+#include "pitchtrack.h"
+#include "corpus.h"
+#include "phrombuild.h"
+#include "wavfile.h"
+
+static lpcFrame_t frames[LPC_MAX_WORD_FRAMES];
+static int16_t samples[LPC_MAX_WORD_FRAMES * LPC_MAX_FRAME_SAMPLES];
+
+// Speech chip the image's frames are for (--chip)
+static int chipVariant = LPC_CHIP_TMS5220;
+static int chipGiven;
+
+// Return the current time in microseconds
+static double microseconds(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+// The plural suffix for a count ("1 thread", "4 threads")
+static const char *plural(int count)
+{
+	return count == 1 ? "" : "s";
+}
+
+// Resolve a word argument; 0x prefixed values are addresses, otherwise
+// a listed word number.  Returns the address or -1.
+static int32_t resolveWord(const phromImage_t *image, const char *argument)
+{
+	char *end;
+	uint32_t value = strtoul(argument, &end, 0);
+	if (*end != '\0') return -1;
+	
+	if (strncmp(argument, "0x", 2) == 0 || strncmp(argument, "0X", 2) == 0) {
+		if (value >= PHROM_SIZE) return -1;
+		return value;
+	}
+	
+	const phromWord_t *word = phromFindWordNumber(image, value);
+	return word ? word->address : -1;
+}
+
+// Remove an option from the arguments, returning TRUE if it was present
+static int takeOption(int *argc, char *argv[], const char *option)
+{
+	for (int i = 0; i < *argc; i++) {
+		if (strcmp(argv[i], option) == 0) {
+			for (int j = i; j < *argc - 1; j++) argv[j] = argv[j + 1];
+			*argc -= 1;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Remove a numeric option and its value, returning the value (or
+// defaultValue if the option was not present)
+static long takeValue(int *argc, char *argv[], const char *option, long defaultValue)
+{
+	for (int i = 0; i + 1 < *argc; i++) {
+		if (strcmp(argv[i], option) == 0) {
+			long value = strtol(argv[i + 1], NULL, 0);
+			for (int j = i; j + 2 < *argc; j++) argv[j] = argv[j + 2];
+			*argc -= 2;
+			return value;
+		}
+	}
+	return defaultValue;
+}
+
+// Remove a real-valued option and its value, returning the value (or
+// defaultValue if the option was not present)
+static double takeReal(int *argc, char *argv[], const char *option, double defaultValue)
+{
+	for (int i = 0; i + 1 < *argc; i++) {
+		if (strcmp(argv[i], option) == 0) {
+			double value = strtod(argv[i + 1], NULL);
+			for (int j = i; j + 2 < *argc; j++) argv[j] = argv[j + 2];
+			*argc -= 2;
+			return value;
+		}
+	}
+	return defaultValue;
+}
+
+// Remove a string option and its value, returning the value (or NULL if
+// the option was not present)
+static const char *takeString(int *argc, char *argv[], const char *option)
+{
+	for (int i = 0; i + 1 < *argc; i++) {
+		if (strcmp(argv[i], option) == 0) {
+			const char *value = argv[i + 1];
+			for (int j = i; j + 2 < *argc; j++) argv[j] = argv[j + 2];
+			*argc -= 2;
+			return value;
+		}
+	}
+	return NULL;
+}
+
+// Take the --speed, --pitch and --pitch-scale options into settings;
+// returns -1 if any is out of range
+static int takeVoice(int *argc, char *argv[], lpcSettings_t *settings)
+{
+	int frameSamples = lpcSpeedFrameSamples(takeReal(argc, argv, "--speed", 1.0));
+	int offset = takeValue(argc, argv, "--pitch", 0);
+	int scale = lpcScalePercent(takeReal(argc, argv, "--pitch-scale", 1.0));
+	
+	if (frameSamples < 0 || offset < -63 || offset > 63 || scale < 0) {
+		fprintf(stderr, "--speed and --pitch-scale must be from 0.5 to 2 and --pitch from -63 to 63\n");
+		return -1;
+	}
+	settings->frameSamples = frameSamples;
+	settings->pitchOffset = offset;
+	settings->pitchScale = scale;
+	return 0;
+}
+
+// Take the --lanes option (0, the reference synthesiser, if not given);
+// returns -1 if the lane renderer cannot render the settings
+static int takeLanes(int *argc, char *argv[], const lpcSettings_t *settings)
+{
+	int lanes = takeValue(argc, argv, "--lanes", 0);
+	if (lanes == 0 || lpcLanesSupported(settings, lanes)) return lanes;
+	
+	if (lanes != 4 && lanes != 8 && lanes != 16) fprintf(stderr, "--lanes must be 4, 8 or 16\n");
+	else fprintf(stderr, "The lane renderer only supports the TMS5220 at normal speed and pitch\n");
+	return -1;
+}
+
+// phromtool frames <image> <word> - print the frames of a word
+static int commandFrames(const phromImage_t *image, int argc, char *argv[])
+{
+	static const char *typeNames[] = { "silent", "unvoiced", "voiced", "stop" };
+	
+	if (argc < 1) return -1;
+	int32_t address = resolveWord(image, argv[0]);
+	if (address < 0) {
+		fprintf(stderr, "Unknown word %s\n", argv[0]);
+		return 1;
+	}
+	
+	uint32_t endBit;
+	int frameCount = lpcParseWordChip(chipVariant, image->data, PHROM_SIZE, address, frames, LPC_MAX_WORD_FRAMES, &endBit);
+	if (frameCount < 0) {
+		fprintf(stderr, "Word at 0x%04X does not parse (error %d)\n", address, frameCount);
+		return 1;
+	}
+	
+	for (int i = 0; i < frameCount; i++) {
+		lpcFrame_t *frame = &frames[i];
+		printf("%4d %-8s E=%2d R=%d P=%2d K=", i, typeNames[frame->type], frame->energy, frame->repeat, frame->pitch);
+		for (int k = 0; k < 10; k++) printf("%s%2d", k ? "," : "", frame->k[k]);
+		printf("\n");
+	}
+	
+	printf("Word at 0x%04X: %d frames, %u bits (ends at 0x%04X)\n",
+		address, frameCount, endBit - address * 8, (endBit + 7) / 8);
+	return 0;
+}
+
+// phromtool parse <image> - parse every listed word and report the timing
+static int commandParse(const phromImage_t *image, int argc, char *argv[])
+{
+	int passes = 1000;
+	int totalFrames = 0, failures = 0;
+	(void)argc; (void)argv;
+	
+	for (int i = 0; i < image->wordCount; i++) {
+		int frameCount = lpcParseWordChip(chipVariant, image->data, PHROM_SIZE, image->words[i].address, frames, LPC_MAX_WORD_FRAMES, NULL);
+		if (frameCount < 0) {
+			printf("%3d 0x%04X %-16s does not parse (error %d)\n", image->words[i].number,
+				image->words[i].address, image->words[i].word, frameCount);
+			failures++;
+		} else {
+			totalFrames += frameCount;
+		}
+	}
+	
+	double start = microseconds();
+	for (int pass = 0; pass < passes; pass++) {
+		for (int i = 0; i < image->wordCount; i++)
+			lpcParseWordChip(chipVariant, image->data, PHROM_SIZE, image->words[i].address, frames, LPC_MAX_WORD_FRAMES, NULL);
+	}
+	double elapsed = (microseconds() - start) / passes;
+	
+	printf("%s: %d words, %d frames, %d failures, %.1f us per image\n",
+		image->name, image->wordCount, totalFrames, failures, elapsed);
+	return failures ? 1 : 0;
+}
+
+// Time rendering every listed word through the lane renderer against the
+// reference, checking that both produce the same samples
+static int synthLanes(const phromImage_t *image, int lanes)
+{
+	lpcFrame_t *wordFrames = malloc(sizeof(lpcFrame_t) * image->wordCount * LPC_MAX_WORD_FRAMES);
+	lpcLaneJob_t *jobs = calloc(image->wordCount, sizeof(lpcLaneJob_t));
+	int16_t *pcm = NULL, *reference = NULL;
+	long totalFrames = 0;
+	int result = 1;
+	
+	if (wordFrames == NULL || jobs == NULL) goto done;
+	
+	for (int i = 0; i < image->wordCount; i++) {
+		jobs[i].frames = wordFrames + totalFrames;
+		jobs[i].frameCount = lpcParseWord(image->data, PHROM_SIZE, image->words[i].address,
+			wordFrames + totalFrames, LPC_MAX_WORD_FRAMES, NULL);
+		if (jobs[i].frameCount < 0) jobs[i].frameCount = 0;
+		totalFrames += jobs[i].frameCount;
+	}
+	
+	long totalSamples = totalFrames * LPC_FRAME_SAMPLES;
+	pcm = malloc(sizeof(int16_t) * totalSamples);
+	reference = malloc(sizeof(int16_t) * totalSamples);
+	if (pcm == NULL || reference == NULL) goto done;
+	
+	for (int i = 0; i < image->wordCount; i++)
+		jobs[i].output = pcm + (jobs[i].frames - wordFrames) * LPC_FRAME_SAMPLES;
+	
+	double start = microseconds();
+	for (int i = 0; i < image->wordCount; i++)
+		lpcSynthWord(jobs[i].frames, jobs[i].frameCount, reference + (jobs[i].frames - wordFrames) * LPC_FRAME_SAMPLES);
+	double scalar = (microseconds() - start) / 1e6;
+	
+	start = microseconds();
+	if (lpcLanesRender(lanes, jobs, image->wordCount) != 0) {
+		fprintf(stderr, "--lanes must be 4, 8 or 16\n");
+		goto done;
+	}
+	double elapsed = (microseconds() - start) / 1e6;
+	
+	long mismatches = 0;
+	for (long i = 0; i < totalSamples; i++) if (pcm[i] != reference[i]) mismatches++;
+	
+	double audio = (double)totalSamples / LPC_SAMPLE_RATE;
+	printf("%s: %d words, %.1f seconds of speech rendered in %.1f ms (%.0fx real time, %d lanes)\n",
+		image->name, image->wordCount, audio, elapsed * 1e3, audio / elapsed, lanes);
+	printf("Reference renderer took %.1f ms (%.2fx speed-up), %s\n", scalar * 1e3, scalar / elapsed,
+		mismatches ? "OUTPUT DIFFERS" : "output is identical");
+	if (mismatches) fprintf(stderr, "%ld samples differ from the reference\n", mismatches);
+	result = mismatches ? 1 : 0;
+	
+done:
+	free(wordFrames);
+	free(jobs);
+	free(pcm);
+	free(reference);
+	return result;
+}
+
+// phromtool synth <image> [<word> <file.raw>] [--lanes N] [--speed X]
+// [--pitch N] [--pitch-scale X] - render a word to raw 16-bit PCM or, without a word, render every listed
+// word and report the timing (through N-word SIMD lanes with --lanes)
+static int commandSynth(const phromImage_t *image, int argc, char *argv[])
+{
+	lpcSettings_t settings = { chipVariant, 0, 0, 0 };
+	if (takeVoice(&argc, argv, &settings) != 0) return 1;
+	int lanes = takeLanes(&argc, argv, &settings);
+	if (lanes < 0) return 1;
+	
+	if (argc >= 2) {
+		int32_t address = resolveWord(image, argv[0]);
+		int frameCount = (address < 0) ? -1 :
+			lpcParseWordChip(chipVariant, image->data, PHROM_SIZE, address, frames, LPC_MAX_WORD_FRAMES, NULL);
+		if (frameCount < 0) {
+			fprintf(stderr, "Cannot parse word %s\n", argv[0]);
+			return 1;
+		}
+		
+		int sampleCount = lpcRender(&settings, frames, frameCount, samples);
+		
+		FILE *file = fopen(argv[1], "wb");
+		if (file == NULL) {
+			fprintf(stderr, "Cannot create %s\n", argv[1]);
+			return 1;
+		}
+		fwrite(samples, sizeof(int16_t), sampleCount, file);
+		fclose(file);
+		
+		printf("Wrote %d samples (8KHz 16-bit mono) to %s\n", sampleCount, argv[1]);
+		return 0;
+	}
+	
+	if (lanes) return synthLanes(image, lanes);
+	
+	long totalSamples = 0;
+	double start = microseconds();
+	
+	for (int i = 0; i < image->wordCount; i++) {
+		int frameCount = lpcParseWordChip(chipVariant, image->data, PHROM_SIZE, image->words[i].address, frames, LPC_MAX_WORD_FRAMES, NULL);
+		if (frameCount > 0) totalSamples += lpcRender(&settings, frames, frameCount, samples);
+	}
+	
+	double elapsed = (microseconds() - start) / 1e6;
+	double audio = (double)totalSamples / LPC_SAMPLE_RATE;
+	printf("%s: %d words, %.1f seconds of speech rendered in %.1f ms (%.0fx real time, %s)\n",
+		image->name, image->wordCount, audio, elapsed * 1e3, audio / elapsed, lpcGetChip(chipVariant)->name);
+	return 0;
+}
+
+// phromtool render <image> <directory> [--threads N] [--lanes N] - render
+// every listed word to WAV files and a concatenated sample bank
+static int commandRender(const phromImage_t *image, int argc, char *argv[])
+{
+	lpcSettings_t settings = { chipVariant, 0, 0, 0 };
+	int threads = takeValue(&argc, argv, "--threads", 0);
+	int lanes = takeLanes(&argc, argv, &settings);
+	if (lanes < 0) return 1;
+	if (argc < 1) return -1;
+	
+	if (image->wordCount == 0) {
+		fprintf(stderr, "%s has no word list (use --words)\n", image->name);
+		return 1;
+	}
+	
+	// Create the output directory first, or every word would fail to write
+	if (mkdir(argv[0], 0777) != 0 && errno != EEXIST) {
+		fprintf(stderr, "Cannot create %s: %s\n", argv[0], strerror(errno));
+		return 1;
+	}
+	
+	threadPool_t *pool = threadPoolCreate(threads);
+	if (pool == NULL) {
+		fprintf(stderr, "Cannot start the worker threads\n");
+		return 1;
+	}
+	batchRenderStats_t stats;
+	int result = batchRenderImage(image, argv[0], &settings, lanes, pool, &stats);
+	
+	printf("%s: %d words (%.1f seconds of speech) rendered to %s in %.1f ms on %d thread%s",
+		image->name, stats.words, (double)stats.samples / LPC_SAMPLE_RATE, argv[0],
+		stats.seconds * 1e3, threadPoolWorkers(pool), plural(threadPoolWorkers(pool)));
+	if (lanes) printf(" (%d lanes)", lanes);
+	if (stats.failures) printf(", %d failed", stats.failures);
+	printf("\n");
+	
+	threadPoolDestroy(pool);
+	return result == 0 ? 0 : 1;
+}
+
+// phromtool compare <image> [--lanes N] [--threads N] - render every listed
+// word through the lane renderer (at each lane count, or just N) and report
+// how far its output strays from the reference synthesiser's
+static int commandCompare(const phromImage_t *image, int argc, char *argv[])
+{
+	static const int laneCounts[] = { 4, 8, 16 };
+	lpcSettings_t settings = { chipVariant, 0, 0, 0 };
+	int threads = takeValue(&argc, argv, "--threads", 0);
+	int lanes = takeLanes(&argc, argv, &settings);
+	if (lanes < 0) return 1;
+	if (argc != 0) return -1;
+	
+	if (image->wordCount == 0) {
+		fprintf(stderr, "%s has no word list (use --words)\n", image->name);
+		return 1;
+	}
+	if (!lpcLanesSupported(&settings, laneCounts[0])) {
+		fprintf(stderr, "The lane renderer only supports the TMS5220 at normal speed and pitch\n");
+		return 1;
+	}
+	
+	int count = image->wordCount;
+	int16_t **reference = calloc(count, sizeof(int16_t *));
+	int16_t **laned = calloc(count, sizeof(int16_t *));
+	uint32_t *referenceLengths = calloc(count, sizeof(uint32_t));
+	uint32_t *lanedLengths = calloc(count, sizeof(uint32_t));
+	threadPool_t *pool = threadPoolCreate(threads);
+	int result = 1;
+	if (reference == NULL || laned == NULL || referenceLengths == NULL || lanedLengths == NULL || pool == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		goto done;
+	}
+	
+	double start = microseconds();
+	batchRenderWords(image, &settings, 0, pool, reference, referenceLengths);
+	double scalar = microseconds() - start;
+	
+	long totalSamples = 0;
+	for (int i = 0; i < count; i++) totalSamples += referenceLengths[i];
+	printf("%s: %d words (%.1f seconds of speech), reference synthesiser %.1f ms on %d thread%s\n",
+		image->name, count, (double)totalSamples / LPC_SAMPLE_RATE, scalar / 1e3,
+		threadPoolWorkers(pool), plural(threadPoolWorkers(pool)));
+	
+	result = 0;
+	for (size_t l = 0; l < sizeof(laneCounts) / sizeof(laneCounts[0]); l++) {
+		if (lanes && laneCounts[l] != lanes) continue;
+		
+		start = microseconds();
+		batchRenderWords(image, &settings, laneCounts[l], pool, laned, lanedLengths);
+		double elapsed = microseconds() - start;
+		
+		// A word whose length differs counts every one of its samples
+		long differing = 0;
+		int maxDeviation = 0;
+		for (int i = 0; i < count; i++) {
+			if (lanedLengths[i] != referenceLengths[i]) {
+				differing += referenceLengths[i] > lanedLengths[i] ? referenceLengths[i] : lanedLengths[i];
+				maxDeviation = 65535;
+			} else {
+				for (uint32_t j = 0; j < referenceLengths[i]; j++) {
+					int deviation = abs(laned[i][j] - reference[i][j]);
+					if (deviation) differing++;
+					if (deviation > maxDeviation) maxDeviation = deviation;
+				}
+			}
+			free(laned[i]);
+			laned[i] = NULL;
+		}
+		
+		printf("%2d lanes: %.1f ms (%.2fx), maximum deviation %d, %ld of %ld samples differ\n",
+			laneCounts[l], elapsed / 1e3, scalar / elapsed, maxDeviation, differing, totalSamples);
+		if (differing) result = 1;
+	}
+	
+done:
+	for (int i = 0; i < count; i++) {
+		if (reference) free(reference[i]);
+		if (laned) free(laned[i]);
+	}
+	free(reference);
+	free(laned);
+	free(referenceLengths);
+	free(lanedLengths);
+	if (pool) threadPoolDestroy(pool);
+	return result;
+}
+
+// phromtool scan <image> - discover the words in an image and print a word
+// list in the romdata header format (compared with the listed words, if any)
+static int commandScan(const phromImage_t *image, int argc, char *argv[])
+{
+	static wordScanResult_t results[PHROM_SIZE];
+	(void)argc; (void)argv;
+	
+	threadPool_t *pool = threadPoolCreate(0);
+	if (pool == NULL) {
+		fprintf(stderr, "Cannot start the worker threads\n");
+		return 1;
+	}
+	double start = microseconds();
+	int wordCount = wordScanImage(image->data, chipVariant, pool, results, PHROM_SIZE);
+	double elapsed = microseconds() - start;
+	threadPoolDestroy(pool);
+	
+	if (wordCount < 0) return 1;
+	
+	printf("/*\n\tPHROM Word list (discovered from %s):\n\t\n", image->name);
+	printf("\tWord or   Absolute\n\tword-part address\n\tnumber    (hex)    Word\n\t\n");
+	for (int i = 0; i < wordCount; i++) {
+		const phromWord_t *listed = phromFindWordAddress(image, results[i].address);
+		printf("\t%-9d %04X     %s\n", i + 1, results[i].address, listed ? listed->word : "?");
+	}
+	printf("*/\n");
+	
+	fprintf(stderr, "%d words found in %.0f us", wordCount, elapsed);
+	if (image->wordCount) {
+		int matched = 0;
+		for (int i = 0; i < wordCount; i++)
+			if (phromFindWordAddress(image, results[i].address)) matched++;
+		fprintf(stderr, "; %d of %d listed words found, %d not listed", matched, image->wordCount, wordCount - matched);
+	}
+	fprintf(stderr, "\n");
+	return 0;
+}
+
+// Resample 8KHz PCM a frame at a time, as it would be straight after the
+// synthesiser; returns the new sample count or -1 on failure
+static int resampleFrames(const int16_t *input, int inputCount, int16_t **output, uint32_t rate, int quality)
+{
+	resampler_t *resampler = resamplerCreate(LPC_SAMPLE_RATE, rate, quality);
+	if (resampler == NULL) return -1;
+	
+	*output = malloc((resamplerMaxOutput(resampler, inputCount) + resamplerFlushOutput(resampler)
+		+ inputCount / LPC_FRAME_SAMPLES + 1) * sizeof(int16_t));
+	if (*output == NULL) {
+		resamplerDestroy(resampler);
+		return -1;
+	}
+	
+	int outputCount = 0;
+	for (int i = 0; i < inputCount; i += LPC_FRAME_SAMPLES) {
+		int count = inputCount - i < LPC_FRAME_SAMPLES ? inputCount - i : LPC_FRAME_SAMPLES;
+		outputCount += resamplerProcess(resampler, input + i, count, *output + outputCount);
+	}
+	outputCount += resamplerFlush(resampler, *output + outputCount);
+	
+	resamplerDestroy(resampler);
+	return outputCount;
+}
+
+// phromtool phrase <image> <file.wav> <word>... [--smooth]
+// [--speed X] [--pitch N] [--pitch-scale X] [--rate N] [--quality N] - render a phrase of words (numbers,
+// 0x addresses or text) to a WAV file
+static int commandPhrase(const phromImage_t *image, int argc, char *argv[])
+{
+	int flags = takeOption(&argc, argv, "--smooth") ? PHRASE_SMOOTH_JOINS : 0;
+	lpcSettings_t settings = { chipVariant, 0, 0, 0 };
+	if (takeVoice(&argc, argv, &settings) != 0) return 1;
+	uint32_t rate = takeValue(&argc, argv, "--rate", LPC_SAMPLE_RATE);
+	int quality = takeValue(&argc, argv, "--quality", RESAMPLER_MEDIUM);
+	const phraseWord_t *words[256];
+	phraseIndex_t index;
+	int result = 1;
+	
+	if (argc < 2 || argc - 1 > 256) return -1;
+	if (phraseIndexBuild(&index, image, settings.chip) != 0) return 1;
+	
+	for (int i = 1; i < argc; i++) {
+		words[i - 1] = phraseFindWord(&index, argv[i]);
+		if (words[i - 1] == NULL) {
+			fprintf(stderr, "Unknown word %s\n", argv[i]);
+			phraseIndexFree(&index);
+			return 1;
+		}
+	}
+	
+	// Words spoken one after another go through the PCM cache (so a word
+	// repeated in the phrase is rendered once); smoothed joins need the
+	// words' frames synthesised together
+	int sampleCount;
+	if (flags & PHRASE_SMOOTH_JOINS) {
+		int frameCount = phraseAssemble(&index, words, argc - 1, flags, frames, LPC_MAX_WORD_FRAMES);
+		sampleCount = frameCount < 0 ? frameCount : lpcRender(&settings, frames, frameCount, samples);
+	} else {
+		pcmCache_t *cache = pcmCacheCreate(sizeof(samples));
+		sampleCount = cache ? phraseRenderWords(&index, cache, &settings, words, argc - 1,
+			samples, sizeof(samples) / sizeof(samples[0])) : LPC_PARSE_TOOLONG;
+		pcmCacheDestroy(cache);
+	}
+	if (sampleCount < 0) {
+		fprintf(stderr, "Phrase is too long\n");
+		phraseIndexFree(&index);
+		return 1;
+	}
+	int16_t *output = samples;
+	
+	if (rate != LPC_SAMPLE_RATE) {
+		double start = microseconds();
+		sampleCount = resampleFrames(samples, sampleCount, &output, rate, quality);
+		if (sampleCount < 0) {
+			fprintf(stderr, "Cannot resample to %uHz\n", rate);
+			phraseIndexFree(&index);
+			return 1;
+		}
+		printf("Resampled to %uHz in %.0f us\n", rate, microseconds() - start);
+	}
+	
+	if (wavWriteFile(argv[0], output, sampleCount, rate) == 0) {
+		printf("Wrote %d words (%.2f seconds) to %s\n", argc - 1, (double)sampleCount / rate, argv[0]);
+		result = 0;
+	} else {
+		fprintf(stderr, "Cannot write %s\n", argv[0]);
+	}
+	
+	if (output != samples) free(output);
+	phraseIndexFree(&index);
+	return result;
+}
+
+// Cache benchmark state shared by the phrase tasks
+typedef struct {
+	const phromImage_t *image;
+	pcmCache_t *cache;
+	lpcSettings_t settings;
+	int wordsPerPhrase;
+	long samples;
+} cacheBenchmark_t;
+
+// Render one pseudo-random phrase of listed words through the cache
+static void cacheBenchmarkPhrase(int index, void *arg)
+{
+	cacheBenchmark_t *benchmark = arg;
+	const phromImage_t *image = benchmark->image;
+	const int maxSamples = LPC_MAX_WORD_FRAMES * LPC_FRAME_SAMPLES;
+	int16_t *phrase = malloc(maxSamples * sizeof(int16_t));
+	uint32_t seed = index * 2654435761u + 1;
+	int sampleCount = 0;
+	if (phrase == NULL) return;
+	
+	// Word choice is skewed towards the start of the list, as real
+	// phrases favour a small working set (numbers and common words)
+	for (int i = 0; i < benchmark->wordsPerPhrase; i++) {
+		seed = seed * 1664525u + 1013904223u;
+		uint32_t r = (seed >> 8) % image->wordCount;
+		const phromWord_t *word = &image->words[(r * r) / image->wordCount];
+		
+		int count = pcmCacheRenderWord(benchmark->cache, image, word->address, &benchmark->settings,
+			phrase + sampleCount, maxSamples - sampleCount);
+		if (count < 0) break;
+		sampleCount += count;
+	}
+	
+	__atomic_fetch_add(&benchmark->samples, sampleCount, __ATOMIC_RELAXED);
+	free(phrase);
+}
+
+// phromtool cache <image> [--phrases N] [--kbytes N] [--threads N] - render
+// random phrases with and without the PCM cache and report hit rates
+static int commandCache(const phromImage_t *image, int argc, char *argv[])
+{
+	cacheBenchmark_t benchmark = { image, NULL, { chipVariant, 0, 0, 0 }, 4, 0 };
+	int phrases = takeValue(&argc, argv, "--phrases", 1000);
+	long kbytes = takeValue(&argc, argv, "--kbytes", 4096);
+	int threads = takeValue(&argc, argv, "--threads", 0);
+	(void)argv;
+	if (argc != 0 || phrases < 1 || kbytes < 0) return -1;
+	
+	if (image->wordCount == 0) {
+		fprintf(stderr, "%s has no word list (use --words)\n", image->name);
+		return 1;
+	}
+	
+	threadPool_t *pool = threadPoolCreate(threads);
+	if (pool == NULL) {
+		fprintf(stderr, "Cannot start the worker threads\n");
+		return 1;
+	}
+	
+	// A zero-sized cache keeps nothing, giving the uncached baseline
+	double elapsed[2];
+	pcmCacheStats_t stats;
+	for (int pass = 0; pass < 2; pass++) {
+		benchmark.cache = pcmCacheCreate(pass ? (size_t)kbytes * 1024 : 0);
+		benchmark.samples = 0;
+		double start = microseconds();
+		threadPoolParallelFor(pool, phrases, cacheBenchmarkPhrase, &benchmark);
+		elapsed[pass] = microseconds() - start;
+		pcmCacheGetStats(benchmark.cache, &stats);
+		pcmCacheDestroy(benchmark.cache);
+	}
+	
+	uint64_t lookups = stats.hits + stats.misses;
+	printf("%s: %d phrases (%.1f seconds of speech) on %d thread%s\n", image->name, phrases,
+		(double)benchmark.samples / LPC_SAMPLE_RATE, threadPoolWorkers(pool), plural(threadPoolWorkers(pool)));
+	printf("Uncached: %.1f us per phrase\n", elapsed[0] / phrases);
+	printf("Cached:   %.1f us per phrase, %.1f%% hit rate (%llu hits, %llu misses, %llu evictions)\n",
+		elapsed[1] / phrases, lookups ? 100.0 * stats.hits / lookups : 0.0,
+		(unsigned long long)stats.hits, (unsigned long long)stats.misses, (unsigned long long)stats.evictions);
+	printf("          %u entries, %zu of %zu bytes\n", stats.entries, stats.bytes, stats.maxBytes);
+	
+	threadPoolDestroy(pool);
+	return 0;
+}
+
+// phromtool bank <image> <file.bank> [<word> <file.wav>] [--threads N]
+// [--lanes N] [--speed X] [--pitch N] [--pitch-scale X] - map a sample bank
+// (rewriting it if missing or stale) and optionally extract a word from it
+static int commandBank(const phromImage_t *image, int argc, char *argv[])
+{
+	lpcSettings_t settings = { chipVariant, 0, 0, 0 };
+	if (takeVoice(&argc, argv, &settings) != 0) return 1;
+	int threads = takeValue(&argc, argv, "--threads", 0);
+	int lanes = takeLanes(&argc, argv, &settings);
+	if (lanes < 0) return 1;
+	if (argc != 1 && argc != 3) return -1;
+	
+	if (image->wordCount == 0) {
+		fprintf(stderr, "%s has no word list (use --words)\n", image->name);
+		return 1;
+	}
+	
+	threadPool_t *pool = threadPoolCreate(threads);
+	if (pool == NULL) {
+		fprintf(stderr, "Cannot start the worker threads\n");
+		return 1;
+	}
+	sampleBank_t bank;
+	double start = microseconds();
+	int loaded = sampleBankLoad(argv[0], image, &settings, lanes, pool, &bank);
+	double elapsed = microseconds() - start;
+	threadPoolDestroy(pool);
+	
+	if (loaded < 0) {
+		fprintf(stderr, "Cannot write sample bank %s\n", argv[0]);
+		return 1;
+	}
+	printf("%s: %s %u words (%.1f seconds of speech) in %.0f us\n", argv[0],
+		loaded == SAMPLEBANK_OK ? "mapped" : "rendered and mapped", bank.header->entryCount,
+		(double)bank.header->sampleCount / LPC_SAMPLE_RATE, elapsed);
+	
+	int result = 0;
+	if (argc == 3) {
+		int32_t address = resolveWord(image, argv[1]);
+		uint32_t length;
+		const int16_t *pcm = address < 0 ? NULL : sampleBankFindAddress(&bank, address, &length);
+		if (pcm == NULL) {
+			fprintf(stderr, "Word %s is not in the bank\n", argv[1]);
+			result = 1;
+		} else if (wavWriteFile(argv[2], pcm, length, LPC_SAMPLE_RATE) != 0) {
+			fprintf(stderr, "Cannot write %s\n", argv[2]);
+			result = 1;
+		}
+	}
+	
+	sampleBankClose(&bank);
+	return result;
+}
+
+// phromtool serve <image> <socket> [--threads N] [--batch-us N] [--kbytes N] -
+// run the speech daemon until SHUTDOWN or a signal
+static int commandServe(const phromImage_t *image, int argc, char *argv[])
+{
+	speechServeOptions_t options;
+	speechServeStats_t stats;
+	int threads = takeValue(&argc, argv, "--threads", 0);
+	options.batchWindow = takeValue(&argc, argv, "--batch-us", 2000);
+	long kbytes = takeValue(&argc, argv, "--kbytes", 4096);
+	options.maxBatch = 64;
+	options.chip = chipVariant;
+	options.cacheBytes = (size_t)kbytes * 1024;
+	if (argc != 1 || options.batchWindow < 0 || kbytes < 0) return -1;
+	
+	if (image->wordCount == 0) {
+		fprintf(stderr, "%s has no word list (use --words)\n", image->name);
+		return 1;
+	}
+	
+	threadPool_t *pool = threadPoolCreate(threads);
+	if (pool == NULL) {
+		fprintf(stderr, "Cannot start the worker threads\n");
+		return 1;
+	}
+	fprintf(stderr, "Serving %s on %s\n", image->name, argv[0]);
+	int result = speechServe(image, argv[0], pool, &options, &stats);
+	threadPoolDestroy(pool);
+	
+	if (result != 0) {
+		fprintf(stderr, "Cannot listen on %s\n", argv[0]);
+		return 1;
+	}
+	fprintf(stderr, "%llu requests in %llu batches (%llu coalesced), latency p50 %.0f us p99 %.0f us\n",
+		(unsigned long long)stats.requests, (unsigned long long)stats.batches,
+		(unsigned long long)stats.coalesced, stats.p50, stats.p99);
+	uint64_t lookups = stats.cache.hits + stats.cache.misses;
+	fprintf(stderr, "Word cache: %.1f%% hit rate (%llu hits, %llu misses), %u entries, %zu of %zu bytes\n",
+		lookups ? 100.0 * stats.cache.hits / lookups : 0.0, (unsigned long long)stats.cache.hits,
+		(unsigned long long)stats.cache.misses, stats.cache.entries, stats.cache.bytes, stats.cache.maxBytes);
+	return 0;
+}
+
+// Load generator state for the say command
+typedef struct {
+	const char *socketPath;
+	const char *request;
+	int repeat;
+	int ringSize;					// Samples, or 0 for the socket transport
+	int failures;
+	latencyRecorder_t *latency;		// Per client
+	pthread_mutex_t lock;
+} sayClients_t;
+
+static void *sayClient(void *argument)
+{
+	sayClients_t *clients = argument;
+	latencyRecorder_t *latency = malloc(sizeof(latencyRecorder_t));
+	int connection = speechConnect(clients->socketPath);
+	int failures = 0;
+	char reply[256];
+	pcmRing_t ring = { NULL, 0, -1, 0, 0 };
+	
+	if (connection >= 0 && clients->ringSize &&
+		speechAttachRing(connection, clients->ringSize, &ring, reply, sizeof(reply)) != 0) {
+		close(connection);
+		connection = -1;
+	}
+	
+	if (latency) latencyReset(latency);
+	for (int i = 0; i < clients->repeat; i++) {
+		int16_t *pcm;
+		uint32_t rate;
+		double start = microseconds();
+		int sampleCount = connection < 0 ? -1 : ring.shared
+			? speechSayRing(connection, clients->request, &ring, &pcm, &rate, reply, sizeof(reply))
+			: speechSay(connection, clients->request, &pcm, &rate, reply, sizeof(reply));
+		if (sampleCount < 0) {
+			failures++;
+			continue;
+		}
+		if (latency) latencyRecord(latency, microseconds() - start);
+		free(pcm);
+	}
+	if (connection >= 0) close(connection);
+	pcmRingClose(&ring);
+	
+	pthread_mutex_lock(&clients->lock);
+	clients->failures += failures;
+	if (latency) {
+		uint32_t count = latency->count < LATENCY_SAMPLES ? latency->count : LATENCY_SAMPLES;
+		for (uint32_t i = 0; i < count; i++) latencyRecord(clients->latency, latency->samples[i]);
+	}
+	pthread_mutex_unlock(&clients->lock);
+	free(latency);
+	return NULL;
+}
+
+// phromtool say <socket> <file.wav> <word>... [--clients N] [--repeat N]
+// [--ring N] [--smooth] - ask the daemon for a phrase, optionally from many
+// concurrent clients to measure latency
+static int commandSay(const phromImage_t *image, int argc, char *argv[])
+{
+	static char request[SPEECHD_MAX_LINE];
+	char reply[256];
+	(void)image;
+	
+	int clientCount = takeValue(&argc, argv, "--clients", 0);
+	int repeat = takeValue(&argc, argv, "--repeat", 1);
+	int ringSize = takeValue(&argc, argv, "--ring", 0);
+	if (chipGiven) {
+		fprintf(stderr, "The chip is chosen when the daemon is started (serve --chip)\n");
+		return 1;
+	}
+	int length = snprintf(request, sizeof(request), "SAY");
+	if (takeOption(&argc, argv, "--smooth")) length += snprintf(request + length, sizeof(request) - length, " --smooth");
+	double speed = takeReal(&argc, argv, "--speed", 0);
+	if (speed) length += snprintf(request + length, sizeof(request) - length, " --speed %g", speed);
+	int pitch = takeValue(&argc, argv, "--pitch", 0);
+	if (pitch) length += snprintf(request + length, sizeof(request) - length, " --pitch %d", pitch);
+	double pitchScale = takeReal(&argc, argv, "--pitch-scale", 0);
+	if (pitchScale) length += snprintf(request + length, sizeof(request) - length, " --pitch-scale %g", pitchScale);
+	if (argc < 3 || clientCount < 0 || clientCount > 1024 || repeat < 1 || ringSize < 0) return -1;
+	for (int i = 2; i < argc; i++) length += snprintf(request + length, sizeof(request) - length, " %s", argv[i]);
+	if (length >= (int)sizeof(request)) return -1;
+	
+	int connection = speechConnect(argv[0]);
+	if (connection < 0) {
+		fprintf(stderr, "Cannot connect to %s\n", argv[0]);
+		return 1;
+	}
+	
+	int16_t *pcm;
+	uint32_t rate;
+	pcmRing_t ring = { NULL, 0, -1, 0, 0 };
+	if (ringSize && speechAttachRing(connection, ringSize, &ring, reply, sizeof(reply)) != 0) {
+		fprintf(stderr, "Cannot set up shared memory: %s\n", reply);
+		close(connection);
+		return 1;
+	}
+	
+	int sampleCount = ring.shared
+		? speechSayRing(connection, request, &ring, &pcm, &rate, reply, sizeof(reply))
+		: speechSay(connection, request, &pcm, &rate, reply, sizeof(reply));
+	pcmRingClose(&ring);
+	if (sampleCount < 0) {
+		fprintf(stderr, "Request failed: %s\n", reply);
+		close(connection);
+		return 1;
+	}
+	int result = wavWriteFile(argv[1], pcm, sampleCount, rate);
+	free(pcm);
+	if (result != 0) {
+		fprintf(stderr, "Cannot write %s\n", argv[1]);
+		close(connection);
+		return 1;
+	}
+	printf("Wrote %.2f seconds to %s\n", (double)sampleCount / rate, argv[1]);
+	
+	// An idle connection would hold every batch open for its full window
+	close(connection);
+	
+	// Concurrent clients each repeat the request on their own connection
+	if (clientCount > 0) {
+		sayClients_t clients = { argv[0], request, repeat, ringSize, 0, malloc(sizeof(latencyRecorder_t)), PTHREAD_MUTEX_INITIALIZER };
+		pthread_t *threads = malloc(clientCount * sizeof(pthread_t));
+		if (clients.latency == NULL || threads == NULL) return 1;
+		latencyReset(clients.latency);
+		
+		double start = microseconds();
+		for (int i = 0; i < clientCount; i++) pthread_create(&threads[i], NULL, sayClient, &clients);
+		for (int i = 0; i < clientCount; i++) pthread_join(threads[i], NULL);
+		double elapsed = microseconds() - start;
+		
+		printf("%d clients x %d requests in %.1f ms: client latency p50 %.0f us p99 %.0f us",
+			clientCount, repeat, elapsed / 1e3, latencyPercentile(clients.latency, 50),
+			latencyPercentile(clients.latency, 99));
+		if (clients.failures) printf(", %d failed", clients.failures);
+		printf("\n");
+		free(threads);
+		free(clients.latency);
+	}
+	
+	connection = speechConnect(argv[0]);
+	if (connection >= 0 && speechCommand(connection, "STATS", reply, sizeof(reply)) == 0) printf("Daemon: %s\n", reply);
+	if (connection >= 0) close(connection);
+	return 0;
+}
+
+// Take the --optimise and --distortion options into encoder settings;
+// returns -1 if the budget is out of range
+static int takeEncoder(int *argc, char *argv[], lpcEncodeSettings_t *settings)
+{
+	double distortion = takeReal(argc, argv, "--distortion", 0);
+	
+	settings->chip = chipVariant;
+	settings->optimise = takeOption(argc, argv, "--optimise");
+	settings->distortion = (uint8_t)(distortion * 10 + 0.5);
+	if (distortion < 0 || distortion > 25) {
+		fprintf(stderr, "--distortion must be from 0 to 25 dB\n");
+		return -1;
+	}
+	return 0;
+}
+
+// phromtool encode <file.wav> <file.lpc> [--preview <file.wav>]
+// [--optimise] [--distortion dB] [--threads N] - encode a recording
+// (resampled to 8KHz if need be) into LPC frames
+static int commandEncode(const phromImage_t *image, int argc, char *argv[])
+{
+	static uint8_t data[PHROM_SIZE];
+	static const char *typeNames[] = { "silent", "unvoiced", "voiced", "stop" };
+	const char *preview = takeString(&argc, argv, "--preview");
+	int threads = takeValue(&argc, argv, "--threads", 0);
+	lpcEncodeSettings_t settings;
+	lpcEncodeStats_t stats;
+	int16_t *pcm;
+	uint32_t endBit;
+	(void)image;
+	
+	if (takeEncoder(&argc, argv, &settings) != 0) return 1;
+	if (argc != 2 || threads < 0) return -1;
+	int sampleCount = corpusReadRecording(argv[0], &pcm);
+	if (sampleCount < 0) {
+		fprintf(stderr, "Cannot read %s (16 or 8-bit PCM WAV files only)\n", argv[0]);
+		return 1;
+	}
+	
+	threadPool_t *pool = threadPoolCreate(threads);
+	double start = microseconds();
+	int frameCount = pool ? lpcEncode(&settings, pcm, sampleCount, pool, frames, LPC_MAX_WORD_FRAMES, &stats) : -1;
+	double elapsed = microseconds() - start;
+	threadPoolDestroy(pool);
+	free(pcm);
+	if (frameCount < 0) {
+		fprintf(stderr, "%s is too long to encode\n", argv[0]);
+		return 1;
+	}
+	
+	memset(data, 0, sizeof(data));
+	if (lpcPackFrames(chipVariant, frames, frameCount, data, sizeof(data), 0, &endBit) != 0) {
+		fprintf(stderr, "%s does not fit in a PHROM\n", argv[0]);
+		return 1;
+	}
+	
+	// The stream is closed exactly once, whether or not the write worked
+	FILE *file = fopen(argv[1], "wb");
+	uint32_t bytes = (endBit + 7) / 8;
+	int written = (file != NULL && fwrite(data, 1, bytes, file) == bytes);
+	if (file != NULL && fclose(file) != 0) written = 0;
+	if (!written) {
+		fprintf(stderr, "Cannot write %s\n", argv[1]);
+		return 1;
+	}
+	
+	int counts[4] = { 0 }, repeats = 0;
+	for (int i = 0; i < frameCount; i++) {
+		counts[frames[i].type]++;
+		repeats += frames[i].repeat;
+	}
+	printf("Encoded %.2f seconds in %.0f us: %d frames (", (double)sampleCount / LPC_SAMPLE_RATE, elapsed, frameCount);
+	for (int type = 0; type < 3; type++) printf("%d %s, ", counts[type], typeNames[type]);
+	printf("%d repeat), %u bytes, %.0f bits/s\n", repeats, bytes, endBit * (double)LPC_SAMPLE_RATE / (frameCount * LPC_FRAME_SAMPLES));
+	if (settings.optimise) {
+		printf("Optimised to %u bits at %.2f dB mean distortion against %u bits at %.2f dB plain (%.1f%% smaller)\n",
+			stats.bits, stats.distortion, stats.plainBits, stats.plainDistortion, 100.0 * (1.0 - (double)stats.bits / stats.plainBits));
+	} else {
+		printf("Mean spectral distortion %.2f dB\n", stats.distortion);
+	}
+	
+	if (preview) {
+		lpcSettings_t render = { chipVariant, 0, 0, 0 };
+		int count = lpcRender(&render, frames, frameCount, samples);
+		if (wavWriteFile(preview, samples, count, LPC_SAMPLE_RATE) != 0) {
+			fprintf(stderr, "Cannot write %s\n", preview);
+			return 1;
+		}
+	}
+	
+	return 0;
+}
+
+// phromtool pitch <file.wav> [--threads N] [--track] - track the pitch
+// of a recording of any length and report the voicing and throughput
+// (--track lists each frame's pitch)
+static int commandPitch(const phromImage_t *image, int argc, char *argv[])
+{
+	int threads = takeValue(&argc, argv, "--threads", 0);
+	int track = takeOption(&argc, argv, "--track");
+	const int16_t *pitchTable = lpcGetChip(chipVariant)->tables->pitch;
+	int16_t *pcm;
+	(void)image;
+	
+	if (argc != 1 || threads < 0) return -1;
+	int sampleCount = corpusReadRecording(argv[0], &pcm);
+	if (sampleCount < 0) {
+		fprintf(stderr, "Cannot read %s (16 or 8-bit PCM WAV files only)\n", argv[0]);
+		return 1;
+	}
+	
+	int frameCount = (sampleCount + LPC_FRAME_SAMPLES - 1) / LPC_FRAME_SAMPLES;
+	pitchEstimate_t *estimates = malloc((frameCount + 1) * sizeof(pitchEstimate_t));
+	threadPool_t *pool = threadPoolCreate(threads);
+	if (estimates == NULL || pool == NULL) {
+		free(estimates);
+		free(pcm);
+		threadPoolDestroy(pool);
+		return 1;
+	}
+	
+	double start = microseconds();
+	int result = pitchTrack(chipVariant, pcm, sampleCount, pool, estimates);
+	double elapsed = microseconds() - start;
+	
+	if (result == 0) {
+		int voiced = 0;
+		double periods = 0.0;
+		for (int i = 0; i < frameCount; i++) {
+			if (estimates[i].pitch) {
+				voiced++;
+				periods += pitchTable[estimates[i].pitch];
+			}
+			if (track) {
+				printf("%6d %6.3f  %2u %3d  %.2f\n", i, (double)i * LPC_FRAME_SAMPLES / LPC_SAMPLE_RATE,
+					estimates[i].pitch, pitchTable[estimates[i].pitch], estimates[i].periodicity);
+			}
+		}
+		
+		double seconds = (double)sampleCount / LPC_SAMPLE_RATE;
+		printf("Tracked %.1f seconds in %.1f ms on %d thread%s (%.0f hours of audio per minute): %d frames, %.1f%% voiced",
+			seconds, elapsed / 1e3, threadPoolWorkers(pool), plural(threadPoolWorkers(pool)), seconds / 3600.0 / (elapsed / 60e6), frameCount,
+			100.0 * voiced / frameCount);
+		if (voiced) printf(", mean %.0f Hz", LPC_SAMPLE_RATE / (periods / voiced));
+		printf("\n");
+	}
+	
+	threadPoolDestroy(pool);
+	free(estimates);
+	free(pcm);
+	return result == 0 ? 0 : 1;
+}
+
+// phromtool corpus <manifest> <directory> [--threads N] [--optimise]
+// [--distortion dB] - encode every recording of a manifest, re-encoding
+// only those not already cached
+static int commandCorpus(const phromImage_t *image, int argc, char *argv[])
+{
+	int threads = takeValue(&argc, argv, "--threads", 0);
+	lpcEncodeSettings_t settings;
+	corpus_t corpus;
+	(void)image;
+	
+	if (takeEncoder(&argc, argv, &settings) != 0) return 1;
+	if (argc != 2 || threads < 0) return -1;
+	if (corpusLoadManifest(&corpus, argv[0], &settings) < 0) {
+		fprintf(stderr, "Cannot read manifest %s\n", argv[0]);
+		return 1;
+	}
+	
+	threadPool_t *pool = threadPoolCreate(threads);
+	if (pool == NULL) {
+		corpusFree(&corpus);
+		return 1;
+	}
+	
+	double start = microseconds();
+	int failures = corpusEncode(&corpus, pool, argv[1]);
+	double elapsed = microseconds() - start;
+	
+	int cached = 0, encoded = 0;
+	uint32_t bytes = 0;
+	uint64_t bits = 0, plainBits = 0;
+	for (int i = 0; i < corpus.wordCount; i++) {
+		const corpusWord_t *word = &corpus.words[i];
+		if (word->failed) fprintf(stderr, "Cannot encode %u %s from %s\n", word->number, word->word, word->path);
+		cached += word->cached;
+		bytes += (word->bits + 7) / 8;
+		if (!word->failed && !word->cached) {
+			encoded++;
+			bits += word->bits;
+			plainBits += word->plainBits;
+		}
+	}
+	
+	printf("%d words in %.1f ms on %d thread%s: %d encoded, %d cached, %d failed, %u bytes of frames\n",
+		corpus.wordCount, elapsed / 1e3, threadPoolWorkers(pool), plural(threadPoolWorkers(pool)), encoded, cached, failures, bytes);
+	if (settings.optimise && encoded) {
+		printf("Optimised words average %.0f bits against %.0f plain (%.1f%% smaller)\n",
+			(double)bits / encoded, (double)plainBits / encoded, 100.0 * (1.0 - (double)bits / plainBits));
+	}
+	
+	threadPoolDestroy(pool);
+	corpusFree(&corpus);
+	return failures ? 1 : 0;
+}
+
+// phromtool build <manifest> <directory> <output> [--bank N] [--banks N]
+// [--threads N] [--optimise] [--distortion dB] - encode a manifest's words
+// (through the corpus cache in the directory) and pack them into PHROM
+// images, written as <output>.bin and <output>.h (or <output>_<bank>.bin
+// and .h for each bank when packing into more than one)
+static int commandBuild(const phromImage_t *image, int argc, char *argv[])
+{
+	static uint8_t data[PHROM_SIZE];
+	int threads = takeValue(&argc, argv, "--threads", 0);
+	int firstBank = takeValue(&argc, argv, "--bank", 0);
+	int bankCount = takeValue(&argc, argv, "--banks", 1);
+	lpcEncodeSettings_t settings;
+	corpus_t corpus;
+	(void)image;
+	
+	if (takeEncoder(&argc, argv, &settings) != 0) return 1;
+	if (argc != 3 || threads < 0) return -1;
+	if (firstBank < 0 || bankCount < 1 || firstBank + bankCount > 16) {
+		fprintf(stderr, "Banks must be from 0x0 to 0xF\n");
+		return 1;
+	}
+	if (corpusLoadManifest(&corpus, argv[0], &settings) < 0) {
+		fprintf(stderr, "Cannot read manifest %s\n", argv[0]);
+		return 1;
+	}
+	
+	threadPool_t *pool = threadPoolCreate(threads);
+	phromBuildWord_t *words = malloc((corpus.wordCount + 1) * sizeof(phromBuildWord_t));
+	if (pool == NULL || words == NULL) {
+		threadPoolDestroy(pool);
+		free(words);
+		corpusFree(&corpus);
+		return 1;
+	}
+	
+	int failures = corpusEncode(&corpus, pool, argv[1]);
+	threadPoolDestroy(pool);
+	
+	// Words that failed to encode are reported and left out
+	int wordCount = 0;
+	for (int i = 0; i < corpus.wordCount; i++) {
+		const corpusWord_t *word = &corpus.words[i];
+		if (word->failed) {
+			fprintf(stderr, "Cannot encode %u %s from %s\n", word->number, word->word, word->path);
+			continue;
+		}
+		words[wordCount].number = word->number;
+		words[wordCount].word = word->word;
+		words[wordCount].data = word->data;
+		words[wordCount].bytes = (word->bits + 7) / 8;
+		wordCount++;
+	}
+	
+	double start = microseconds();
+	int banks = phromBuildPack(words, wordCount, bankCount);
+	double elapsed = microseconds() - start;
+	if (banks < 0) {
+		fprintf(stderr, "Word numbers in %s must be 1 or more and not repeated\n", argv[0]);
+		free(words);
+		corpusFree(&corpus);
+		return 1;
+	}
+	
+	int result = failures ? 1 : 0, placed = 0;
+	for (int bank = 0; bank < banks; bank++) {
+		char binPath[1024], headerPath[1024];
+		if (bankCount == 1) {
+			snprintf(binPath, sizeof(binPath), "%s.bin", argv[2]);
+			snprintf(headerPath, sizeof(headerPath), "%s.h", argv[2]);
+		} else {
+			snprintf(binPath, sizeof(binPath), "%s_%X.bin", argv[2], firstBank + bank);
+			snprintf(headerPath, sizeof(headerPath), "%s_%X.h", argv[2], firstBank + bank);
+		}
+		
+		uint32_t used = phromBuildImage(words, wordCount, bank, data);
+		int count = 0;
+		for (int i = 0; i < wordCount; i++) count += words[i].bank == bank;
+		placed += count;
+		
+		if (phromBuildWriteBin(binPath, data) != 0 ||
+			phromBuildWriteHeader(headerPath, data, firstBank + bank, words, wordCount, bank, argv[0]) != 0) {
+			fprintf(stderr, "Cannot write %s or %s\n", binPath, headerPath);
+			result = 1;
+			break;
+		}
+		printf("Bank %X: %d words in %u of %d bytes (%u free), written to %s and %s\n",
+			firstBank + bank, count, used, PHROM_SIZE, PHROM_SIZE - used, binPath, headerPath);
+	}
+	
+	printf("%d of %d words packed into %d bank%s in %.1f ms\n", placed, corpus.wordCount, banks, banks == 1 ? "" : "s", elapsed / 1e3);
+	for (int i = 0; i < wordCount; i++) {
+		if (words[i].bank < 0) fprintf(stderr, "No room for %u %s (%u bytes)\n", words[i].number, words[i].word, words[i].bytes);
+	}
+	
+	free(words);
+	corpusFree(&corpus);
+	return result;
+}
+
+// phromtool schedule <image> [<file.wav>] [--seconds N] [--seed N] -
+// simulate prioritised announcements arriving at random through the
+// utterance scheduler and report per-priority latency
+static int commandSchedule(const phromImage_t *image, int argc, char *argv[])
+{
+	lpcSettings_t settings = { chipVariant, 0, 0, 0 };
+	int seconds = takeValue(&argc, argv, "--seconds", 600);
+	uint32_t seed = takeValue(&argc, argv, "--seed", 1);
+	if (argc > 1 || seconds < 1) return -1;
+	
+	if (image->wordCount == 0) {
+		fprintf(stderr, "%s has no word list (use --words)\n", image->name);
+		return 1;
+	}
+	
+	phraseIndex_t index;
+	scheduler_t *scheduler = schedulerCreate(&settings);
+	if (scheduler == NULL || phraseIndexBuild(&index, image, settings.chip) != 0) {
+		schedulerDestroy(scheduler);
+		return 1;
+	}
+	
+	FILE *wav = NULL;
+	if (argc == 1 && (wav = wavOpen(argv[0], LPC_SAMPLE_RATE)) == NULL) {
+		fprintf(stderr, "Cannot write %s\n", argv[0]);
+		schedulerDestroy(scheduler);
+		phraseIndexFree(&index);
+		return 1;
+	}
+	
+	// Announcements of 2 to 7 words arrive about every 5 seconds; urgent
+	// ones are rarer and have tighter deadlines
+	static const int weights[SCHEDULER_PRIORITIES] = { 1, 2, 4, 8 };
+	static const double deadlines[SCHEDULER_PRIORITIES] = { 5e6, 10e6, 20e6, 60e6 };
+	const double framePeriod = (double)LPC_FRAME_SAMPLES * 1e6 / LPC_SAMPLE_RATE;
+	const int totalFrames = seconds * (LPC_SAMPLE_RATE / LPC_FRAME_SAMPLES);
+	int16_t output[LPC_FRAME_SAMPLES];
+	double worstFrame = 0, renderTime = 0;
+	int busyFrames = 0;
+	
+	for (int frame = 0; frame < totalFrames; frame++) {
+		double now = frame * framePeriod;
+		
+		seed = seed * 1664525u + 1013904223u;
+		if ((seed >> 8) % 200 == 0) {
+			const phraseWord_t *words[8];
+			int wordCount = 2 + (seed >> 16) % 6;
+			for (int i = 0; i < wordCount; i++) {
+				seed = seed * 1664525u + 1013904223u;
+				words[i] = &index.words[(seed >> 8) % index.wordCount];
+			}
+			
+			seed = seed * 1664525u + 1013904223u;
+			int pick = (seed >> 8) % 15, priority = 0;
+			while (pick >= weights[priority]) pick -= weights[priority++];
+			
+			int frameCount = phraseAssemble(&index, words, wordCount, PHRASE_SMOOTH_JOINS, frames, LPC_MAX_WORD_FRAMES);
+			if (frameCount > 0) schedulerSubmit(scheduler, frames, frameCount, priority, now + deadlines[priority], now);
+		}
+		
+		double start = microseconds();
+		if (schedulerRenderFrame(scheduler, now, output) >= 0) busyFrames++;
+		double elapsed = microseconds() - start;
+		renderTime += elapsed;
+		if (elapsed > worstFrame) worstFrame = elapsed;
+		
+		if (wav) wavWrite(wav, output, LPC_FRAME_SAMPLES);
+	}
+	
+	printf("%s: %d seconds simulated, speaking %.0f%% of the time, %d utterances still queued\n",
+		image->name, seconds, 100.0 * busyFrames / totalFrames, schedulerPending(scheduler));
+	printf("Frame switch cost: mean %.1f us, worst %.1f us (preemption within one %.0f ms frame)\n",
+		renderTime / totalFrames, worstFrame, framePeriod / 1e3);
+	printf("Priority Submitted Completed Dropped Late Preempted  Start p50/p99 (ms)  Finish p50/p99 (ms)\n");
+	for (int priority = 0; priority < SCHEDULER_PRIORITIES; priority++) {
+		schedulerStats_t stats;
+		schedulerGetStats(scheduler, priority, &stats);
+		printf("%8d %9llu %9llu %7llu %4llu %9llu  %8.0f %8.0f  %9.0f %8.0f\n", priority,
+			(unsigned long long)stats.submitted, (unsigned long long)stats.completed,
+			(unsigned long long)stats.dropped, (unsigned long long)stats.deadlineMisses,
+			(unsigned long long)stats.preemptions, stats.startP50 / 1e3, stats.startP99 / 1e3,
+			stats.finishP50 / 1e3, stats.finishP99 / 1e3);
+	}
+	
+	if (wav) wavClose(wav);
+	schedulerDestroy(scheduler);
+	phraseIndexFree(&index);
+	return 0;
+}
+
+// Check and time seeking to every frame of every listed word through the
+// index, against parsing up to the frame from the start of the word
+static int seekAll(const frameIndex_t *index)
+{
+	static lpcFrame_t whole[LPC_MAX_WORD_FRAMES];
+	static uint32_t frameBits[LPC_MAX_WORD_FRAMES];
+	const phromImage_t *image = index->image;
+	long seeks = 0, mismatched = 0;
+	
+	for (int i = 0; i < index->wordCount; i++) {
+		int frameCount = frameIndexFrameCount(index, i);
+		lpcParseWordChip(index->chip, image->data, PHROM_SIZE, image->words[i].address, whole, LPC_MAX_WORD_FRAMES, NULL);
+		
+		for (int f = 0; f < frameCount; f++, seeks++) {
+			int count = frameIndexParse(index, i, f, frames, LPC_MAX_WORD_FRAMES);
+			if (count != frameCount - f || memcmp(frames, whole + f, count * sizeof(lpcFrame_t)) != 0) mismatched++;
+		}
+	}
+	
+	// Time locating each frame both ways
+	volatile uint32_t sink = 0;
+	double start = microseconds();
+	for (int i = 0; i < index->wordCount; i++) {
+		for (int f = 0; f < frameIndexFrameCount(index, i); f++) sink += frameIndexSeek(index, i, f)->bit;
+	}
+	double indexed = microseconds() - start;
+	
+	start = microseconds();
+	for (int i = 0; i < index->wordCount; i++) {
+		for (int f = 0; f < frameIndexFrameCount(index, i); f++) {
+			lpcParseFrames(index->chip, image->data, PHROM_SIZE, image->words[i].address * 8, NULL,
+				whole, frameBits, f + 1, NULL);
+			sink += frameBits[f];
+		}
+	}
+	double parsed = microseconds() - start;
+	
+	printf("%s: %ld frames in %d words indexed (%u bytes), %ld seeks differ from parsing the whole word\n",
+		image->name, seeks, index->wordCount, (unsigned)(index->entryCount * sizeof(frameIndexEntry_t)), mismatched);
+	printf("Locating a frame takes %.1f ns through the index, %.1f ns parsing from the start of the word\n",
+		indexed * 1e3 / seeks, parsed * 1e3 / seeks);
+	return mismatched ? 1 : 0;
+}
+
+// phromtool seek <image> [<word> <frame> <file.raw>] [--speed X]
+// [--pitch N] [--pitch-scale X] - render a word from one of its frames
+// through the frame index or, without a word, check seeking to every frame
+static int commandSeek(const phromImage_t *image, int argc, char *argv[])
+{
+	lpcSettings_t settings = { chipVariant, 0, 0, 0 };
+	if (takeVoice(&argc, argv, &settings) != 0) return 1;
+	if (argc != 0 && argc != 3) return -1;
+	
+	frameIndex_t index;
+	double start = microseconds();
+	if (frameIndexBuild(&index, image, chipVariant) != 0) return 1;
+	printf("Frame index built in %.0f us\n", microseconds() - start);
+	
+	if (argc == 0) {
+		int result = seekAll(&index);
+		frameIndexFree(&index);
+		return result;
+	}
+	
+	int32_t address = resolveWord(image, argv[0]);
+	int word = -1;
+	for (int i = 0; i < image->wordCount && address >= 0; i++) {
+		if (image->words[i].address == address) word = i;
+	}
+	int frame = atoi(argv[1]);
+	int frameCount = word < 0 ? -1 : frameIndexParse(&index, word, frame, frames, LPC_MAX_WORD_FRAMES);
+	frameIndexFree(&index);
+	if (frameCount < 0) {
+		fprintf(stderr, "Word %s (listed words only) has no frame %s\n", argv[0], argv[1]);
+		return 1;
+	}
+	
+	// The synthesiser starts afresh at the frame, as at the start of a word
+	int sampleCount = lpcRender(&settings, frames, frameCount, samples);
+	FILE *file = fopen(argv[2], "wb");
+	if (file == NULL) {
+		fprintf(stderr, "Cannot create %s\n", argv[2]);
+		return 1;
+	}
+	fwrite(samples, sizeof(int16_t), sampleCount, file);
+	fclose(file);
+	
+	printf("Wrote %d frames from frame %d (%d samples, 8KHz 16-bit mono) to %s\n", frameCount, frame, sampleCount, argv[2]);
+	return 0;
+}
+
+// phromtool stream <image> - feed every listed word through the
+// incremental synthesiser a byte and a bit at a time, checking the PCM
+// matches whole-word rendering and that each frame plays on its last bit
+static int commandStream(const phromImage_t *image, int argc, char *argv[])
+{
+	static int16_t streamed[LPC_MAX_WORD_FRAMES * LPC_FRAME_SAMPLES];
+	lpcSettings_t settings = { chipVariant, 0, 0, 0 };
+	(void)argv;
+	if (argc != 0) return -1;
+	
+	lpcStream_t stream;
+	int mismatched = 0, late = 0, words = 0, maxBits = 0;
+	double elapsed = 0;
+	
+	for (int i = 0; i < image->wordCount; i++) {
+		uint32_t endBit;
+		uint16_t address = image->words[i].address;
+		int frameCount = lpcParseWordChip(chipVariant, image->data, PHROM_SIZE, address, frames, LPC_MAX_WORD_FRAMES, &endBit);
+		if (frameCount < 0) continue;
+		int sampleCount = lpcRender(&settings, frames, frameCount, samples);
+		words++;
+		
+		// A byte at a time, reading whatever is ready after each byte
+		double start = microseconds();
+		int streamedCount = 0;
+		lpcStreamInitialise(&stream, &settings);
+		for (uint32_t offset = address; !lpcStreamFinished(&stream) && offset < PHROM_SIZE;) {
+			offset += lpcStreamWrite(&stream, image->data + offset, 1);
+			if ((int)stream.reader.bufferBits > maxBits) maxBits = stream.reader.bufferBits;
+			streamedCount += lpcStreamRead(&stream, streamed + streamedCount, sampleCount - streamedCount);
+		}
+		elapsed += microseconds() - start;
+		if (streamedCount != sampleCount || memcmp(streamed, samples, sampleCount * sizeof(int16_t)) != 0) mismatched++;
+		
+		// A bit at a time; each frame's PCM must be readable on its last bit
+		lpcStreamInitialise(&stream, &settings);
+		uint32_t frameEnd = 0;
+		for (int f = 0; f < frameCount; f++) {
+			frameEnd += lpcFrameBits(chipVariant, &frames[f]);
+			while (bitReaderTell(&stream.reader) + stream.reader.bufferBits < frameEnd) {
+				uint32_t bit = address * 8 + bitReaderTell(&stream.reader) + stream.reader.bufferBits;
+				lpcStreamWriteBit(&stream, (image->data[bit / 8] >> (bit % 8)) & 1);
+			}
+			if (lpcStreamRead(&stream, streamed, LPC_FRAME_SAMPLES) != LPC_FRAME_SAMPLES) late++;
+		}
+	}
+	
+	printf("%s: %d words streamed a byte at a time in %.1f ms, %d differ from whole-word rendering\n",
+		image->name, words, elapsed / 1e3, mismatched);
+	printf("At most %d undecoded bits buffered; %d frames not ready on their last bit\n", maxBits, late);
+	return mismatched || late ? 1 : 0;
+}
+
+// Print one utterance decoded from a bus trace
+static void traceUtterance(const busTraceUtterance_t *utterance, void *argument)
+{
+	const phromImage_t *image = argument;
+	uint32_t bank = (utterance->address >> 14) & 0xF, local = utterance->address & 0x3FFF;
+	const phromWord_t *word = bank == image->bank ? phromFindWordAddress(image, local) : NULL;
+	
+	printf("%12llu  %X %04X  %6u bits %4u frames %6.2f s  %s", (unsigned long long)utterance->sampleOffset,
+		bank, local, utterance->bits, utterance->frames, (double)utterance->samples / LPC_SAMPLE_RATE,
+		word ? word->word : "");
+	if (utterance->mismatchedBits) printf("  %u bits differ from %s", utterance->mismatchedBits, image->name);
+	if (!utterance->complete) printf("  (no stop frame)");
+	printf("\n");
+}
+
+// phromtool trace <image> <capture> [<file.wav>] [--map m0,m1,a1,a2,a4,a8]
+// - rebuild the speech from a logic analyser capture of the bus
+static int commandTrace(const phromImage_t *image, int argc, char *argv[])
+{
+	busTraceChannels_t channels = busTraceDefaultChannels;
+	lpcSettings_t settings = { chipVariant, 0, 0, 0 };
+	
+	for (int i = 0; i + 1 < argc; i++) {
+		if (strcmp(argv[i], "--map") == 0) {
+			unsigned m0, m1, add1, add2, add4, add8;
+			if (sscanf(argv[i + 1], "%u,%u,%u,%u,%u,%u", &m0, &m1, &add1, &add2, &add4, &add8) != 6 ||
+				(m0 | m1 | add1 | add2 | add4 | add8) > 7) return -1;
+			channels = (busTraceChannels_t){ m0, m1, add1, add2, add4, add8 };
+			for (int j = i; j + 2 < argc; j++) argv[j] = argv[j + 2];
+			argc -= 2;
+			break;
+		}
+	}
+	if (argc != 1 && argc != 2) return -1;
+	
+	FILE *capture = strcmp(argv[0], "-") == 0 ? stdin : fopen(argv[0], "rb");
+	if (capture == NULL) {
+		fprintf(stderr, "Cannot read %s\n", argv[0]);
+		return 1;
+	}
+	FILE *wav = argc == 2 ? wavOpen(argv[1], LPC_SAMPLE_RATE) : NULL;
+	if (argc == 2 && wav == NULL) {
+		fprintf(stderr, "Cannot write %s\n", argv[1]);
+		if (capture != stdin) fclose(capture);
+		return 1;
+	}
+	
+	busTraceStats_t stats;
+	printf("      Sample  Address    Read      Decoded   Spoken  Word\n");
+	double start = microseconds();
+	int result = busTraceDecode(capture, &channels, image, &settings, wav, traceUtterance, (void *)image, &stats);
+	double elapsed = microseconds() - start;
+	
+	if (capture != stdin) fclose(capture);
+	if (wav && wavClose(wav) != 0) result = -1;
+	
+	fprintf(stderr, "%llu samples (%.1f MB/s): %llu address nibbles, %llu bits read, %llu utterances, %.1f seconds of speech\n",
+		(unsigned long long)stats.samples, stats.samples / elapsed, (unsigned long long)stats.loads,
+		(unsigned long long)stats.reads, (unsigned long long)stats.utterances,
+		(double)stats.pcmSamples / LPC_SAMPLE_RATE);
+	return result == 0 ? 0 : 1;
+}
+
+static void usage(void)
+{
+	// One string per command keeps each literal within C99's limits
+	static const char *const help[] = {
+		"Usage: phromtool <command> <image> [--words <list>] [--chip <chip>] [arguments]\n"
+		"\n"
+		"Images are \"acorn\", \"us\" or the path of a 16K .bin dump\n"
+		"Chips are tms5220 (the default), tms5200, tms5220c or tms5110 (for say,\n"
+		"the chip is the one the daemon was started with)\n"
+		"Word lists use the romdata header format (number, hex address, word)\n"
+		"Words are a listed word number or a 0x prefixed address\n"
+		"\n"
+		"Commands:\n",
+		"  frames <image> <word>   Print the LPC frames of a word\n",
+		"  parse <image>           Parse every listed word\n",
+		"  synth <image> [<word> <file.raw>] [--lanes N] [--speed X] [--pitch N]\n"
+		"        [--pitch-scale X]\n"
+		"                          Render a word to 8KHz 16-bit PCM (or time\n"
+		"                          rendering every listed word).  --lanes\n"
+		"                          renders 4, 8 or 16 words at once, bit-exact;\n"
+		"                          voice options are as for phrase\n",
+		"  render <image> <directory> [--threads N] [--lanes N]\n"
+		"                          Render every listed word to WAV files and a\n"
+		"                          concatenated sample bank (--lanes renders\n"
+		"                          through 4, 8 or 16 lanes, as for synth)\n",
+		"  compare <image> [--lanes N] [--threads N]\n"
+		"                          Render every listed word through the lane\n"
+		"                          renderer (4, 8 and 16 lanes, or N) and report\n"
+		"                          its maximum deviation from the reference\n",
+		"  scan <image>            Discover word start addresses and print a\n"
+		"                          word list\n",
+		"  phrase <image> <file.wav> <word>... [--smooth] [--rate N]\n"
+		"         [--quality 0-2] [--speed X] [--pitch N] [--pitch-scale X]\n"
+		"                          Render a phrase (words may also be given as\n"
+		"                          text), each word through the PCM cache;\n"
+		"                          --smooth instead synthesises across the\n"
+		"                          joins, trimming the silence at each,\n"
+		"                          --rate resamples the output (e.g. to 48000),\n"
+		"                          --speed plays it 0.5 to 2 times as fast,\n"
+		"                          --pitch moves the voice N pitch table steps\n"
+		"                          (positive is lower) and --pitch-scale\n"
+		"                          multiplies its pitch by 0.5 to 2\n",
+		"  cache <image> [--phrases N] [--kbytes N] [--threads N]\n"
+		"                          Benchmark rendering random phrases through the\n"
+		"                          PCM cache and report its hit rate\n",
+		"  bank <image> <file.bank> [<word> <file.wav>] [--threads N]\n"
+		"       [--lanes N] [--speed X] [--pitch N] [--pitch-scale X]\n"
+		"                          Map a pre-rendered sample bank (rewriting it\n"
+		"                          if the image or settings have changed) and\n"
+		"                          optionally extract a word\n",
+		"  seek <image> [<word> <frame> <file.raw>] [--speed X] [--pitch N]\n"
+		"       [--pitch-scale X]\n"
+		"                          Render a word from one of its frames through\n"
+		"                          the frame index (or check and time seeking to\n"
+		"                          every frame)\n",
+		"  stream <image>\n"
+		"                          Check incremental (byte or bit at a time)\n"
+		"                          synthesis matches whole-word rendering\n",
+		"  trace <image> <capture> [<file.wav>] [--map m0,m1,a1,a2,a4,a8]\n"
+		"                          Rebuild the speech from a logic analyser\n"
+		"                          capture of the bus (one byte per sample;\n"
+		"                          --map gives each signal's bit, default\n"
+		"                          0,1,2,3,4,5)\n",
+		"  schedule <image> [<file.wav>] [--seconds N] [--seed N]\n"
+		"                          Simulate prioritised announcements through the\n"
+		"                          preemptive utterance scheduler\n",
+		"  serve <image> <socket> [--threads N] [--batch-us N] [--kbytes N]\n"
+		"                          Run the speech daemon on a Unix socket,\n"
+		"                          caching up to N kbytes of word PCM\n",
+		"  say <socket> <file.wav> <word>... [--clients N] [--repeat N]\n"
+		"      [--ring N] [--smooth] [--speed X] [--pitch N]\n"
+		"      [--pitch-scale X]\n"
+		"                          Request a phrase from the daemon (and\n"
+		"                          optionally measure latency under load);\n"
+		"                          --ring receives PCM through a shared memory\n"
+		"                          ring of N samples\n",
+		"  encode <file.wav> <file.lpc> [--preview <file.wav>] [--optimise]\n"
+		"         [--distortion dB] [--threads N]\n"
+		"                          Encode a recording (any rate, resampled to\n"
+		"                          8KHz) into the chip's LPC frames; --preview\n"
+		"                          renders the result, --optimise chooses frames\n"
+		"                          for the fewest bits within a mean spectral\n"
+		"                          distortion (by default the plain encoding's)\n",
+		"  pitch <file.wav> [--threads N] [--track]\n"
+		"                          Track the pitch and voicing of a recording of\n"
+		"                          any length in parallel (--track lists every\n"
+		"                          frame's pitch index, period and periodicity)\n",
+		"  corpus <manifest> <directory> [--threads N] [--optimise]\n"
+		"         [--distortion dB]\n"
+		"                          Encode the recordings of a manifest (lines of\n"
+		"                          number, file.wav and word) in parallel,\n"
+		"                          caching the frames in the directory so only\n"
+		"                          changed recordings are encoded again\n",
+		"  build <manifest> <directory> <output> [--bank N] [--banks N]\n"
+		"        [--threads N] [--optimise] [--distortion dB]\n"
+		"                          Encode a manifest (through the corpus cache)\n"
+		"                          and pack as many words as fit into each of up\n"
+		"                          to N 16K banks from PHROM_BANK --bank, written\n"
+		"                          as <output>.bin and a romdata header\n"
+		"                          <output>.h (<output>_<bank> for several)\n",
+	};
+	
+	for (size_t i = 0; i < sizeof(help) / sizeof(help[0]); i++) fputs(help[i], stderr);
+}
+
+// Main function
+int main(int argc, char *argv[])
+{
+	static const struct {
+		const char *name;
+		int (*handler)(const phromImage_t *image, int argc, char *argv[]);
+		int needsImage;
+	} commands[] = {
+		{ "frames", commandFrames, 1 },
+		{ "parse", commandParse, 1 },
+		{ "synth", commandSynth, 1 },
+		{ "render", commandRender, 1 },
+		{ "compare", commandCompare, 1 },
+		{ "scan", commandScan, 1 },
+		{ "phrase", commandPhrase, 1 },
+		{ "cache", commandCache, 1 },
+		{ "bank", commandBank, 1 },
+		{ "seek", commandSeek, 1 },
+		{ "stream", commandStream, 1 },
+		{ "trace", commandTrace, 1 },
+		{ "schedule", commandSchedule, 1 },
+		{ "serve", commandServe, 1 },
+		{ "say", commandSay, 0 },
+		{ "encode", commandEncode, 0 },
+		{ "pitch", commandPitch, 0 },
+		{ "corpus", commandCorpus, 0 },
+		{ "build", commandBuild, 0 },
+	};
+	
+	// The speech chip may be given for any command (say refuses it, as the
+	// daemon speaks as the chip it was started with)
+	for (int i = 2; i + 1 < argc; i++) {
+		if (strcmp(argv[i], "--chip") == 0) {
+			chipVariant = lpcFindChip(argv[i + 1]);
+			chipGiven = 1;
+			if (chipVariant < 0) {
+				fprintf(stderr, "Unknown chip %s (tms5220, tms5200, tms5220c or tms5110)\n", argv[i + 1]);
+				return 1;
+			}
+			for (int j = i; j + 2 < argc; j++) argv[j] = argv[j + 2];
+			argc -= 2;
+			break;
+		}
+	}
+	
+	int command = -1;
+	for (size_t i = 0; argc >= 2 && i < sizeof(commands) / sizeof(commands[0]); i++) {
+		if (strcmp(argv[1], commands[i].name) == 0) command = i;
+	}
+	if (command < 0 || argc < 3) {
+		usage();
+		return 1;
+	}
+	
+	// Client commands take their arguments straight after the command
+	if (!commands[command].needsImage) {
+		int result = commands[command].handler(NULL, argc - 2, argv + 2);
+		if (result < 0) usage();
+		return result < 0 ? 1 : result;
+	}
+	
+	phromImage_t image;
+	if (phromOpenImage(argv[2], &image) != 0) {
+		fprintf(stderr, "Cannot open image %s\n", argv[2]);
+		return 1;
+	}
+	
+	// A word list may be given for any image
+	int argumentCount = argc - 3;
+	char **arguments = argv + 3;
+	for (int i = 0; i + 1 < argumentCount; i++) {
+		if (strcmp(arguments[i], "--words") == 0) {
+			if (phromLoadWordList(&image, arguments[i + 1]) < 0) {
+				fprintf(stderr, "Cannot read word list %s\n", arguments[i + 1]);
+				phromCloseImage(&image);
+				return 1;
+			}
+			for (int j = i; j + 2 < argumentCount; j++) arguments[j] = arguments[j + 2];
+			argumentCount -= 2;
+			break;
+		}
+	}
+	
+	int result = commands[command].handler(&image, argumentCount, arguments);
+	
+	if (result < 0) usage();
+	phromCloseImage(&image);
+	return result < 0 ? 1 : result;
+}
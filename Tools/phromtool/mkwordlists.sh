@@ -0,0 +1,82 @@
+#!/bin/sh
+#
+# mkwordlists.sh - regenerate phromwords.h from the word lists in the
+# comments of the romdata headers, so the headers stay the one source
+#
+# Run from Tools/phromtool after changing either romdata header:
+#
+#     sh mkwordlists.sh > phromwords.h
+#
+
+ROMDATA=../../Firmware/tms6100
+
+# Print the word list in a romdata header as a phromWord_t table
+wordList()
+{
+	echo "static const phromWord_t $2[] = {"
+	awk '
+		# Not every awk reads hex constants, so convert by hand
+		function hex(text,    value, i) {
+			value = 0
+			for (i = 1; i <= length(text); i++)
+				value = value * 16 + index("0123456789ABCDEF", toupper(substr(text, i, 1))) - 1
+			return value
+		}
+		
+		/PHROM Word list:/ { inList = 1; next }
+		inList && /\*\// { exit }
+		inList && $1 ~ /^[0-9]+$/ && $2 ~ /^[0-9A-Fa-f]+$/ && NF > 2 {
+			word = $0
+			sub(/^[ \t]*[0-9]+[ \t]+[0-9A-Fa-f]+[ \t]+/, "", word)
+			sub(/[ \t\r]+$/, "", word)
+			gsub(/\\/, "\\\\", word)
+			gsub(/"/, "\\\"", word)
+			printf "\t{ %d, 0x%04X, \"%s\" },\n", $1, hex($2), word
+		}
+	' "$ROMDATA/$1"
+	echo "};"
+}
+
+cat <<'HEADER'
+/************************************************************************
+	phromwords.h
+
+    Word lists of the built-in PHROM images
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+// Generated by mkwordlists.sh from the comments in the romdata headers;
+// do not edit (change the header and run the script again)
+
+#ifndef PHROMWORDS_H_
+#define PHROMWORDS_H_
+
+HEADER
+
+wordList romdata_acorn.h phromWordsAcorn
+echo
+wordList romdata_us.h phromWordsUs
+
+cat <<'FOOTER'
+
+#endif /* PHROMWORDS_H_ */
+FOOTER
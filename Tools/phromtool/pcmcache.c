@@ -0,0 +1,249 @@
+/************************************************************************
+	pcmcache.c
+
+    Size-bounded LRU cache of rendered word PCM
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+// The cache is split into shards by key hash, each with its own lock, hash
+// table and LRU list, so concurrent lookups of different words rarely
+// contend.  Each shard holds an equal share of the byte budget.
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pcmcache.h"
+#include "lpcframe.h"
+
+#define PCMCACHE_SHARDS		16
+#define PCMCACHE_BUCKETS	256		// Per shard (a power of 2)
+
+typedef struct pcmCacheEntry {
+	pcmCacheKey_t key;
+	uint32_t hash;
+	struct pcmCacheEntry *nextInBucket;
+	struct pcmCacheEntry *newer, *older;	// LRU list
+	int sampleCount;
+	int16_t samples[];
+} pcmCacheEntry_t;
+
+typedef struct {
+	pthread_mutex_t lock;
+	pcmCacheEntry_t *buckets[PCMCACHE_BUCKETS];
+	pcmCacheEntry_t *newest, *oldest;
+	size_t bytes, maxBytes;
+	uint32_t entries;
+	uint64_t hits, misses, evictions;
+} pcmCacheShard_t;
+
+struct pcmCache {
+	pcmCacheShard_t shards[PCMCACHE_SHARDS];
+	size_t maxBytes;
+};
+
+static uint32_t hashKey(const pcmCacheKey_t *key)
+{
+	uint64_t hash = key->imageHash ^ ((uint64_t)key->settings << 16) ^ key->address;
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	return (uint32_t)hash;
+}
+
+static int keysEqual(const pcmCacheKey_t *a, const pcmCacheKey_t *b)
+{
+	return a->imageHash == b->imageHash && a->settings == b->settings && a->address == b->address;
+}
+
+static size_t entryBytes(const pcmCacheEntry_t *entry)
+{
+	return entry->sampleCount * sizeof(int16_t);
+}
+
+pcmCache_t *pcmCacheCreate(size_t maxBytes)
+{
+	pcmCache_t *cache = calloc(1, sizeof(pcmCache_t));
+	if (cache == NULL) return NULL;
+	
+	cache->maxBytes = maxBytes;
+	for (int i = 0; i < PCMCACHE_SHARDS; i++) {
+		pthread_mutex_init(&cache->shards[i].lock, NULL);
+		cache->shards[i].maxBytes = maxBytes / PCMCACHE_SHARDS;
+	}
+	
+	return cache;
+}
+
+void pcmCacheDestroy(pcmCache_t *cache)
+{
+	if (cache == NULL) return;
+	
+	for (int i = 0; i < PCMCACHE_SHARDS; i++) {
+		pcmCacheEntry_t *entry = cache->shards[i].newest;
+		while (entry) {
+			pcmCacheEntry_t *older = entry->older;
+			free(entry);
+			entry = older;
+		}
+		pthread_mutex_destroy(&cache->shards[i].lock);
+	}
+	
+	free(cache);
+}
+
+// LRU list handling (the shard lock must be held)
+static void unlinkEntry(pcmCacheShard_t *shard, pcmCacheEntry_t *entry)
+{
+	if (entry->newer) entry->newer->older = entry->older;
+	else shard->newest = entry->older;
+	if (entry->older) entry->older->newer = entry->newer;
+	else shard->oldest = entry->newer;
+}
+
+static void linkNewest(pcmCacheShard_t *shard, pcmCacheEntry_t *entry)
+{
+	entry->newer = NULL;
+	entry->older = shard->newest;
+	if (shard->newest) shard->newest->newer = entry;
+	shard->newest = entry;
+	if (shard->oldest == NULL) shard->oldest = entry;
+}
+
+// Remove an entry from the shard and free it (the shard lock must be held)
+static void removeEntry(pcmCacheShard_t *shard, pcmCacheEntry_t *entry)
+{
+	pcmCacheEntry_t **link = &shard->buckets[entry->hash & (PCMCACHE_BUCKETS - 1)];
+	while (*link != entry) link = &(*link)->nextInBucket;
+	*link = entry->nextInBucket;
+	
+	unlinkEntry(shard, entry);
+	shard->bytes -= entryBytes(entry);
+	shard->entries--;
+	free(entry);
+}
+
+static pcmCacheEntry_t *findEntry(pcmCacheShard_t *shard, const pcmCacheKey_t *key, uint32_t hash)
+{
+	pcmCacheEntry_t *entry = shard->buckets[hash & (PCMCACHE_BUCKETS - 1)];
+	while (entry && !(entry->hash == hash && keysEqual(&entry->key, key))) entry = entry->nextInBucket;
+	return entry;
+}
+
+// Copy a cached rendering into output
+int pcmCacheGet(pcmCache_t *cache, const pcmCacheKey_t *key, int16_t *output, int maxSamples)
+{
+	uint32_t hash = hashKey(key);
+	pcmCacheShard_t *shard = &cache->shards[(hash >> 24) % PCMCACHE_SHARDS];
+	int sampleCount = -1;
+	
+	pthread_mutex_lock(&shard->lock);
+	pcmCacheEntry_t *entry = findEntry(shard, key, hash);
+	if (entry && entry->sampleCount <= maxSamples) {
+		memcpy(output, entry->samples, entryBytes(entry));
+		sampleCount = entry->sampleCount;
+		
+		// Mark as most recently used
+		unlinkEntry(shard, entry);
+		linkNewest(shard, entry);
+		shard->hits++;
+	} else {
+		shard->misses++;
+	}
+	pthread_mutex_unlock(&shard->lock);
+	
+	return sampleCount;
+}
+
+// Add a rendering
+void pcmCachePut(pcmCache_t *cache, const pcmCacheKey_t *key, const int16_t *samples, int sampleCount)
+{
+	uint32_t hash = hashKey(key);
+	pcmCacheShard_t *shard = &cache->shards[(hash >> 24) % PCMCACHE_SHARDS];
+	size_t bytes = sampleCount * sizeof(int16_t);
+	
+	// Renderings bigger than a whole shard are never kept
+	if (bytes > shard->maxBytes) return;
+	
+	// Build the entry outside the lock
+	pcmCacheEntry_t *entry = malloc(sizeof(pcmCacheEntry_t) + bytes);
+	if (entry == NULL) return;
+	entry->key = *key;
+	entry->hash = hash;
+	entry->sampleCount = sampleCount;
+	memcpy(entry->samples, samples, bytes);
+	
+	pthread_mutex_lock(&shard->lock);
+	
+	pcmCacheEntry_t *existing = findEntry(shard, key, hash);
+	if (existing) removeEntry(shard, existing);
+	
+	while (shard->bytes + bytes > shard->maxBytes && shard->oldest) {
+		removeEntry(shard, shard->oldest);
+		shard->evictions++;
+	}
+	
+	pcmCacheEntry_t **bucket = &shard->buckets[hash & (PCMCACHE_BUCKETS - 1)];
+	entry->nextInBucket = *bucket;
+	*bucket = entry;
+	linkNewest(shard, entry);
+	shard->bytes += bytes;
+	shard->entries++;
+	
+	pthread_mutex_unlock(&shard->lock);
+}
+
+// Render the word at address through the cache
+int pcmCacheRenderWord(pcmCache_t *cache, const phromImage_t *image, uint16_t address,
+	const lpcSettings_t *settings, int16_t *output, int maxSamples)
+{
+	pcmCacheKey_t key = { image->hash, lpcSettingsKey(settings), address };
+	
+	int sampleCount = pcmCacheGet(cache, &key, output, maxSamples);
+	if (sampleCount >= 0) return sampleCount;
+	
+	lpcFrame_t frames[LPC_MAX_WORD_FRAMES];
+	int frameCount = lpcParse(settings, image, address, frames, LPC_MAX_WORD_FRAMES, NULL);
+	if (frameCount < 0) return frameCount;
+	if (frameCount * lpcFrameSamples(settings) > maxSamples) return LPC_PARSE_TOOLONG;
+	
+	sampleCount = lpcRender(settings, frames, frameCount, output);
+	pcmCachePut(cache, &key, output, sampleCount);
+	return sampleCount;
+}
+
+void pcmCacheGetStats(pcmCache_t *cache, pcmCacheStats_t *stats)
+{
+	memset(stats, 0, sizeof(pcmCacheStats_t));
+	stats->maxBytes = cache->maxBytes;
+	
+	for (int i = 0; i < PCMCACHE_SHARDS; i++) {
+		pcmCacheShard_t *shard = &cache->shards[i];
+		pthread_mutex_lock(&shard->lock);
+		stats->hits += shard->hits;
+		stats->misses += shard->misses;
+		stats->evictions += shard->evictions;
+		stats->bytes += shard->bytes;
+		stats->entries += shard->entries;
+		pthread_mutex_unlock(&shard->lock);
+	}
+}
@@ -0,0 +1,75 @@
+/************************************************************************
+	pcmcache.h
+
+    Size-bounded LRU cache of rendered word PCM
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef PCMCACHE_H_
+#define PCMCACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lpcrender.h"
+#include "phromimage.h"
+
+// Rendered PCM is keyed by the image, the word's start address and the
+// synthesis settings, so a hit is always a copy of exactly what the
+// synthesiser would have produced.
+
+typedef struct {
+	uint64_t imageHash;
+	uint32_t settings;		// From lpcSettingsKey()
+	uint16_t address;
+} pcmCacheKey_t;
+
+typedef struct {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	size_t bytes;			// PCM bytes currently held
+	size_t maxBytes;
+	uint32_t entries;
+} pcmCacheStats_t;
+
+typedef struct pcmCache pcmCache_t;
+
+// Create a cache holding at most maxBytes of PCM (safe to share between threads)
+pcmCache_t *pcmCacheCreate(size_t maxBytes);
+void pcmCacheDestroy(pcmCache_t *cache);
+
+// Copy a cached rendering into output; returns the sample count or -1 on a
+// miss (or if the rendering is longer than maxSamples)
+int pcmCacheGet(pcmCache_t *cache, const pcmCacheKey_t *key, int16_t *output, int maxSamples);
+
+// Add a rendering (replacing any existing entry for the key)
+void pcmCachePut(pcmCache_t *cache, const pcmCacheKey_t *key, const int16_t *samples, int sampleCount);
+
+// Render the word at address through the cache; returns the sample count
+// or a LPC_PARSE_ error if the word does not parse
+int pcmCacheRenderWord(pcmCache_t *cache, const phromImage_t *image, uint16_t address,
+	const lpcSettings_t *settings, int16_t *output, int maxSamples);
+
+void pcmCacheGetStats(pcmCache_t *cache, pcmCacheStats_t *stats);
+
+#endif /* PCMCACHE_H_ */
@@ -0,0 +1,186 @@
+/************************************************************************
+	pcmring.c
+
+    Shared-memory single-producer single-consumer PCM ring
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+// memfd_create() and file seals are Linux extensions
+#define _GNU_SOURCE
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pcmring.h"
+
+static size_t ringBytes(uint32_t capacity)
+{
+	return sizeof(pcmRingHeader_t) + (size_t)capacity * sizeof(int16_t);
+}
+
+// Create a ring in sealed anonymous memory
+int pcmRingCreate(uint32_t capacity, pcmRing_t *ring)
+{
+	uint32_t size = 1024;
+	while (size < capacity && size < (1u << 30)) size <<= 1;
+	
+	// A failed ring must still be safe to pass to pcmRingClose()
+	memset(ring, 0, sizeof(pcmRing_t));
+	ring->fd = -1;
+	ring->shared = NULL;
+	
+	int fd = memfd_create("phromtool-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd < 0) return -1;
+	ring->size = ringBytes(size);
+	
+	// Once sealed the size is fixed, so the producer can map it without
+	// the consumer being able to truncate it under it (SIGBUS)
+	if (ftruncate(fd, ring->size) != 0 || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+		close(fd);
+		return -1;
+	}
+	
+	ring->shared = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (ring->shared == MAP_FAILED) {
+		ring->shared = NULL;
+		close(fd);
+		return -1;
+	}
+	
+	ring->fd = fd;
+	ring->mask = size - 1;
+	ring->shared->magic = PCMRING_MAGIC;
+	ring->shared->capacity = size;
+	return 0;
+}
+
+// Map a ring created by the peer
+int pcmRingAttach(int fd, pcmRing_t *ring)
+{
+	struct stat status;
+	memset(ring, 0, sizeof(pcmRing_t));
+	ring->fd = -1;
+	ring->shared = NULL;
+	
+	// Only a region that can no longer change size is safe to map
+	int seals = fcntl(fd, F_GET_SEALS);
+	if (seals < 0 || (seals & (F_SEAL_SHRINK | F_SEAL_GROW)) != (F_SEAL_SHRINK | F_SEAL_GROW) ||
+		fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(pcmRingHeader_t)) {
+		close(fd);
+		return -1;
+	}
+	
+	ring->size = status.st_size;
+	ring->shared = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (ring->shared == MAP_FAILED) {
+		ring->shared = NULL;
+		return -1;
+	}
+	
+	// The capacity is read once; the peer cannot change it under us
+	uint32_t capacity = ring->shared->capacity;
+	if (ring->shared->magic != PCMRING_MAGIC || capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+		ringBytes(capacity) > ring->size) {
+		munmap(ring->shared, ring->size);
+		ring->shared = NULL;
+		return -1;
+	}
+	
+	ring->mask = capacity - 1;
+	ring->position = __atomic_load_n(&ring->shared->head, __ATOMIC_RELAXED);
+	return 0;
+}
+
+void pcmRingClose(pcmRing_t *ring)
+{
+	if (ring->shared) munmap(ring->shared, ring->size);
+	if (ring->fd >= 0) close(ring->fd);
+	ring->shared = NULL;
+	ring->fd = -1;
+}
+
+// Producer: copy up to count samples in
+int pcmRingWrite(pcmRing_t *ring, const int16_t *samples, uint32_t count)
+{
+	uint64_t head = ring->position;
+	uint64_t tail = __atomic_load_n(&ring->shared->tail, __ATOMIC_ACQUIRE);
+	
+	// The consumer is untrusted; a tail outside the written range is fatal
+	if (tail > head || head - tail > ring->mask + 1) return -1;
+	
+	uint32_t space = ring->mask + 1 - (uint32_t)(head - tail);
+	if (count > space) count = space;
+	
+	uint32_t start = head & ring->mask;
+	uint32_t first = ring->mask + 1 - start;
+	if (first > count) first = count;
+	memcpy(ring->shared->samples + start, samples, first * sizeof(int16_t));
+	memcpy(ring->shared->samples, samples + first, (count - first) * sizeof(int16_t));
+	
+	ring->position = head + count;
+	__atomic_store_n(&ring->shared->head, ring->position, __ATOMIC_RELEASE);
+	return count;
+}
+
+// Consumer: the samples readable without copying
+uint32_t pcmRingPeek(pcmRing_t *ring, const int16_t **samples)
+{
+	uint64_t tail = ring->position;
+	uint64_t head = __atomic_load_n(&ring->shared->head, __ATOMIC_ACQUIRE);
+	
+	uint32_t available = (uint32_t)(head - tail);
+	uint32_t start = tail & ring->mask;
+	if (available > ring->mask + 1 - start) available = ring->mask + 1 - start;
+	
+	*samples = ring->shared->samples + start;
+	return available;
+}
+
+void pcmRingConsume(pcmRing_t *ring, uint32_t count)
+{
+	ring->position += count;
+	__atomic_store_n(&ring->shared->tail, ring->position, __ATOMIC_RELEASE);
+}
+
+// Consumer: copy up to count samples out
+uint32_t pcmRingRead(pcmRing_t *ring, int16_t *samples, uint32_t count)
+{
+	uint32_t total = 0;
+	
+	// At most two pieces (either side of the wrap)
+	for (int piece = 0; piece < 2 && total < count; piece++) {
+		const int16_t *source;
+		uint32_t available = pcmRingPeek(ring, &source);
+		if (available == 0) break;
+		if (available > count - total) available = count - total;
+		memcpy(samples + total, source, available * sizeof(int16_t));
+		pcmRingConsume(ring, available);
+		total += available;
+	}
+	
+	return total;
+}
@@ -0,0 +1,86 @@
+/************************************************************************
+	pcmring.h
+
+    Shared-memory single-producer single-consumer PCM ring
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef PCMRING_H_
+#define PCMRING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A ring of 16-bit samples in a shared memory region.  head counts the
+// samples ever written and is stored only by the producer; tail counts the
+// samples ever read and is stored only by the consumer.  Each is published
+// with a release store and read with an acquire load, so no locks or
+// system calls are needed to move samples.  The two counters sit on their
+// own cache lines so the two sides do not false-share.
+
+#define PCMRING_MAGIC		0x474E4952		// "RING"
+#define PCMRING_LINE		64
+
+typedef struct {
+	uint32_t magic;
+	uint32_t capacity;		// Samples (a power of 2)
+	uint8_t reserved0[PCMRING_LINE - 8];
+	uint64_t head;
+	uint8_t reserved1[PCMRING_LINE - 8];
+	uint64_t tail;
+	uint8_t reserved2[PCMRING_LINE - 8];
+	int16_t samples[];
+} pcmRingHeader_t;
+
+typedef struct {
+	pcmRingHeader_t *shared;
+	size_t size;			// Bytes mapped
+	int fd;					// Backing memfd (for passing to the peer)
+	uint32_t mask;
+	uint64_t position;		// Private copy of our own counter
+} pcmRing_t;
+
+// Create a ring of at least capacity samples in anonymous shared memory
+// sealed against resizing (the creating side is the consumer).  Returns
+// 0 or -1.
+int pcmRingCreate(uint32_t capacity, pcmRing_t *ring);
+
+// Map a ring created by the peer from its descriptor (taking ownership
+// of the descriptor); the attaching side is the producer.  Descriptors
+// not sealed against shrinking and growing are refused.  Returns 0 or -1.
+int pcmRingAttach(int fd, pcmRing_t *ring);
+
+void pcmRingClose(pcmRing_t *ring);
+
+// Producer: copy up to count samples in; returns the number written
+// (0 when full) or -1 if the peer has corrupted the counters
+int pcmRingWrite(pcmRing_t *ring, const int16_t *samples, uint32_t count);
+
+// Consumer: the samples readable without copying (up to the end of the
+// ring), then release them once used
+uint32_t pcmRingPeek(pcmRing_t *ring, const int16_t **samples);
+void pcmRingConsume(pcmRing_t *ring, uint32_t count);
+
+// Consumer: copy up to count samples out; returns the number read
+uint32_t pcmRingRead(pcmRing_t *ring, int16_t *samples, uint32_t count);
+
+#endif /* PCMRING_H_ */
@@ -0,0 +1,224 @@
+/************************************************************************
+	phrase.c
+
+    Phrase assembly from pre-indexed PHROM words
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "phrase.h"
+
+// Joins between edges whose energy indexes differ by more than this keep
+// one silent frame, so the level ramps down and up rather than stepping
+#define PHRASE_ENERGY_STEP	4
+
+// Build the index of an image (returns 0 on success or -1 on failure)
+int phraseIndexBuild(phraseIndex_t *index, const phromImage_t *image, int chip)
+{
+	lpcFrame_t *frames = malloc(LPC_MAX_WORD_FRAMES * sizeof(lpcFrame_t));
+	uint32_t capacity = 4096;
+	
+	index->image = image;
+	index->chip = chip;
+	index->frames = malloc(capacity * sizeof(lpcFrame_t));
+	index->frameCount = 0;
+	index->words = calloc(image->wordCount ? image->wordCount : 1, sizeof(phraseWord_t));
+	index->wordCount = 0;
+	
+	if (frames == NULL || index->frames == NULL || index->words == NULL) {
+		free(frames);
+		phraseIndexFree(index);
+		return -1;
+	}
+	
+	for (int i = 0; i < image->wordCount; i++) {
+		int frameCount = lpcParseFrames(chip, image->data, PHROM_SIZE, image->words[i].address * 8, NULL,
+			frames, NULL, LPC_MAX_WORD_FRAMES, NULL);
+		if (frameCount < 1) continue;
+		
+		// Drop the stop frame; the phrase gets a single one at its end
+		frameCount--;
+		
+		if (index->frameCount + frameCount > capacity) {
+			while (index->frameCount + frameCount > capacity) capacity *= 2;
+			lpcFrame_t *grown = realloc(index->frames, capacity * sizeof(lpcFrame_t));
+			if (grown == NULL) {
+				free(frames);
+				phraseIndexFree(index);
+				return -1;
+			}
+			index->frames = grown;
+		}
+		memcpy(index->frames + index->frameCount, frames, frameCount * sizeof(lpcFrame_t));
+		
+		phraseWord_t *word = &index->words[index->wordCount++];
+		word->word = &image->words[i];
+		word->firstFrame = index->frameCount;
+		word->frameCount = frameCount;
+		
+		// Measure the edges of the word
+		int first = 0, last = frameCount - 1;
+		while (first < frameCount && frames[first].type == LPC_FRAME_SILENT) first++;
+		while (last >= 0 && frames[last].type == LPC_FRAME_SILENT) last--;
+		
+		word->leadingSilence = (first > 255) ? 255 : first;
+		word->trailingSilence = (frameCount - 1 - last > 255) ? 255 : frameCount - 1 - last;
+		word->leadingEnergy = (first < frameCount) ? frames[first].energy : 0;
+		word->trailingEnergy = (last >= 0) ? frames[last].energy : 0;
+		
+		index->frameCount += frameCount;
+	}
+	
+	free(frames);
+	return 0;
+}
+
+void phraseIndexFree(phraseIndex_t *index)
+{
+	free(index->frames);
+	free(index->words);
+	index->frames = NULL;
+	index->words = NULL;
+	index->frameCount = 0;
+	index->wordCount = 0;
+}
+
+// Compare name against each spelling in a word list entry; spellings are
+// separated by commas and a bracketed part is an alternative spelling too
+// (so "2- (TWEN-)" matches "2-" or "TWEN-")
+static int matchesWord(const char *text, const char *name)
+{
+	size_t nameLength = strlen(name);
+	
+	while (*text) {
+		// Find the next spelling and trim its spaces
+		size_t length = strcspn(text, ",()");
+		const char *start = text;
+		const char *end = text + length;
+		while (start < end && *start == ' ') start++;
+		while (end > start && end[-1] == ' ') end--;
+		
+		if ((size_t)(end - start) == nameLength) {
+			size_t i;
+			for (i = 0; i < nameLength; i++)
+				if (toupper((unsigned char)start[i]) != toupper((unsigned char)name[i])) break;
+			if (i == nameLength) return 1;
+		}
+		
+		text += length;
+		if (*text) text++;
+	}
+	
+	return 0;
+}
+
+// Look a word up by number, address or text (text that is also a number,
+// such as "0", is tried as a word number first)
+const phraseWord_t *phraseFindWord(const phraseIndex_t *index, const char *name)
+{
+	char *end;
+	unsigned long value = strtoul(name, &end, 0);
+	int isNumber = (*name != '\0' && *end == '\0' && isdigit((unsigned char)*name));
+	int isAddress = isNumber && (strncmp(name, "0x", 2) == 0 || strncmp(name, "0X", 2) == 0);
+	int i;
+	
+	if (isNumber) {
+		for (i = 0; i < index->wordCount; i++) {
+			const phromWord_t *word = index->words[i].word;
+			if (isAddress ? (word->address == value) : (word->number == value)) return &index->words[i];
+		}
+	}
+	
+	for (i = 0; i < index->wordCount; i++) {
+		if (matchesWord(index->words[i].word->word, name)) return &index->words[i];
+	}
+	
+	return NULL;
+}
+
+// Assemble the frames of a phrase into output, ending with a stop frame
+int phraseAssemble(const phraseIndex_t *index, const phraseWord_t *const *words, int wordCount,
+	int flags, lpcFrame_t *output, int maxFrames)
+{
+	int frameCount = 0;
+	
+	for (int i = 0; i < wordCount; i++) {
+		const phraseWord_t *word = words[i];
+		uint32_t first = word->firstFrame;
+		uint32_t count = word->frameCount;
+		
+		if (flags & PHRASE_SMOOTH_JOINS) {
+			// Trim the silence on each side of a join (the outer edges of
+			// the phrase are left alone)
+			if (i > 0 && word->leadingSilence < count) {
+				first += word->leadingSilence;
+				count -= word->leadingSilence;
+			}
+			
+			if (i < wordCount - 1 && word->trailingSilence < count) {
+				int step = abs((int)word->trailingEnergy - (int)words[i + 1]->leadingEnergy);
+				uint32_t keep = (step > PHRASE_ENERGY_STEP && word->trailingSilence > 0) ? 1 : 0;
+				count -= word->trailingSilence - keep;
+			}
+		}
+		
+		if (frameCount + (int)count + 1 > maxFrames) return LPC_PARSE_TOOLONG;
+		memcpy(output + frameCount, index->frames + first, count * sizeof(lpcFrame_t));
+		frameCount += count;
+	}
+	
+	if (frameCount + 1 > maxFrames) return LPC_PARSE_TOOLONG;
+	memset(&output[frameCount], 0, sizeof(lpcFrame_t));
+	output[frameCount].type = LPC_FRAME_STOP;
+	output[frameCount].energy = LPC_ENERGY_STOP;
+	if (frameCount > 0) memcpy(output[frameCount].k, output[frameCount - 1].k, 10);
+	
+	return frameCount + 1;
+}
+
+// Render a phrase word by word through a PCM cache
+int phraseRenderWords(const phraseIndex_t *index, pcmCache_t *cache, const lpcSettings_t *settings,
+	const phraseWord_t *const *words, int wordCount, int16_t *output, int maxSamples)
+{
+	int sampleCount = 0;
+	
+	for (int i = 0; i < wordCount; i++) {
+		int count = pcmCacheRenderWord(cache, index->image, words[i]->word->address, settings,
+			output + sampleCount, maxSamples - sampleCount);
+		if (count < 0) return count;
+		sampleCount += count;
+	}
+	
+	return sampleCount;
+}
+
+// Samples phraseRenderWords() needs for a phrase (each word's frames and
+// its stop frame)
+int phraseWordSamples(const lpcSettings_t *settings, const phraseWord_t *const *words, int wordCount)
+{
+	int frameCount = 0;
+	for (int i = 0; i < wordCount; i++) frameCount += words[i]->frameCount + 1;
+	return frameCount * lpcFrameSamples(settings);
+}
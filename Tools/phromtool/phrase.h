@@ -0,0 +1,90 @@
+/************************************************************************
+	phrase.h
+
+    Phrase assembly from pre-indexed PHROM words
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef PHRASE_H_
+#define PHRASE_H_
+
+#include <stdint.h>
+
+#include "lpcframe.h"
+#include "lpcrender.h"
+#include "pcmcache.h"
+#include "phromimage.h"
+
+// Every listed word of an image is parsed once into a single frame store;
+// a phrase is then just the words' frame ranges copied end to end.  A
+// phrase without smoothed joins can instead be rendered a word at a time
+// through a PCM cache, so repeated words cost only a copy.
+
+// Per-word index entry
+typedef struct {
+	const phromWord_t *word;
+	uint32_t firstFrame;		// Index of the word's first frame in the store
+	uint16_t frameCount;		// Frames excluding the stop frame
+	uint8_t leadingEnergy;		// Energy index of the first spoken frame
+	uint8_t trailingEnergy;		// Energy index of the last spoken frame
+	uint8_t leadingSilence;		// Silent frames before the first spoken frame
+	uint8_t trailingSilence;	// Silent frames after the last spoken frame
+} phraseWord_t;
+
+typedef struct {
+	const phromImage_t *image;
+	int chip;					// LPC_CHIP_ frame format
+	lpcFrame_t *frames;			// Frame store (stop frames are not stored)
+	uint32_t frameCount;
+	phraseWord_t *words;		// In word list order
+	int wordCount;
+} phraseIndex_t;
+
+// Assembly flags
+#define PHRASE_SMOOTH_JOINS	0x01	// Trim the silence at each join so the
+									// synthesiser interpolates across it
+
+// Build and free the index of an image in a chip's frame format (the only
+// allocations made)
+int phraseIndexBuild(phraseIndex_t *index, const phromImage_t *image, int chip);
+void phraseIndexFree(phraseIndex_t *index);
+
+// Look a word up by number, by 0x prefixed address or by text (any of the
+// spellings in the word list, ignoring case); returns NULL if not found
+const phraseWord_t *phraseFindWord(const phraseIndex_t *index, const char *name);
+
+// Assemble the frames of a phrase into output, ending with a stop frame.
+// Returns the number of frames or LPC_PARSE_TOOLONG if maxFrames is too small.
+int phraseAssemble(const phraseIndex_t *index, const phraseWord_t *const *words, int wordCount,
+	int flags, lpcFrame_t *output, int maxFrames);
+
+// Render a phrase word by word through a PCM cache (each word is spoken
+// from its own start to its own stop frame, as a word at a time would be
+// spoken by the chip).  Returns the number of samples, LPC_PARSE_TOOLONG
+// if maxSamples is too small or another LPC_PARSE_ error.
+int phraseRenderWords(const phraseIndex_t *index, pcmCache_t *cache, const lpcSettings_t *settings,
+	const phraseWord_t *const *words, int wordCount, int16_t *output, int maxSamples);
+
+// Samples phraseRenderWords() needs for a phrase
+int phraseWordSamples(const lpcSettings_t *settings, const phraseWord_t *const *words, int wordCount);
+
+#endif /* PHRASE_H_ */
@@ -0,0 +1,255 @@
+/************************************************************************
+	phrombuild.c
+
+    Building PHROM images from encoded words
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "phrombuild.h"
+
+// Bytes taken by the address table of a bank whose highest number is n
+#define TABLE_BYTES(n)	(2 * ((uint32_t)(n) + 1))
+
+// Not yet placed in a bank, or being considered for the current one
+#define UNPLACED	-1
+#define CANDIDATE	-2
+
+static int compareKeys(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return x < y ? -1 : x > y;
+}
+
+// List the words in order of size (or of number if size is 0), breaking
+// ties by number; returns a malloc()ed array of indexes or NULL
+static int *sortWords(const phromBuildWord_t *words, int wordCount, int size)
+{
+	uint64_t *keys = malloc((wordCount + 1) * sizeof(uint64_t));
+	int *order = malloc((wordCount + 1) * sizeof(int));
+	if (keys == NULL || order == NULL) {
+		free(keys);
+		free(order);
+		return NULL;
+	}
+	
+	for (int i = 0; i < wordCount; i++)
+		keys[i] = (size ? (uint64_t)words[i].bytes << 48 : 0) | (uint64_t)words[i].number << 32 | (uint32_t)i;
+	qsort(keys, wordCount, sizeof(uint64_t), compareKeys);
+	for (int i = 0; i < wordCount; i++) order[i] = (int)(uint32_t)keys[i];
+	
+	free(keys);
+	return order;
+}
+
+// Take the highest word and the smallest unplaced words numbered below it
+// while they fit (bySize lists every word in order of size), marking them
+// as candidates if asked; returns the count and the bytes used, table
+// included
+static int takeSmallest(phromBuildWord_t *words, int wordCount, const int *bySize, int highest, int mark, uint32_t *used)
+{
+	uint16_t number = words[highest].number;
+	uint32_t total = TABLE_BYTES(number) + words[highest].bytes;
+	int count = 1;
+	
+	if (mark) words[highest].bank = CANDIDATE;
+	for (int i = 0; i < wordCount; i++) {
+		phromBuildWord_t *word = &words[bySize[i]];
+		if (word->bank != UNPLACED || word->number >= number) continue;
+		if (total + word->bytes > PHROM_SIZE) break;
+		total += word->bytes;
+		count++;
+		if (mark) word->bank = CANDIDATE;
+	}
+	
+	*used = total;
+	return count;
+}
+
+// Fill the next bank with as many of the unplaced words as fit
+static int fillBank(phromBuildWord_t *words, int wordCount, const int *bySize, const int *byNumber, int bank)
+{
+	int best = -1, bestCount = 0;
+	uint32_t bestUsed = 0;
+	
+	for (int i = 0; i < wordCount; i++) {
+		const phromBuildWord_t *word = &words[i];
+		if (word->bank != UNPLACED || TABLE_BYTES(word->number) + word->bytes > PHROM_SIZE) continue;
+		
+		uint32_t used;
+		int count = takeSmallest(words, wordCount, bySize, i, 0, &used);
+		if (count > bestCount || (count == bestCount && used > bestUsed)) {
+			best = i;
+			bestCount = count;
+			bestUsed = used;
+		}
+	}
+	if (best < 0) return 0;
+	
+	uint16_t highest = words[best].number;
+	uint32_t total;
+	takeSmallest(words, wordCount, bySize, best, 1, &total);
+	
+	// Swap chosen words (smallest first) for the largest unchosen ones that
+	// still fit, leaving the smaller words for later banks
+	for (int i = 0; i < wordCount; i++) {
+		phromBuildWord_t *chosen = &words[bySize[i]];
+		if (chosen->bank != CANDIDATE || chosen == &words[best]) continue;
+		
+		for (int j = wordCount - 1; j > i; j--) {
+			phromBuildWord_t *other = &words[bySize[j]];
+			if (other->bank != UNPLACED || other->number >= highest || other->bytes <= chosen->bytes) continue;
+			if (total - chosen->bytes + other->bytes > PHROM_SIZE) continue;
+			total += other->bytes - chosen->bytes;
+			chosen->bank = UNPLACED;
+			other->bank = CANDIDATE;
+			break;
+		}
+	}
+	
+	// Lay the bank out in word number order after the table
+	uint32_t address = TABLE_BYTES(highest);
+	for (int i = 0; i < wordCount; i++) {
+		phromBuildWord_t *word = &words[byNumber[i]];
+		if (word->bank != CANDIDATE) continue;
+		word->bank = bank;
+		word->address = (uint16_t)address;
+		address += word->bytes;
+	}
+	
+	return bestCount;
+}
+
+// Pack words into banks
+int phromBuildPack(phromBuildWord_t *words, int wordCount, int bankCount)
+{
+	int *bySize = sortWords(words, wordCount, 1);
+	int *byNumber = sortWords(words, wordCount, 0);
+	int bank = -1;
+	if (bySize == NULL || byNumber == NULL) goto done;
+	
+	// Every word needs a table entry of its own
+	for (int i = 0; i < wordCount; i++) {
+		if (words[byNumber[i]].number == 0) goto done;
+		if (i > 0 && words[byNumber[i]].number == words[byNumber[i - 1]].number) goto done;
+		words[i].bank = UNPLACED;
+		words[i].address = 0;
+	}
+	
+	bank = 0;
+	while (bank < bankCount && fillBank(words, wordCount, bySize, byNumber, bank) > 0) bank++;
+	
+done:
+	free(bySize);
+	free(byNumber);
+	return bank;
+}
+
+// Fill one bank's image
+uint32_t phromBuildImage(const phromBuildWord_t *words, int wordCount, int bank, uint8_t *image)
+{
+	uint32_t used = 0;
+	uint16_t highest = 0;
+	
+	memset(image, 0, PHROM_SIZE);
+	for (int i = 0; i < wordCount; i++) {
+		const phromBuildWord_t *word = &words[i];
+		if (word->bank != bank) continue;
+		
+		image[2 * word->number] = (uint8_t)word->address;
+		image[2 * word->number + 1] = (uint8_t)(word->address >> 8);
+		memcpy(image + word->address, word->data, word->bytes);
+		if (word->number > highest) highest = word->number;
+		if (word->address + word->bytes > used) used = word->address + word->bytes;
+	}
+	image[1] = highest > 0xFF ? 0xFF : (uint8_t)highest;
+	
+	return used;
+}
+
+// Write an image as a .bin file
+int phromBuildWriteBin(const char *path, const uint8_t *image)
+{
+	FILE *file = fopen(path, "wb");
+	if (file == NULL) return -1;
+	
+	int result = fwrite(image, 1, PHROM_SIZE, file) == PHROM_SIZE ? 0 : -1;
+	if (fclose(file) != 0) result = -1;
+	return result;
+}
+
+// Write an image as a romdata header
+int phromBuildWriteHeader(const char *path, const uint8_t *image, int phromBank,
+	const phromBuildWord_t *words, int wordCount, int bank, const char *source)
+{
+	const char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+	char guard[256];
+	int length = 0;
+	
+	// The include guard is the file name in capitals (ROMDATA_X_H_)
+	for (; name[length] && length < (int)sizeof(guard) - 2; length++)
+		guard[length] = isalnum((unsigned char)name[length]) ? (char)toupper((unsigned char)name[length]) : '_';
+	guard[length++] = '_';
+	guard[length] = '\0';
+	
+	int *byNumber = sortWords(words, wordCount, 0);
+	FILE *file = byNumber ? fopen(path, "w") : NULL;
+	if (file == NULL) {
+		free(byNumber);
+		return -1;
+	}
+	
+	fprintf(file, "/************************************************************************\n");
+	fprintf(file, "\t%s\n\n", name);
+	fprintf(file, "    PHROM image built by phromtool from %s\n\n", source);
+	fprintf(file, "************************************************************************/\n\n");
+	fprintf(file, "#ifndef %s\n#define %s\n\n", guard, guard);
+	fprintf(file, "// Define the PHROM number 0x0-0xF (defines the 16K address space that the PHROM\n");
+	fprintf(file, "// should respond to\n");
+	fprintf(file, "#define PHROM_BANK 0x%X\n\n", phromBank);
+	fprintf(file, "// Note: This image was built by phromtool and contains 16K bytes of data\n");
+	fprintf(file, "// (16,384 bytes or 0x4000 in hex).\n\n");
+	
+	fprintf(file, "/*\n\tPHROM Word list:\n\t\n");
+	fprintf(file, "\tWord or   Absolute\n\tword-part address\n\tnumber    (hex)    Word\n\n");
+	
+	// Columns as in romdata_acorn.h (unpadded hex addresses)
+	for (int i = 0; i < wordCount; i++) {
+		const phromBuildWord_t *word = &words[byNumber[i]];
+		if (word->bank == bank) fprintf(file, "\t%-11u%-8X%s\n", word->number, word->address, word->word);
+	}
+	fprintf(file, "*/\n\n");
+	
+	fprintf(file, "const unsigned char phromData[%d] PROGMEM = {\n", PHROM_SIZE);
+	for (int i = 0; i < PHROM_SIZE; i++) {
+		fprintf(file, "%s0x%02X%s", i % 12 ? " " : "\t", image[i],
+			i == PHROM_SIZE - 1 ? "\n" : i % 12 == 11 ? ",\n" : ",");
+	}
+	fprintf(file, "};\n\n#endif /* %s */\n", guard);
+	
+	free(byNumber);
+	return fclose(file) == 0 ? 0 : -1;
+}
@@ -0,0 +1,74 @@
+/************************************************************************
+	phrombuild.h
+
+    Building PHROM images from encoded words
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef PHROMBUILD_H_
+#define PHROMBUILD_H_
+
+#include <stdint.h>
+
+#include "phromimage.h"
+
+// A built image is laid out as the shipped ones are: an address table
+// first, holding the little-endian address of word n at bytes 2n and
+// 2n + 1 (byte 0 is zero and byte 1 the highest word number, or 0xFF
+// above 255), then each word's frames from a byte boundary in word
+// number order.  The table grows with the highest number in the bank, so
+// word numbers start at 1 and are best kept dense.
+//
+// When the words do not all fit, each bank takes as many of those still
+// to be placed as it can: for every candidate highest number the smallest
+// words below it are taken (which maximises the count for that table
+// size), the best candidate wins, and then its words are swapped for
+// larger ones while they still fit so the bank is as full as possible
+// and the smaller words are left for the next.
+
+// A word to place
+typedef struct {
+	uint16_t number;		// Word number (1 or more; its table entry)
+	const char *word;		// Word text
+	const uint8_t *data;	// Packed frames from bit 0, ending with the stop frame
+	uint32_t bytes;
+	int bank;				// Set to the bank (0 up) placed in, or -1
+	uint16_t address;		// Set to the word's address in its bank
+} phromBuildWord_t;
+
+// Pack words into up to bankCount banks.  Returns the number of banks
+// used, or -1 if a word number is 0 or repeated.
+int phromBuildPack(phromBuildWord_t *words, int wordCount, int bankCount);
+
+// Fill a PHROM_SIZE image with one bank's table and words; returns the
+// bytes used.
+uint32_t phromBuildImage(const phromBuildWord_t *words, int wordCount, int bank, uint8_t *image);
+
+// Write an image as a 16K .bin, or as a header in the romdata format
+// (PHROM_BANK, the word list comment and phromData) for the firmware.
+// The header's include guard follows its file name and the source names
+// where the words came from.  Both return 0 or -1.
+int phromBuildWriteBin(const char *path, const uint8_t *image);
+int phromBuildWriteHeader(const char *path, const uint8_t *image, int phromBank,
+	const phromBuildWord_t *words, int wordCount, int bank, const char *source);
+
+#endif /* PHROMBUILD_H_ */
@@ -0,0 +1,235 @@
+/************************************************************************
+	phromimage.c
+
+    Host-side access to TMS6100 PHROM images and word lists
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+// Global includes
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "phromimage.h"
+
+// The romdata headers are written for the AVR; on the host PROGMEM is
+// meaningless and each image needs its own symbol name
+#define PROGMEM
+
+#define phromData phromDataAcorn
+#include "../../Firmware/tms6100/romdata_acorn.h"
+#undef phromData
+enum { phromBankAcorn = PHROM_BANK };
+#undef PHROM_BANK
+
+#define phromData phromDataUs
+#include "../../Firmware/tms6100/romdata_us.h"
+#undef phromData
+enum { phromBankUs = PHROM_BANK };
+#undef PHROM_BANK
+
+// Word lists generated from the comments in the romdata headers
+#include "phromwords.h"
+
+const phromImage_t phromImageAcorn = {
+	"acorn", phromDataAcorn, phromBankAcorn, phromWordsAcorn,
+	sizeof(phromWordsAcorn) / sizeof(phromWordsAcorn[0]), 0
+};
+
+const phromImage_t phromImageUs = {
+	"us", phromDataUs, phromBankUs, phromWordsUs,
+	sizeof(phromWordsUs) / sizeof(phromWordsUs[0]), 0
+};
+
+// Open an image by name ("acorn" or "us") or from a 16K .bin file
+// Returns 0 on success or -1 on failure
+int phromOpenImage(const char *spec, phromImage_t *image)
+{
+	if (strcmp(spec, "acorn") == 0) {
+		*image = phromImageAcorn;
+		image->hash = phromHashImage(image->data);
+		return 0;
+	}
+	
+	if (strcmp(spec, "us") == 0) {
+		*image = phromImageUs;
+		image->hash = phromHashImage(image->data);
+		return 0;
+	}
+	
+	// Map a raw dump read-only (so long-running processes share the
+	// pages); the bank is unknown so assume 0
+	struct stat status;
+	int descriptor = open(spec, O_RDONLY);
+	if (descriptor < 0) return -1;
+	if (fstat(descriptor, &status) != 0 || status.st_size != PHROM_SIZE) {
+		close(descriptor);
+		return -1;
+	}
+	
+	void *data = mmap(NULL, PHROM_SIZE, PROT_READ, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+	if (data == MAP_FAILED) return -1;
+	
+	image->name = spec;
+	image->data = data;
+	image->bank = 0x0;
+	image->words = NULL;
+	image->wordCount = 0;
+	image->hash = phromHashImage(data);
+	return 0;
+}
+
+// 64-bit FNV-1a hash of an image's data
+uint64_t phromHashImage(const uint8_t *data)
+{
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	
+	for (int i = 0; i < PHROM_SIZE; i++) {
+		hash ^= data[i];
+		hash *= 0x100000001B3ULL;
+	}
+	
+	return hash;
+}
+
+// 64-bit FNV-1a hash of an image's word list
+uint64_t phromHashWordList(const phromImage_t *image)
+{
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	
+	for (int i = 0; i < image->wordCount; i++) {
+		const phromWord_t *word = &image->words[i];
+		uint8_t fields[4] = { (uint8_t)word->number, (uint8_t)(word->number >> 8),
+			(uint8_t)word->address, (uint8_t)(word->address >> 8) };
+		
+		// The text's terminator separates one word from the next
+		for (size_t j = 0; j < sizeof(fields) + strlen(word->word) + 1; j++) {
+			hash ^= j < sizeof(fields) ? fields[j] : (uint8_t)word->word[j - sizeof(fields)];
+			hash *= 0x100000001B3ULL;
+		}
+	}
+	
+	return hash;
+}
+
+// Free a word list loaded by phromLoadWordList()
+static void freeWordList(phromImage_t *image)
+{
+	if (image->words != phromWordsAcorn && image->words != phromWordsUs && image->words != NULL) {
+		for (int i = 0; i < image->wordCount; i++) free((void *)image->words[i].word);
+		free((void *)image->words);
+	}
+	image->words = NULL;
+	image->wordCount = 0;
+}
+
+// Release an image opened by phromOpenImage()
+void phromCloseImage(phromImage_t *image)
+{
+	if (image->data != phromDataAcorn && image->data != phromDataUs && image->data != NULL)
+		munmap((void *)image->data, PHROM_SIZE);
+	image->data = NULL;
+	
+	freeWordList(image);
+}
+
+// Load a word list in the format of the romdata header comments
+// Returns the number of words loaded or -1 on failure
+int phromLoadWordList(phromImage_t *image, const char *path)
+{
+	FILE *file = fopen(path, "r");
+	if (file == NULL) return -1;
+	
+	phromWord_t *words = NULL;
+	int wordCount = 0, capacity = 0;
+	char line[256];
+	
+	while (fgets(line, sizeof(line), file)) {
+		unsigned number, address;
+		int textStart;
+		
+		if (sscanf(line, " %u %x %n", &number, &address, &textStart) != 2) continue;
+		if (address >= PHROM_SIZE || line[textStart] == '\0') continue;
+		
+		// Trim the trailing white space from the word text
+		char *text = line + textStart;
+		size_t length = strlen(text);
+		while (length > 0 && (text[length - 1] == '\n' || text[length - 1] == '\r' ||
+			text[length - 1] == ' ' || text[length - 1] == '\t')) length--;
+		if (length == 0) continue;
+		
+		if (wordCount == capacity) {
+			int larger = capacity ? capacity * 2 : 256;
+			phromWord_t *grown = realloc(words, larger * sizeof(phromWord_t));
+			if (grown == NULL) goto failed;
+			words = grown;
+			capacity = larger;
+		}
+		
+		char *word = malloc(length + 1);
+		if (word == NULL) goto failed;
+		memcpy(word, text, length);
+		word[length] = '\0';
+		
+		words[wordCount].number = number;
+		words[wordCount].address = address;
+		words[wordCount].word = word;
+		wordCount++;
+	}
+	fclose(file);
+	
+	// Replace any existing list
+	freeWordList(image);
+	image->words = words;
+	image->wordCount = wordCount;
+	return wordCount;
+	
+failed:
+	// Out of memory: free the partial list and keep the existing one
+	fclose(file);
+	for (int i = 0; i < wordCount; i++) free((void *)words[i].word);
+	free(words);
+	return -1;
+}
+
+// Find a listed word by its number
+const phromWord_t *phromFindWordNumber(const phromImage_t *image, uint32_t number)
+{
+	for (int i = 0; i < image->wordCount; i++) {
+		if (image->words[i].number == number) return &image->words[i];
+	}
+	return NULL;
+}
+
+// Find a listed word by its address
+const phromWord_t *phromFindWordAddress(const phromImage_t *image, uint32_t address)
+{
+	for (int i = 0; i < image->wordCount; i++) {
+		if (image->words[i].address == address) return &image->words[i];
+	}
+	return NULL;
+}
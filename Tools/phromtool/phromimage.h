@@ -0,0 +1,73 @@
+/************************************************************************
+	phromimage.h
+
+    Host-side access to TMS6100 PHROM images and word lists
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef PHROMIMAGE_H_
+#define PHROMIMAGE_H_
+
+#include <stdint.h>
+
+// Size of a single PHROM bank (16K bytes or 0x4000 in hex)
+#define PHROM_SIZE	16384
+
+// One entry of a PHROM word list (as documented in the romdata headers)
+typedef struct {
+	uint16_t number;		// Word or word-part number
+	uint16_t address;		// Local address of the first LPC frame
+	const char *word;		// Word text
+} phromWord_t;
+
+// A PHROM image and its word list
+typedef struct {
+	const char *name;
+	const uint8_t *data;	// PHROM_SIZE bytes of image data
+	uint8_t bank;			// PHROM_BANK the image responds to
+	const phromWord_t *words;
+	int wordCount;
+	uint64_t hash;			// Hash of the image data (set by phromOpenImage)
+} phromImage_t;
+
+// The images shipped with the firmware
+extern const phromImage_t phromImageAcorn;
+extern const phromImage_t phromImageUs;
+
+// Open an image by name ("acorn" or "us") or from a 16K .bin file
+int phromOpenImage(const char *spec, phromImage_t *image);
+void phromCloseImage(phromImage_t *image);
+
+// 64-bit FNV-1a hash of an image's data, or of its word list (numbers,
+// addresses and text, in list order)
+uint64_t phromHashImage(const uint8_t *data);
+uint64_t phromHashWordList(const phromImage_t *image);
+
+// Load a word list in the format of the romdata header comments
+// ("number address word" per line, address in hex; other lines ignored)
+int phromLoadWordList(phromImage_t *image, const char *path);
+
+// Find a listed word by its number or by its address (NULL if not listed)
+const phromWord_t *phromFindWordNumber(const phromImage_t *image, uint32_t number);
+const phromWord_t *phromFindWordAddress(const phromImage_t *image, uint32_t address);
+
+#endif /* PHROMIMAGE_H_ */
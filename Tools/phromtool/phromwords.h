@@ -0,0 +1,410 @@
+/************************************************************************
+	phromwords.h
+
+    Word lists of the built-in PHROM images
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+// Generated by mkwordlists.sh from the comments in the romdata headers;
+// do not edit (change the header and run the script again)
+
+#ifndef PHROMWORDS_H_
+#define PHROMWORDS_H_
+
+static const phromWord_t phromWordsAcorn[] = {
+	{ 127, 0x0250, "-0.125" },
+	{ 128, 0x025F, "-0.25" },
+	{ 129, 0x0272, "(TONE 1)" },
+	{ 130, 0x02B0, "(TONE2)" },
+	{ 131, 0x02E9, "-D" },
+	{ 132, 0x0300, "-ED" },
+	{ 133, 0x032B, "-ING" },
+	{ 134, 0x0361, "-S" },
+	{ 135, 0x0384, "-TEE" },
+	{ 136, 0x03DC, "-TH" },
+	{ 137, 0x03F3, "-T" },
+	{ 138, 0x0415, "-" },
+	{ 139, 0x0437, "ZERO (0)" },
+	{ 140, 0x04C8, "HUNDRED (00)" },
+	{ 141, 0x0530, "THOUSAND (000)" },
+	{ 142, 0x05CA, "ONE,WON" },
+	{ 143, 0x0633, "TWO,TO,TOO" },
+	{ 144, 0x0692, "2- (TWEN-)" },
+	{ 145, 0x06D2, "THREE" },
+	{ 146, 0x073F, "3- (THIR-)" },
+	{ 147, 0x0788, "FOUR,FOR,FORE" },
+	{ 148, 0x07F7, "4- (FOR-)" },
+	{ 149, 0x0840, "FIVE" },
+	{ 150, 0x08B6, "5- (FIF-)" },
+	{ 151, 0x08E9, "SIX" },
+	{ 152, 0x0936, "6- (SIX-)" },
+	{ 153, 0x096E, "SEVEN" },
+	{ 154, 0x09CB, "7- (SEVEN-)" },
+	{ 155, 0x0A12, "EIGHT,ATE" },
+	{ 156, 0x0A46, "8- (EIGHT-)" },
+	{ 157, 0x0A71, "NINE" },
+	{ 158, 0x0AFD, "9- (NIN-)" },
+	{ 159, 0x0B5D, "A" },
+	{ 160, 0x0BB6, "ACORN" },
+	{ 161, 0x0C4B, "AFTER" },
+	{ 162, 0x0CB3, "AGAIN" },
+	{ 163, 0x0D46, "AMOUNT" },
+	{ 164, 0x0DBD, "AN" },
+	{ 165, 0x0E12, "AND" },
+	{ 166, 0x0E8E, "ANOTHER" },
+	{ 167, 0x0EFD, "ANSWER" },
+	{ 168, 0x0F72, "ANY" },
+	{ 169, 0x0FCF, "AVAILABLE" },
+	{ 170, 0x1065, "B,BEE,BE" },
+	{ 171, 0x10BD, "BAD" },
+	{ 172, 0x113B, "BETWEEN" },
+	{ 173, 0x11B1, "BOTH" },
+	{ 174, 0x11F8, "BUTTON" },
+	{ 175, 0x124D, "C,SEE,SEA" },
+	{ 176, 0x12B1, "CASSETTE" },
+	{ 177, 0x1326, "CHARACTER" },
+	{ 178, 0x139F, "COMPLETE" },
+	{ 179, 0x140B, "COMPUTER" },
+	{ 180, 0x1483, "CORRECT" },
+	{ 181, 0x14F0, "D" },
+	{ 182, 0x153B, "DATA" },
+	{ 183, 0x159F, "DATE" },
+	{ 184, 0x15E6, "DO" },
+	{ 185, 0x162A, "DOLLAR" },
+	{ 186, 0x167E, "DONT" },
+	{ 187, 0x16D7, "DOWN" },
+	{ 188, 0x175A, "E" },
+	{ 189, 0x178B, "EACH" },
+	{ 190, 0x17D6, "ELEVEN" },
+	{ 191, 0x1852, "ENGAGED" },
+	{ 192, 0x18FA, "ENTER" },
+	{ 193, 0x195C, "ERROR" },
+	{ 194, 0x19AA, "ESCAPE" },
+	{ 195, 0x1A1C, "F" },
+	{ 196, 0x1A5D, "FEW" },
+	{ 197, 0x1AAB, "FILE" },
+	{ 198, 0x1B1E, "FIRST" },
+	{ 199, 0x1B96, "FOUND" },
+	{ 200, 0x1C11, "FROM" },
+	{ 201, 0x1C6B, "G" },
+	{ 202, 0x1CC9, "GOOD" },
+	{ 203, 0x1D09, "H" },
+	{ 204, 0x1D60, "HAVE" },
+	{ 205, 0x1DCC, "I,EYE" },
+	{ 206, 0x1E3E, "ILLEGAL" },
+	{ 207, 0x1EBD, "IN-" },
+	{ 208, 0x1EFC, "INPUT" },
+	{ 209, 0x1F57, "IS" },
+	{ 210, 0x1FA6, "J,JAY" },
+	{ 211, 0x2008, "K" },
+	{ 212, 0x2061, "KEY" },
+	{ 213, 0x209F, "L" },
+	{ 214, 0x20FC, "LARGE" },
+	{ 215, 0x2195, "LAST" },
+	{ 216, 0x21F5, "LINE" },
+	{ 217, 0x226F, "M" },
+	{ 218, 0x22CD, "MANY" },
+	{ 219, 0x2321, "MINUS" },
+	{ 220, 0x239D, "MORE" },
+	{ 221, 0x2409, "MUST" },
+	{ 222, 0x246F, "N" },
+	{ 223, 0x24C9, "NAME" },
+	{ 224, 0x2544, "NEGATIVE" },
+	{ 225, 0x25DE, "NEW" },
+	{ 226, 0x263D, "NO,KNOW" },
+	{ 227, 0x269D, "NOT,KNOT" },
+	{ 228, 0x26F7, "NOW" },
+	{ 229, 0x276A, "NUMBER" },
+	{ 230, 0x27E5, "0" },
+	{ 231, 0x282D, "O'CLOCK" },
+	{ 232, 0x2892, "OF" },
+	{ 233, 0x28D9, "OFF" },
+	{ 234, 0x2923, "OLD" },
+	{ 235, 0x2980, "ON" },
+	{ 236, 0x29DE, "ONLY" },
+	{ 237, 0x2A48, "OR" },
+	{ 238, 0x2A90, "P,PEA" },
+	{ 239, 0x2AC7, "PARAMETER" },
+	{ 240, 0x2B58, "PENCE" },
+	{ 241, 0x2BBA, "PLEASE" },
+	{ 242, 0x2C45, "PLUS" },
+	{ 243, 0x2C8B, "POINT" },
+	{ 244, 0x2CE6, "POSITIVE" },
+	{ 245, 0x2D64, "POUN-" },
+	{ 246, 0x2DCD, "PRESS" },
+	{ 247, 0x2E3F, "PROGRAM" },
+	{ 248, 0x2EC8, "Q,QUEUE" },
+	{ 249, 0x2F1E, "R,ARE" },
+	{ 250, 0x2F59, "RED" },
+	{ 251, 0x2FD1, "RESET" },
+	{ 252, 0x3051, "RETURN" },
+	{ 253, 0x30E7, "RUN" },
+	{ 254, 0x3153, "RUNNING" },
+	{ 255, 0x31E1, "S" },
+	{ 256, 0x3231, "SAME" },
+	{ 257, 0x329A, "SCORE" },
+	{ 258, 0x3320, "SECOND" },
+	{ 259, 0x339A, "SMALL" },
+	{ 260, 0x341F, "START" },
+	{ 261, 0x349F, "STOP" },
+	{ 262, 0x34FB, "SWITCH" },
+	{ 263, 0x3573, "T,TEA,TEE" },
+	{ 264, 0x35CA, "TEN" },
+	{ 265, 0x362B, "THANK" },
+	{ 266, 0x3684, "THAT" },
+	{ 267, 0x36DF, "THE" },
+	{ 268, 0x3724, "THEN" },
+	{ 269, 0x377E, "THIRD" },
+	{ 270, 0x3808, "THIS" },
+	{ 271, 0x3874, "TIME" },
+	{ 272, 0x38E2, "TRY" },
+	{ 273, 0x3953, "TWELVE" },
+	{ 274, 0x39D2, "TYPE" },
+	{ 275, 0x3A21, "U,YOU" },
+	{ 276, 0x3A91, "UH" },
+	{ 277, 0x3AC0, "UP" },
+	{ 278, 0x3AF7, "V" },
+	{ 279, 0x3B5C, "VERY" },
+	{ 280, 0x3BB8, "W" },
+	{ 281, 0x3C1D, "WANT" },
+	{ 282, 0x3C6C, "WAS" },
+	{ 283, 0x3CC2, "WERE" },
+	{ 284, 0x3D1A, "WHAT" },
+	{ 285, 0x3D6E, "WHICH" },
+	{ 286, 0x3DB5, "X" },
+	{ 287, 0x3E11, "Y,WHY" },
+	{ 288, 0x3E86, "YEAR" },
+	{ 289, 0x3EFC, "YES" },
+	{ 290, 0x3F3D, "YOUR" },
+	{ 291, 0x3F9B, "Z" },
+};
+
+static const phromWord_t phromWordsUs[] = {
+	{ 1, 0x019E, "ZERO" },
+	{ 2, 0x01EB, "FOUR" },
+	{ 3, 0x0237, "EIGHT" },
+	{ 4, 0x026A, "TWELVE" },
+	{ 5, 0x02B3, "TWENTY" },
+	{ 6, 0x02FF, "ONE" },
+	{ 7, 0x0342, "FIVE" },
+	{ 8, 0x0395, "NINE" },
+	{ 9, 0x03ED, "THIR-" },
+	{ 10, 0x0425, "HUNDRED" },
+	{ 11, 0x047C, "TWO" },
+	{ 12, 0x04B3, "SIX" },
+	{ 13, 0x04E5, "TEN" },
+	{ 14, 0x051B, "FIF-" },
+	{ 15, 0x0541, "THOUSAND" },
+	{ 16, 0x05BA, "THREE" },
+	{ 17, 0x0606, "SEVEN" },
+	{ 18, 0x0650, "ELEVEN" },
+	{ 19, 0x06B8, "TEEN-" },
+	{ 20, 0x06EE, "B" },
+	{ 21, 0x0720, "F" },
+	{ 22, 0x075A, "J" },
+	{ 23, 0x079D, "N" },
+	{ 24, 0x07DD, "R" },
+	{ 25, 0x0809, "V" },
+	{ 26, 0x085D, "ZEE" },
+	{ 27, 0x0899, "C" },
+	{ 28, 0x08DB, "G" },
+	{ 29, 0x0919, "K" },
+	{ 30, 0x095A, "O" },
+	{ 31, 0x0988, "S" },
+	{ 32, 0x09B8, "W" },
+	{ 33, 0x0A1E, "D" },
+	{ 34, 0x0A52, "H" },
+	{ 35, 0x0A8D, "L" },
+	{ 36, 0x0ACC, "P" },
+	{ 37, 0x0B02, "T" },
+	{ 38, 0x0B3C, "X" },
+	{ 39, 0x0B75, "A" },
+	{ 40, 0x0BA3, "E" },
+	{ 41, 0x0BD9, "I" },
+	{ 42, 0x0C1B, "M" },
+	{ 43, 0x0C5A, "Q" },
+	{ 44, 0x0C8E, "U" },
+	{ 45, 0x0CCC, "Y" },
+	{ 46, 0x0D0E, "ALPHA" },
+	{ 47, 0x0D4F, "ECHO" },
+	{ 48, 0x0D91, "DELTA" },
+	{ 49, 0x0DE4, "BRAVO" },
+	{ 50, 0x0E41, "FOXTROT" },
+	{ 51, 0x0EB0, "CHARLIE" },
+	{ 52, 0x0F01, "GOLF" },
+	{ 53, 0x0F39, "HENRY" },
+	{ 54, 0x0F89, "LIMA" },
+	{ 55, 0x0FD2, "PAPA" },
+	{ 56, 0x1014, "TANGO" },
+	{ 57, 0x106C, "XRAY" },
+	{ 58, 0x10D0, "THE" },
+	{ 59, 0x10F7, "WATTS" },
+	{ 60, 0x1146, "METER" },
+	{ 61, 0x1191, "DANGER" },
+	{ 62, 0x11E4, "PRESSURE" },
+	{ 63, 0x1228, "CHANGE" },
+	{ 64, 0x1291, "MINUS" },
+	{ 65, 0x12E1, "NOT" },
+	{ 66, 0x1326, "START" },
+	{ 67, 0x1371, "LINE" },
+	{ 68, 0x13C5, "OFF" },
+	{ 69, 0x13F1, "TIME" },
+	{ 70, 0x142E, "AUTOMATIC" },
+	{ 71, 0x14AC, "WEIGHT" },
+	{ 72, 0x14FB, "SMOKE" },
+	{ 73, 0x153C, "ABORT" },
+	{ 74, 0x15A6, "CALL" },
+	{ 75, 0x15E2, "CYCLE" },
+	{ 76, 0x1630, "DISPLAY" },
+	{ 77, 0x168B, "EQUAL" },
+	{ 78, 0x16DD, "FAST" },
+	{ 79, 0x172B, "ABOUT" },
+	{ 80, 0x1788, "GO" },
+	{ 81, 0x17AE, "INCH" },
+	{ 82, 0x17F4, "LOW" },
+	{ 83, 0x1824, "MOTOR" },
+	{ 84, 0x1869, "OPEN" },
+	{ 85, 0x18B2, "PERCENT" },
+	{ 86, 0x1904, "PROBE" },
+	{ 87, 0x194E, "READY" },
+	{ 88, 0x198E, "SET" },
+	{ 89, 0x19CC, "SPEED" },
+	{ 90, 0x1A16, "UNDER" },
+	{ 91, 0x1A6A, "OPERATOR" },
+	{ 92, 0x1AE7, "INDIA" },
+	{ 93, 0x1B3B, "MIKE" },
+	{ 94, 0x1B7D, "QUEBEC" },
+	{ 95, 0x1BC4, "UNIFORM" },
+	{ 96, 0x1C42, "YANKEE" },
+	{ 97, 0x1CA5, "AMPS" },
+	{ 98, 0x1CE0, "MEGA" },
+	{ 99, 0x1D2A, "PICO" },
+	{ 100, 0x1D80, "FIRE" },
+	{ 101, 0x1DD3, "POWER" },
+	{ 102, 0x1E21, "COMPLETE" },
+	{ 103, 0x1E8B, "REPAIR" },
+	{ 104, 0x1EEC, "TEMPERATURE" },
+	{ 105, 0x1F41, "STOP" },
+	{ 106, 0x1F70, "MACHINE" },
+	{ 107, 0x1FCE, "ON" },
+	{ 108, 0x200A, "CONTROL" },
+	{ 109, 0x2071, "ELECTRICIAN" },
+	{ 110, 0x20E2, "AT" },
+	{ 111, 0x2111, "RED" },
+	{ 112, 0x2160, "ALL" },
+	{ 113, 0x2197, "CANCEL" },
+	{ 114, 0x21DD, "PHASE" },
+	{ 115, 0x221F, "NOR" },
+	{ 116, 0x226C, "EXIT" },
+	{ 117, 0x22BA, "FLOW" },
+	{ 118, 0x22FB, "GAUGE" },
+	{ 119, 0x234A, "GREEN" },
+	{ 120, 0x23B9, "INSPECTOR" },
+	{ 121, 0x242A, "MANUAL" },
+	{ 122, 0x24A1, "MOVE" },
+	{ 123, 0x24FC, "OVER" },
+	{ 124, 0x2547, "PLUS" },
+	{ 125, 0x2583, "PULL" },
+	{ 126, 0x25BD, "REPEAT" },
+	{ 127, 0x2621, "SHUT" },
+	{ 128, 0x2658, "TEST" },
+	{ 129, 0x2696, "VOLTS" },
+	{ 130, 0x26D3, "GALLONS" },
+	{ 131, 0x2737, "JULIET" },
+	{ 132, 0x279D, "NOVEMBER" },
+	{ 133, 0x2814, "ROMEO" },
+	{ 134, 0x2874, "VICTOR" },
+	{ 135, 0x28CB, "ZULU" },
+	{ 136, 0x2914, "HERTZ" },
+	{ 137, 0x2948, "MICRO" },
+	{ 138, 0x299C, "OHMS" },
+	{ 139, 0x29F0, "AREA" },
+	{ 140, 0x2A43, "CIRCUIT" },
+	{ 141, 0x2A9E, "CONNECT" },
+	{ 142, 0x2AEB, "SECONDS" },
+	{ 143, 0x2B55, "UNIT" },
+	{ 144, 0x2BB2, "TIMER" },
+	{ 145, 0x2BFD, "UP" },
+	{ 146, 0x2C28, "IS" },
+	{ 147, 0x2C5F, "ALERT" },
+	{ 148, 0x2CBA, "ADJUST" },
+	{ 149, 0x2D1B, "BETWEEN" },
+	{ 150, 0x2D77, "MINUTES" },
+	{ 151, 0x2DBD, "BUTTON" },
+	{ 152, 0x2E0B, "CLOCK" },
+	{ 153, 0x2E49, "DEVICE" },
+	{ 154, 0x2E97, "EAST" },
+	{ 155, 0x2ED8, "FAIL" },
+	{ 156, 0x2F1D, "FREQUENCY" },
+	{ 157, 0x2F8B, "GATE" },
+	{ 158, 0x2FD4, "HIGH" },
+	{ 159, 0x300A, "INTRUDER" },
+	{ 160, 0x307D, "MEASURE" },
+	{ 161, 0x30CE, "NORTH" },
+	{ 162, 0x3121, "PASS" },
+	{ 163, 0x3172, "POSITION" },
+	{ 164, 0x31D1, "PUSH" },
+	{ 165, 0x3201, "WRITE" },
+	{ 166, 0x324A, "SLOW" },
+	{ 167, 0x3292, "TOOL" },
+	{ 168, 0x32D1, "WEST" },
+	{ 169, 0x3324, "KILO" },
+	{ 170, 0x3373, "OSCAR" },
+	{ 171, 0x33C6, "SIERRA" },
+	{ 172, 0x341D, "WHISKY" },
+	{ 173, 0x3476, "AND" },
+	{ 174, 0x34CD, "FARAD" },
+	{ 175, 0x351D, "MILLI" },
+	{ 176, 0x3556, "CAUTION" },
+	{ 177, 0x35B1, "LIGHT" },
+	{ 178, 0x3601, "CHECK" },
+	{ 179, 0x3635, "DEGREES" },
+	{ 180, 0x36CB, "SERVICE" },
+	{ 181, 0x3721, "SWITCH" },
+	{ 182, 0x376E, "VALVE" },
+	{ 183, 0x37CC, "VAL" },
+	{ 184, 0x3820, "NUMBER" },
+	{ 185, 0x3880, "OUT" },
+	{ 186, 0x38B5, "POINT" },
+	{ 187, 0x3904, "BREAK" },
+	{ 188, 0x3948, "HOURS" },
+	{ 189, 0x39AD, "CALIBRATE" },
+	{ 190, 0x3A21, "CRANE" },
+	{ 191, 0x3A75, "DIRECTION" },
+	{ 192, 0x3AE3, "ENTER" },
+	{ 193, 0x3B17, "FEET" },
+	{ 194, 0x3B56, "FROM" },
+	{ 195, 0x3B86, "GAP" },
+	{ 196, 0x3BC8, "HOLD" },
+	{ 197, 0x3C22, "LEFT" },
+	{ 198, 0x3C61, "MILL" },
+	{ 199, 0x3C9C, "UH" },
+	{ 200, 0x3CC5, "PAST" },
+	{ 201, 0x3D11, "PRESS" },
+	{ 202, 0x3D54, "RANGE" },
+	{ 203, 0x3DB2, "SAFE" },
+	{ 204, 0x3DF2, "SOUTH" },
+	{ 205, 0x3E48, "TURN" },
+	{ 206, 0x3E8B, "YELLOW" },
+};
+
+#endif /* PHROMWORDS_H_ */
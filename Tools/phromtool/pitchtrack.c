@@ -0,0 +1,274 @@
+/************************************************************************
+	pitchtrack.c
+
+    Pitch tracking for the LPC encoder
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pitchtrack.h"
+#include "lpcframe.h"
+#include "lpcsynth.h"
+#include "lpctables.h"
+
+// M_PI and M_SQRT2 are POSIX rather than C99
+#define PI		3.14159265358979323846
+#define SQRT2	1.41421356237309504880
+
+// Scoring window (48ms) and its start relative to the frame's
+#define WINDOW_SAMPLES	384
+#define WINDOW_OFFSET	(LPC_FRAME_SAMPLES - WINDOW_SAMPLES / 2)
+
+// Longest lag scored (the longest pitch table period is 211)
+#define MAX_LAG			256
+
+// Frames scored per pool task
+#define TASK_FRAMES		32
+
+// Track costs: a frame is as cheap voiced as unvoiced at a periodicity of
+// PITCH_VOICED_THRESHOLD; longer lags pay slightly more (against picking
+// a multiple of the period); jumps pay per octave and voicing changes a
+// fixed amount
+#define LAG_COST			0.05f
+#define JUMP_COST			0.4f
+#define VOICING_COST		0.5f
+
+// Low-pass filter cut-off (the fundamental and first harmonics only)
+#define LOWPASS_HZ		1000.0
+
+#define VECTOR_LANES	4
+typedef float vector_t __attribute__((vector_size(VECTOR_LANES * sizeof(float))));
+typedef int32_t maskVector_t __attribute__((vector_size(VECTOR_LANES * sizeof(int32_t))));
+
+static inline vector_t loadVector(const float *source)
+{
+	vector_t value;
+	memcpy(&value, source, sizeof(value));
+	return value;
+}
+
+static inline vector_t absoluteVector(vector_t value)
+{
+	maskVector_t bits = (maskVector_t)value & 0x7FFFFFFF;
+	return (vector_t)bits;
+}
+
+static inline float sumVector(vector_t value)
+{
+	return value[0] + value[1] + value[2] + value[3];
+}
+
+typedef struct {
+	const float *signal;		// Low-passed speech with a window of silence either side
+	int frameCount;
+	int minPeriod, maxPeriod;
+	int pitchCount;
+	uint8_t nearest[MAX_LAG + 1];	// Pitch table index nearest each lag
+	float (*score)[64];			// Best score of each table entry's lags per frame
+	float *best;				// Best score of any lag per frame
+} pitchJob_t;
+
+// Score every lag of a frame
+static void scoreFrame(const pitchJob_t *job, int frame)
+{
+	const float *x = job->signal + WINDOW_SAMPLES + frame * LPC_FRAME_SAMPLES + WINDOW_OFFSET;
+	float energy[WINDOW_SAMPLES + 1];
+	float *score = job->score[frame];
+	
+	energy[0] = 0;
+	for (int n = 0; n < WINDOW_SAMPLES; n++) energy[n + 1] = energy[n] + x[n] * x[n];
+	for (int i = 0; i < job->pitchCount; i++) score[i] = -1.0f;
+	job->best[frame] = 0;
+	if (energy[WINDOW_SAMPLES] <= 0) return;
+	
+	for (int lag = job->minPeriod; lag <= job->maxPeriod; lag++) {
+		int count = WINDOW_SAMPLES - lag, n;
+		vector_t product = { 0 }, difference = { 0 };
+		
+		for (n = 0; n + VECTOR_LANES <= count; n += VECTOR_LANES) {
+			vector_t a = loadVector(x + n), b = loadVector(x + n + lag);
+			product += a * b;
+			difference += absoluteVector(a - b);
+		}
+		float correlation = sumVector(product), magnitude = sumVector(difference);
+		for (; n < count; n++) {
+			correlation += x[n] * x[n + lag];
+			magnitude += fabsf(x[n] - x[n + lag]);
+		}
+		
+		// Normalise both to 1 for a periodic signal and 0 for noise (the
+		// mean absolute difference of uncorrelated Gaussian samples is
+		// 2 / sqrt(pi) times their RMS)
+		float first = energy[count], second = energy[WINDOW_SAMPLES] - energy[lag];
+		if (first <= 0 || second <= 0) continue;
+		float rms = sqrtf((first + second) / (2 * count));
+		float amdf = 1.0f - magnitude / (count * 1.1284f * rms);
+		float value = 0.5f * (correlation / sqrtf(first * second) + amdf);
+		
+		int index = job->nearest[lag];
+		if (value > score[index]) score[index] = value;
+		if (value > job->best[frame]) job->best[frame] = value;
+	}
+}
+
+static void scoreTask(int task, void *argument)
+{
+	const pitchJob_t *job = argument;
+	int end = (task + 1) * TASK_FRAMES < job->frameCount ? (task + 1) * TASK_FRAMES : job->frameCount;
+	
+	for (int frame = task * TASK_FRAMES; frame < end; frame++) scoreFrame(job, frame);
+}
+
+// Second-order Butterworth low-pass (bilinear transform), run in place
+static void lowPass(float *signal, int count)
+{
+	double c = 1.0 / tan(PI * LOWPASS_HZ / LPC_SAMPLE_RATE);
+	double a0 = 1.0 / (1.0 + SQRT2 * c + c * c);
+	double b[3] = { a0, 2 * a0, a0 };
+	double a[2] = { 2.0 * (1.0 - c * c) * a0, (1.0 - SQRT2 * c + c * c) * a0 };
+	double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+	
+	for (int n = 0; n < count; n++) {
+		double y = b[0] * signal[n] + b[1] * x1 + b[2] * x2 - a[0] * y1 - a[1] * y2;
+		x2 = x1;
+		x1 = signal[n];
+		y2 = y1;
+		y1 = y;
+		signal[n] = (float)y;
+	}
+}
+
+// Track the pitch of PCM
+int pitchTrack(int chip, const int16_t *pcm, int sampleCount, threadPool_t *pool, pitchEstimate_t *estimates)
+{
+	const lpcChip_t *descriptor = lpcGetChip(chip) ? lpcGetChip(chip) : &lpcChipTms5220;
+	const int16_t *table = descriptor->tables->pitch;
+	int frameCount = (sampleCount + LPC_FRAME_SAMPLES - 1) / LPC_FRAME_SAMPLES;
+	pitchJob_t job;
+	int result = -1;
+	
+	job.frameCount = frameCount;
+	job.pitchCount = 1 << descriptor->pitchBits;
+	job.minPeriod = table[1];
+	job.maxPeriod = table[job.pitchCount - 1] < MAX_LAG ? table[job.pitchCount - 1] : MAX_LAG;
+	for (int lag = 0; lag <= MAX_LAG; lag++) {
+		int best = 1;
+		for (int i = 2; i < job.pitchCount; i++) {
+			if (abs(table[i] - lag) < abs(table[best] - lag)) best = i;
+		}
+		job.nearest[lag] = (uint8_t)best;
+	}
+	
+	// The speech as floats with a window of silence either side
+	int signalCount = WINDOW_SAMPLES + frameCount * LPC_FRAME_SAMPLES + WINDOW_SAMPLES;
+	float *signal = calloc(signalCount, sizeof(float));
+	job.score = malloc((frameCount + 1) * sizeof(*job.score));
+	job.best = malloc((frameCount + 1) * sizeof(float));
+	float (*cost)[64] = malloc((frameCount + 1) * sizeof(*cost));
+	uint8_t (*from)[64] = malloc((frameCount + 1) * sizeof(*from));
+	if (signal == NULL || job.score == NULL || job.best == NULL || cost == NULL || from == NULL) goto done;
+	
+	for (int n = 0; n < sampleCount; n++) signal[WINDOW_SAMPLES + n] = pcm[n] / 32768.0f;
+	lowPass(signal, signalCount);
+	job.signal = signal;
+	
+	int tasks = (frameCount + TASK_FRAMES - 1) / TASK_FRAMES;
+	if (pool) threadPoolParallelFor(pool, tasks, scoreTask, &job);
+	else for (int task = 0; task < tasks; task++) scoreTask(task, &job);
+	
+	// Viterbi over the table: state 0 is unvoiced, the rest are periods.
+	// The table is in order of period, so the cheapest jump into each
+	// voiced state is found for all of them at once by a distance
+	// transform (a pass each way) rather than by trying every pair.
+	float logPeriod[64];
+	for (int i = 1; i < job.pitchCount; i++) logPeriod[i] = log2f(table[i]);
+	
+	for (int frame = 0; frame < frameCount; frame++) {
+		float local[64], reach[64];
+		uint8_t reachFrom[64];
+		local[0] = 1.0f - 2.0f * PITCH_VOICED_THRESHOLD + job.best[frame];
+		for (int i = 1; i < job.pitchCount; i++)
+			local[i] = 1.0f - job.score[frame][i] + LAG_COST * table[i] / table[job.pitchCount - 1];
+		
+		if (frame == 0) {
+			for (int i = 0; i < job.pitchCount; i++) {
+				cost[0][i] = local[i];
+				from[0][i] = 0;
+			}
+			continue;
+		}
+		
+		const float *previous = cost[frame - 1];
+		int voiced = 1;
+		for (int i = 1; i < job.pitchCount; i++) {
+			float step = JUMP_COST * (logPeriod[i] - logPeriod[i - 1]);
+			if (i > 1 && reach[i - 1] + step < previous[i]) {
+				reach[i] = reach[i - 1] + step;
+				reachFrom[i] = reachFrom[i - 1];
+			} else {
+				reach[i] = previous[i];
+				reachFrom[i] = (uint8_t)i;
+			}
+			if (previous[i] < previous[voiced]) voiced = i;
+		}
+		for (int i = job.pitchCount - 2; i >= 1; i--) {
+			float step = JUMP_COST * (logPeriod[i + 1] - logPeriod[i]);
+			if (reach[i + 1] + step < reach[i]) {
+				reach[i] = reach[i + 1] + step;
+				reachFrom[i] = reachFrom[i + 1];
+			}
+		}
+		
+		// Unvoiced from unvoiced or the cheapest voiced state, voiced from
+		// the transform or unvoiced
+		int unvoiced = previous[voiced] + VOICING_COST < previous[0];
+		cost[frame][0] = local[0] + (unvoiced ? previous[voiced] + VOICING_COST : previous[0]);
+		from[frame][0] = (uint8_t)(unvoiced ? voiced : 0);
+		for (int i = 1; i < job.pitchCount; i++) {
+			int onset = previous[0] + VOICING_COST < reach[i];
+			cost[frame][i] = local[i] + (onset ? previous[0] + VOICING_COST : reach[i]);
+			from[frame][i] = onset ? 0 : reachFrom[i];
+		}
+	}
+	
+	int state = 0;
+	for (int i = 1; frameCount && i < job.pitchCount; i++) {
+		if (cost[frameCount - 1][i] < cost[frameCount - 1][state]) state = i;
+	}
+	for (int frame = frameCount - 1; frame >= 0; frame--) {
+		estimates[frame].pitch = (uint8_t)state;
+		estimates[frame].periodicity = state ? job.score[frame][state] : job.best[frame];
+		state = from[frame][state];
+	}
+	result = 0;
+	
+done:
+	free(signal);
+	free(job.score);
+	free(job.best);
+	free(cost);
+	free(from);
+	return result;
+}
@@ -0,0 +1,60 @@
+/************************************************************************
+	pitchtrack.h
+
+    Pitch tracking for the LPC encoder
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef PITCHTRACK_H_
+#define PITCHTRACK_H_
+
+#include <stdint.h>
+
+#include "threadpool.h"
+
+// The tracker finds the pitch of each 200-sample frame over a 48ms window
+// centred on the end of the frame (as the encoder's LPC analysis is).  The
+// speech is low-passed, then every lag in the chip's pitch range is scored
+// by its normalised autocorrelation together with its normalised AMDF
+// (average magnitude difference), both summed in one vector pass.  Each
+// pitch table entry takes the best score of the lags nearest it, and a
+// Viterbi search over the table (plus an unvoiced state) picks the track:
+// it charges for weak periodicity, for pitch jumps and for changes of
+// voicing, so single-frame octave errors and voicing flickers are ironed
+// out and the result is already quantised.
+
+// The periodicity at which a frame is as likely voiced as not
+#define PITCH_VOICED_THRESHOLD	0.4f
+
+typedef struct {
+	uint8_t pitch;			// Pitch table index (0 for unvoiced)
+	float periodicity;		// Score at the period, or at the best lag if
+							// unvoiced (1 is periodic, 0 noise)
+} pitchEstimate_t;
+
+// Track the pitch of 8KHz PCM for the chip's pitch table, filling
+// (sampleCount + 199) / 200 estimates.  Frames are scored across the pool
+// (NULL to run in the calling thread, as a pool task must).  Returns 0 or
+// -1 if out of memory.
+int pitchTrack(int chip, const int16_t *pcm, int sampleCount, threadPool_t *pool, pitchEstimate_t *estimates);
+
+#endif /* PITCHTRACK_H_ */
@@ -0,0 +1,226 @@
+/************************************************************************
+	resampler.c
+
+    Streaming polyphase resampler for synthesiser output
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#include "resampler.h"
+
+// M_PI is POSIX rather than C99
+#define PI	3.14159265358979323846
+
+// Input is converted to float in chunks of this many samples
+#define RESAMPLER_CHUNK		1024
+
+// Limit on the taps per phase when decimating by a large factor
+#define RESAMPLER_MAX_TAPS	1024
+
+struct resampler {
+	uint32_t up, down;		// L and M
+	int taps;
+	uint32_t phase;			// Current phase (0 to L-1)
+	int position;			// Buffer index of the newest input of the next output
+	float *coefficients;	// L phases of taps, each stored oldest-input first
+	float *buffer;			// taps - 1 samples of history then the current chunk
+};
+
+static uint32_t greatestCommonDivisor(uint32_t a, uint32_t b)
+{
+	while (b) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+// Zeroth-order modified Bessel function (for the Kaiser window)
+static double besselI0(double x)
+{
+	double sum = 1.0, term = 1.0;
+	for (int k = 1; k < 32; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+resampler_t *resamplerCreate(uint32_t inputRate, uint32_t outputRate, int quality)
+{
+	static const int qualityTaps[] = { 8, 16, 32 };
+	static const double qualityBeta[] = { 5.0, 7.0, 9.0 };
+	static const double qualityCutoff[] = { 0.80, 0.88, 0.94 };
+	
+	if (inputRate == 0 || outputRate == 0 || quality < RESAMPLER_FAST || quality > RESAMPLER_BEST) return NULL;
+	
+	uint32_t divisor = greatestCommonDivisor(inputRate, outputRate);
+	uint32_t up = outputRate / divisor, down = inputRate / divisor;
+	if (up > 1024) return NULL;
+	
+	resampler_t *resampler = calloc(1, sizeof(resampler_t));
+	if (resampler == NULL) return NULL;
+	
+	// When decimating the cutoff falls to the output's Nyquist frequency,
+	// so the taps (counted in input samples) grow by M/L to keep the
+	// transition band the same fraction of it.  The dot product works in
+	// multiples of 8 taps.
+	int taps = qualityTaps[quality];
+	if (down > up) taps = (int)(((uint64_t)taps * down / up + 7) & ~(uint64_t)7);
+	if (taps > RESAMPLER_MAX_TAPS) taps = RESAMPLER_MAX_TAPS;
+	resampler->up = up;
+	resampler->down = down;
+	resampler->taps = taps;
+	resampler->position = taps - 1;
+	void *coefficients = NULL, *buffer = NULL;
+	if (posix_memalign(&coefficients, 16, up * taps * sizeof(float)) == 0) resampler->coefficients = coefficients;
+	if (posix_memalign(&buffer, 16, ((taps - 1 + RESAMPLER_CHUNK + 3) & ~3) * sizeof(float)) == 0) resampler->buffer = buffer;
+	if (resampler->coefficients == NULL || resampler->buffer == NULL) {
+		resamplerDestroy(resampler);
+		return NULL;
+	}
+	memset(resampler->buffer, 0, (taps - 1) * sizeof(float));
+	
+	// The prototype runs at the raised rate; its cutoff is a fraction of
+	// the input's Nyquist frequency, scaled by L/M when decimating (so of
+	// the output's), and its gain of L restores the level lost to the
+	// inserted zeros
+	uint32_t length = up * taps;
+	double cutoff = qualityCutoff[quality] * 0.5 / up;
+	if (down > up) cutoff *= (double)up / down;
+	double centre = (length - 1) / 2.0;
+	double beta = qualityBeta[quality];
+	
+	for (uint32_t j = 0; j < length; j++) {
+		double t = j - centre;
+		double sinc = t == 0 ? 2.0 * cutoff : sin(2.0 * PI * cutoff * t) / (PI * t);
+		double ratio = 2.0 * j / (length - 1) - 1.0;
+		double window = besselI0(beta * sqrt(1.0 - ratio * ratio)) / besselI0(beta);
+		
+		// Phase p uses h[p + kL] against input n - k; store it reversed so
+		// the dot product runs over the buffer in address order
+		uint32_t phase = j % up, k = j / up;
+		resampler->coefficients[phase * taps + (taps - 1 - k)] = (float)(sinc * window * up);
+	}
+	
+	return resampler;
+}
+
+void resamplerDestroy(resampler_t *resampler)
+{
+	if (resampler == NULL) return;
+	free(resampler->coefficients);
+	free(resampler->buffer);
+	free(resampler);
+}
+
+int resamplerMaxOutput(const resampler_t *resampler, int inputCount)
+{
+	return (int)(((uint64_t)inputCount * resampler->up + resampler->down - 1) / resampler->down) + 1;
+}
+
+int resamplerDelay(const resampler_t *resampler)
+{
+	return resampler->taps / 2;
+}
+
+static inline float dotProduct(const float *coefficients, const float *samples, int taps)
+{
+#if defined(__SSE__)
+	// Coefficients are aligned; the sample window slides so may not be
+	__m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps();
+	for (int i = 0; i < taps; i += 8) {
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_load_ps(coefficients + i), _mm_loadu_ps(samples + i)));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_load_ps(coefficients + i + 4), _mm_loadu_ps(samples + i + 4)));
+	}
+	sum0 = _mm_add_ps(sum0, sum1);
+	sum0 = _mm_add_ps(sum0, _mm_movehl_ps(sum0, sum0));
+	sum0 = _mm_add_ss(sum0, _mm_shuffle_ps(sum0, sum0, 1));
+	return _mm_cvtss_f32(sum0);
+#else
+	float sum = 0;
+	for (int i = 0; i < taps; i++) sum += coefficients[i] * samples[i];
+	return sum;
+#endif
+}
+
+static inline int16_t toSample(float value)
+{
+	if (value > 32767.0f) return 32767;
+	if (value < -32768.0f) return -32768;
+	return (int16_t)lrintf(value);
+}
+
+// Resample a block of input
+int resamplerProcess(resampler_t *resampler, const int16_t *input, int inputCount, int16_t *output)
+{
+	const int history = resampler->taps - 1;
+	float *buffer = resampler->buffer;
+	int outputCount = 0;
+	
+	while (inputCount > 0) {
+		int chunk = inputCount < RESAMPLER_CHUNK ? inputCount : RESAMPLER_CHUNK;
+		for (int i = 0; i < chunk; i++) buffer[history + i] = input[i];
+		int end = history + chunk;
+		
+		// position is the newest input sample the next output depends on
+		int position = resampler->position;
+		uint32_t phase = resampler->phase;
+		while (position < end) {
+			const float *coefficients = resampler->coefficients + phase * resampler->taps;
+			output[outputCount++] = toSample(dotProduct(coefficients, buffer + position - history, resampler->taps));
+			
+			phase += resampler->down;
+			position += phase / resampler->up;
+			phase %= resampler->up;
+		}
+		
+		// Keep the last taps - 1 inputs as history for the next chunk
+		memmove(buffer, buffer + chunk, history * sizeof(float));
+		resampler->position = position - chunk;
+		resampler->phase = phase;
+		input += chunk;
+		inputCount -= chunk;
+	}
+	
+	return outputCount;
+}
+
+// Push the filter's remaining history out
+int resamplerFlush(resampler_t *resampler, int16_t *output)
+{
+	static const int16_t silence[RESAMPLER_MAX_TAPS] = { 0 };
+	return resamplerProcess(resampler, silence, resampler->taps, output);
+}
+
+int resamplerFlushOutput(const resampler_t *resampler)
+{
+	return resamplerMaxOutput(resampler, resampler->taps);
+}
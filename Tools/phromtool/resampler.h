@@ -0,0 +1,64 @@
+/************************************************************************
+	resampler.h
+
+    Streaming polyphase resampler for synthesiser output
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef RESAMPLER_H_
+#define RESAMPLER_H_
+
+#include <stdint.h>
+
+// The input rate is raised by L and lowered by M (the rate ratio reduced
+// to lowest terms, e.g. 6/1 for 8KHz to 48KHz or 441/80 for 44.1KHz).
+// A Kaiser-windowed sinc low-pass of L * taps coefficients is split into
+// L phases of taps coefficients each, so every output sample is a single
+// taps-long dot product over the most recent input samples.  When
+// decimating (M > L) the cutoff follows the output's Nyquist frequency and
+// the taps per phase are scaled up by M/L (rounded up to a multiple of 8).
+#define RESAMPLER_FAST		0		// 8 taps per phase
+#define RESAMPLER_MEDIUM	1		// 16 taps per phase
+#define RESAMPLER_BEST		2		// 32 taps per phase
+
+typedef struct resampler resampler_t;
+
+// Create a resampler (NULL if the rates are unsupported or out of memory)
+resampler_t *resamplerCreate(uint32_t inputRate, uint32_t outputRate, int quality);
+void resamplerDestroy(resampler_t *resampler);
+
+// The most samples resamplerProcess() can produce from inputCount samples
+int resamplerMaxOutput(const resampler_t *resampler, int inputCount);
+
+// Resample a block of input (any length, all consumed); returns the
+// number of samples written to output
+int resamplerProcess(resampler_t *resampler, const int16_t *input, int inputCount, int16_t *output);
+
+// Push the filter's remaining history out (silence follows); output must
+// hold resamplerFlushOutput() samples
+int resamplerFlush(resampler_t *resampler, int16_t *output);
+int resamplerFlushOutput(const resampler_t *resampler);
+
+// The filter delay in input samples (taps / 2)
+int resamplerDelay(const resampler_t *resampler);
+
+#endif /* RESAMPLER_H_ */
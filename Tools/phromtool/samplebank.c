@@ -0,0 +1,237 @@
+/************************************************************************
+	samplebank.c
+
+    Memory-mapped files of pre-rendered word PCM
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "samplebank.h"
+#include "batchrender.h"
+#include "lpcframe.h"
+#include "lpcsynth.h"
+
+// Entry indexes are sorted by address with a stable insertion sort (word
+// lists are nearly in address order already)
+static void sortByAddress(const sampleBankEntry_t *entries, uint16_t *byAddress, uint32_t count)
+{
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t j = i;
+		while (j > 0 && entries[byAddress[j - 1]].address > entries[i].address) {
+			byAddress[j] = byAddress[j - 1];
+			j--;
+		}
+		byAddress[j] = i;
+	}
+}
+
+// Render every listed word of an image and write the bank to path
+int sampleBankWrite(const char *path, const phromImage_t *image, const lpcSettings_t *settings, int lanes,
+	threadPool_t *pool)
+{
+	uint32_t count = image->wordCount;
+	int16_t **samples = calloc(count ? count : 1, sizeof(int16_t *));
+	uint32_t *lengths = calloc(count ? count : 1, sizeof(uint32_t));
+	sampleBankEntry_t *entries = calloc(count, sizeof(sampleBankEntry_t));
+	uint16_t *byAddress = calloc(count, sizeof(uint16_t));
+	char temporary[1024] = "";
+	FILE *file = NULL;
+	int result = -1;
+	
+	if (count > UINT16_MAX || samples == NULL || lengths == NULL || entries == NULL || byAddress == NULL) goto done;
+	
+	if (batchRenderWords(image, settings, lanes, pool, samples, lengths) != 0) goto done;
+	
+	sampleBankHeader_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SAMPLEBANK_MAGIC, sizeof(header.magic));
+	header.version = SAMPLEBANK_VERSION;
+	header.sampleRate = LPC_SAMPLE_RATE;
+	header.imageHash = image->hash;
+	header.wordListHash = phromHashWordList(image);
+	header.settings = lpcSettingsKey(settings);
+	header.entryCount = count;
+	
+	size_t indexEnd = sizeof(header) + count * (sizeof(sampleBankEntry_t) + sizeof(uint16_t));
+	header.samplesOffset = (indexEnd + SAMPLEBANK_ALIGN - 1) & ~(uint64_t)(SAMPLEBANK_ALIGN - 1);
+	
+	for (uint32_t i = 0; i < count; i++) {
+		entries[i].number = image->words[i].number;
+		entries[i].address = image->words[i].address;
+		entries[i].length = lengths[i];
+		entries[i].offset = header.sampleCount;
+		header.sampleCount += lengths[i];
+	}
+	sortByAddress(entries, byAddress, count);
+	
+	snprintf(temporary, sizeof(temporary), "%s.%ld.tmp", path, (long)getpid());
+	file = fopen(temporary, "wb");
+	if (file == NULL) goto done;
+	
+	static const uint8_t padding[SAMPLEBANK_ALIGN] = { 0 };
+	if (fwrite(&header, sizeof(header), 1, file) != 1) goto done;
+	if (fwrite(entries, sizeof(sampleBankEntry_t), count, file) != count) goto done;
+	if (fwrite(byAddress, sizeof(uint16_t), count, file) != count) goto done;
+	if (fwrite(padding, 1, header.samplesOffset - indexEnd, file) != header.samplesOffset - indexEnd) goto done;
+	for (uint32_t i = 0; i < count; i++) {
+		if (fwrite(samples[i], sizeof(int16_t), lengths[i], file) != lengths[i]) goto done;
+	}
+	
+	int closed = fclose(file);
+	file = NULL;
+	if (closed == 0 && rename(temporary, path) == 0) result = 0;
+	
+done:
+	if (file) fclose(file);
+	if (result != 0 && temporary[0]) remove(temporary);
+	if (samples) {
+		for (uint32_t i = 0; i < count; i++) free(samples[i]);
+	}
+	free(samples);
+	free(lengths);
+	free(entries);
+	free(byAddress);
+	return result;
+}
+
+// Map a bank read-only and check it against the image, its word list and
+// the settings
+int sampleBankOpen(const char *path, const phromImage_t *image, const lpcSettings_t *settings, sampleBank_t *bank)
+{
+	struct stat status;
+	memset(bank, 0, sizeof(sampleBank_t));
+	
+	int descriptor = open(path, O_RDONLY);
+	if (descriptor < 0) return SAMPLEBANK_MISSING;
+	if (fstat(descriptor, &status) != 0 || (size_t)status.st_size < sizeof(sampleBankHeader_t)) {
+		close(descriptor);
+		return SAMPLEBANK_MISSING;
+	}
+	
+	void *map = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+	close(descriptor);
+	if (map == MAP_FAILED) return SAMPLEBANK_MISSING;
+	
+	const sampleBankHeader_t *header = map;
+	size_t size = status.st_size;
+	int result = SAMPLEBANK_OK;
+	
+	// Check the layout fits the file before trusting any offsets (dividing
+	// rather than multiplying, so no sum can overflow)
+	const size_t indexEntry = sizeof(sampleBankEntry_t) + sizeof(uint16_t);
+	if (memcmp(header->magic, SAMPLEBANK_MAGIC, sizeof(header->magic)) != 0 ||
+		header->version != SAMPLEBANK_VERSION ||
+		header->entryCount > (size - sizeof(sampleBankHeader_t)) / indexEntry ||
+		header->samplesOffset < sizeof(sampleBankHeader_t) + header->entryCount * indexEntry ||
+		header->samplesOffset > size ||
+		header->sampleCount > (size - header->samplesOffset) / sizeof(int16_t)) {
+		result = SAMPLEBANK_MISSING;
+	} else if (header->imageHash != image->hash || header->wordListHash != phromHashWordList(image) ||
+		header->settings != lpcSettingsKey(settings) || header->sampleRate != LPC_SAMPLE_RATE) {
+		result = SAMPLEBANK_STALE;
+	}
+	
+	// Every entry's samples and every address index must be in range
+	bank->entries = (const sampleBankEntry_t *)(header + 1);
+	bank->byAddress = (const uint16_t *)(bank->entries + header->entryCount);
+	for (uint32_t i = 0; result == SAMPLEBANK_OK && i < header->entryCount; i++) {
+		const sampleBankEntry_t *entry = &bank->entries[i];
+		if (entry->offset > header->sampleCount || entry->length > header->sampleCount - entry->offset ||
+			bank->byAddress[i] >= header->entryCount) result = SAMPLEBANK_MISSING;
+	}
+	
+	if (result != SAMPLEBANK_OK) {
+		munmap(map, size);
+		memset(bank, 0, sizeof(sampleBank_t));
+		return result;
+	}
+	
+	bank->map = map;
+	bank->mapSize = size;
+	bank->header = header;
+	bank->samples = (const int16_t *)((const uint8_t *)map + header->samplesOffset);
+	return SAMPLEBANK_OK;
+}
+
+void sampleBankClose(sampleBank_t *bank)
+{
+	if (bank->map) munmap(bank->map, bank->mapSize);
+	memset(bank, 0, sizeof(sampleBank_t));
+}
+
+// Open a bank, rewriting it first if it is missing or stale
+int sampleBankLoad(const char *path, const phromImage_t *image, const lpcSettings_t *settings,
+	int lanes, threadPool_t *pool, sampleBank_t *bank)
+{
+	if (sampleBankOpen(path, image, settings, bank) == SAMPLEBANK_OK) return SAMPLEBANK_OK;
+	if (sampleBankWrite(path, image, settings, lanes, pool) != 0) return -1;
+	return sampleBankOpen(path, image, settings, bank) == SAMPLEBANK_OK ? 1 : -1;
+}
+
+static const int16_t *entrySamples(const sampleBank_t *bank, const sampleBankEntry_t *entry, uint32_t *length)
+{
+	if (entry->length == 0) return NULL;
+	*length = entry->length;
+	return bank->samples + entry->offset;
+}
+
+// Find a word's PCM by number (binary search, falling back to a scan for
+// word lists that are not in number order)
+const int16_t *sampleBankFindNumber(const sampleBank_t *bank, uint16_t number, uint32_t *length)
+{
+	const sampleBankEntry_t *entries = bank->entries;
+	uint32_t low = 0, high = bank->header->entryCount;
+	
+	while (low < high) {
+		uint32_t middle = (low + high) / 2;
+		if (entries[middle].number < number) low = middle + 1;
+		else high = middle;
+	}
+	if (low < bank->header->entryCount && entries[low].number == number) return entrySamples(bank, &entries[low], length);
+	
+	for (uint32_t i = 0; i < bank->header->entryCount; i++) {
+		if (entries[i].number == number) return entrySamples(bank, &entries[i], length);
+	}
+	return NULL;
+}
+
+// Find a word's PCM by address (binary search of the address index)
+const int16_t *sampleBankFindAddress(const sampleBank_t *bank, uint16_t address, uint32_t *length)
+{
+	uint32_t low = 0, high = bank->header->entryCount;
+	
+	while (low < high) {
+		uint32_t middle = (low + high) / 2;
+		if (bank->entries[bank->byAddress[middle]].address < address) low = middle + 1;
+		else high = middle;
+	}
+	if (low < bank->header->entryCount && bank->entries[bank->byAddress[low]].address == address)
+		return entrySamples(bank, &bank->entries[bank->byAddress[low]], length);
+	return NULL;
+}
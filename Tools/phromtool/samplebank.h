@@ -0,0 +1,109 @@
+/************************************************************************
+	samplebank.h
+
+    Memory-mapped files of pre-rendered word PCM
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef SAMPLEBANK_H_
+#define SAMPLEBANK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lpcrender.h"
+#include "phromimage.h"
+#include "threadpool.h"
+
+// A sample bank file holds the rendered PCM of every listed word of an
+// image.  All fields are in host byte order:
+//
+//   sampleBankHeader_t
+//   sampleBankEntry_t[entryCount]	in word list order
+//   uint16_t[entryCount]			entry indexes sorted by address
+//   int16_t samples[]				aligned to SAMPLEBANK_ALIGN bytes
+//
+// The header records the image and word list hashes and the settings key
+// the bank was rendered from; a bank that does not match all three is
+// stale.
+
+#define SAMPLEBANK_MAGIC	"PHROMPCM"
+#define SAMPLEBANK_VERSION	3
+#define SAMPLEBANK_ALIGN	64
+
+// sampleBankOpen() return codes
+#define SAMPLEBANK_OK		0
+#define SAMPLEBANK_MISSING	-1		// No such file or not a sample bank
+#define SAMPLEBANK_STALE	-2		// Rendered from another image, word list or settings
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t sampleRate;
+	uint64_t imageHash;
+	uint64_t wordListHash;	// From phromHashWordList()
+	uint32_t settings;		// From lpcSettingsKey()
+	uint32_t entryCount;
+	uint64_t samplesOffset;	// Byte offset of the samples from the file start
+	uint64_t sampleCount;
+} sampleBankHeader_t;
+
+typedef struct {
+	uint16_t number;
+	uint16_t address;
+	uint32_t length;		// Samples (0 if the word did not render)
+	uint64_t offset;		// Sample offset of the word's PCM
+} sampleBankEntry_t;
+
+typedef struct {
+	void *map;
+	size_t mapSize;
+	const sampleBankHeader_t *header;
+	const sampleBankEntry_t *entries;
+	const uint16_t *byAddress;
+	const int16_t *samples;
+} sampleBank_t;
+
+// Render every listed word of an image (through lanes 4, 8 or 16 of the
+// lane renderer, or 0 for the reference synthesiser; see
+// batchRenderWords()) and write the bank to path (written to a temporary
+// file and renamed, so readers never see a partial bank).  Returns 0 on
+// success or -1 on failure.
+int sampleBankWrite(const char *path, const phromImage_t *image, const lpcSettings_t *settings, int lanes,
+	threadPool_t *pool);
+
+// Map a bank read-only and check it against the image, its word list and
+// the settings
+int sampleBankOpen(const char *path, const phromImage_t *image, const lpcSettings_t *settings, sampleBank_t *bank);
+void sampleBankClose(sampleBank_t *bank);
+
+// Open a bank, rewriting it first if it is missing or stale.  Returns
+// SAMPLEBANK_OK, or 1 if the bank was rewritten, or -1 on failure.
+int sampleBankLoad(const char *path, const phromImage_t *image, const lpcSettings_t *settings,
+	int lanes, threadPool_t *pool, sampleBank_t *bank);
+
+// Find a word's PCM by number or address; returns the samples (and sets
+// *length) or NULL if the word is not in the bank
+const int16_t *sampleBankFindNumber(const sampleBank_t *bank, uint16_t number, uint32_t *length);
+const int16_t *sampleBankFindAddress(const sampleBank_t *bank, uint16_t address, uint32_t *length);
+
+#endif /* SAMPLEBANK_H_ */
@@ -0,0 +1,230 @@
+/************************************************************************
+	scheduler.c
+
+    Priority utterance scheduler with frame-boundary preemption
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "scheduler.h"
+
+typedef struct utterance {
+	struct utterance *next;
+	int id;
+	int priority;
+	double deadline;
+	double submitted;
+	int started;
+	int nextFrame;
+	int frameCount;
+	lpcVoice_t voice;
+	lpcFrame_t frames[];
+} utterance_t;
+
+typedef struct {
+	uint64_t submitted, completed, dropped, deadlineMisses, preemptions;
+	latencyRecorder_t start, finish;
+} priorityMetrics_t;
+
+struct scheduler {
+	pthread_mutex_t lock;
+	lpcSettings_t settings;
+	int nextId;
+	int pending;
+	
+	// One queue per priority, each in deadline order (no deadline last)
+	utterance_t *queues[SCHEDULER_PRIORITIES];
+	utterance_t *current;
+	priorityMetrics_t metrics[SCHEDULER_PRIORITIES];
+};
+
+scheduler_t *schedulerCreate(const lpcSettings_t *settings)
+{
+	scheduler_t *scheduler = calloc(1, sizeof(scheduler_t));
+	if (scheduler == NULL) return NULL;
+	
+	pthread_mutex_init(&scheduler->lock, NULL);
+	scheduler->settings = *settings;
+	scheduler->nextId = 1;
+	for (int i = 0; i < SCHEDULER_PRIORITIES; i++) {
+		latencyReset(&scheduler->metrics[i].start);
+		latencyReset(&scheduler->metrics[i].finish);
+	}
+	return scheduler;
+}
+
+void schedulerDestroy(scheduler_t *scheduler)
+{
+	if (scheduler == NULL) return;
+	
+	for (int i = 0; i < SCHEDULER_PRIORITIES; i++) {
+		while (scheduler->queues[i]) {
+			utterance_t *next = scheduler->queues[i]->next;
+			free(scheduler->queues[i]);
+			scheduler->queues[i] = next;
+		}
+	}
+	free(scheduler->current);
+	pthread_mutex_destroy(&scheduler->lock);
+	free(scheduler);
+}
+
+// Insert in deadline order behind any equal deadlines (the lock must be held)
+static void enqueue(scheduler_t *scheduler, utterance_t *utterance)
+{
+	utterance_t **link = &scheduler->queues[utterance->priority];
+	while (*link && (utterance->deadline == 0 ||
+		((*link)->deadline != 0 && (*link)->deadline <= utterance->deadline))) link = &(*link)->next;
+	
+	utterance->next = *link;
+	*link = utterance;
+}
+
+// Queue an utterance
+int schedulerSubmit(scheduler_t *scheduler, const lpcFrame_t *frames, int frameCount,
+	int priority, double deadline, double now)
+{
+	if (priority < 0 || priority >= SCHEDULER_PRIORITIES || frameCount < 1) return -1;
+	
+	utterance_t *utterance = malloc(sizeof(utterance_t) + frameCount * sizeof(lpcFrame_t));
+	if (utterance == NULL) return -1;
+	
+	memcpy(utterance->frames, frames, frameCount * sizeof(lpcFrame_t));
+	utterance->frameCount = frameCount;
+	utterance->nextFrame = 0;
+	utterance->priority = priority;
+	utterance->deadline = deadline;
+	utterance->submitted = now;
+	utterance->started = 0;
+	lpcVoiceInitialise(&utterance->voice, &scheduler->settings);
+	
+	pthread_mutex_lock(&scheduler->lock);
+	utterance->id = scheduler->nextId++;
+	scheduler->metrics[priority].submitted++;
+	scheduler->pending++;
+	enqueue(scheduler, utterance);
+	pthread_mutex_unlock(&scheduler->lock);
+	
+	return utterance->id;
+}
+
+// Take the most urgent queued utterance that can still make its deadline
+// (the lock must be held)
+static utterance_t *takeNext(scheduler_t *scheduler, double now, int belowPriority)
+{
+	for (int priority = 0; priority < belowPriority; priority++) {
+		while (scheduler->queues[priority]) {
+			utterance_t *utterance = scheduler->queues[priority];
+			scheduler->queues[priority] = utterance->next;
+			
+			// Stale announcements are dropped rather than played late
+			if (!utterance->started && utterance->deadline != 0 && now >= utterance->deadline) {
+				scheduler->metrics[priority].dropped++;
+				scheduler->pending--;
+				free(utterance);
+				continue;
+			}
+			return utterance;
+		}
+	}
+	return NULL;
+}
+
+// Render the next frame
+int schedulerRenderFrame(scheduler_t *scheduler, double now, int16_t *output)
+{
+	pthread_mutex_lock(&scheduler->lock);
+	
+	// Preempt at this frame boundary if something more urgent is waiting (a
+	// queued utterance of the same priority never preempts; deadlines only
+	// order each queue)
+	utterance_t *current = scheduler->current;
+	utterance_t *next = takeNext(scheduler, now, current ? current->priority : SCHEDULER_PRIORITIES);
+	if (next) {
+		if (current) {
+			scheduler->metrics[current->priority].preemptions++;
+			enqueue(scheduler, current);
+		}
+		current = scheduler->current = next;
+	}
+	
+	if (current && !current->started) {
+		current->started = 1;
+		latencyRecord(&scheduler->metrics[current->priority].start, now - current->submitted);
+	}
+	pthread_mutex_unlock(&scheduler->lock);
+	
+	if (current == NULL) {
+		memset(output, 0, lpcFrameSamples(&scheduler->settings) * sizeof(int16_t));
+		return -1;
+	}
+	
+	// Only this thread touches the current utterance, so it renders unlocked
+	lpcVoiceFrame(&current->voice, &current->frames[current->nextFrame++], output);
+	int id = current->id;
+	
+	if (current->nextFrame == current->frameCount) {
+		double finished = now + (double)lpcFrameSamples(&scheduler->settings) * 1e6 / LPC_SAMPLE_RATE;
+		
+		pthread_mutex_lock(&scheduler->lock);
+		priorityMetrics_t *metrics = &scheduler->metrics[current->priority];
+		metrics->completed++;
+		if (current->deadline != 0 && finished > current->deadline) metrics->deadlineMisses++;
+		latencyRecord(&metrics->finish, finished - current->submitted);
+		scheduler->current = NULL;
+		scheduler->pending--;
+		pthread_mutex_unlock(&scheduler->lock);
+		free(current);
+	}
+	
+	return id;
+}
+
+int schedulerPending(scheduler_t *scheduler)
+{
+	pthread_mutex_lock(&scheduler->lock);
+	int pending = scheduler->pending;
+	pthread_mutex_unlock(&scheduler->lock);
+	return pending;
+}
+
+void schedulerGetStats(scheduler_t *scheduler, int priority, schedulerStats_t *stats)
+{
+	memset(stats, 0, sizeof(schedulerStats_t));
+	if (priority < 0 || priority >= SCHEDULER_PRIORITIES) return;
+	
+	pthread_mutex_lock(&scheduler->lock);
+	priorityMetrics_t *metrics = &scheduler->metrics[priority];
+	stats->submitted = metrics->submitted;
+	stats->completed = metrics->completed;
+	stats->dropped = metrics->dropped;
+	stats->deadlineMisses = metrics->deadlineMisses;
+	stats->preemptions = metrics->preemptions;
+	stats->startP50 = latencyPercentile(&metrics->start, 50);
+	stats->startP99 = latencyPercentile(&metrics->start, 99);
+	stats->finishP50 = latencyPercentile(&metrics->finish, 50);
+	stats->finishP99 = latencyPercentile(&metrics->finish, 99);
+	pthread_mutex_unlock(&scheduler->lock);
+}
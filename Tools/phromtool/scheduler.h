@@ -0,0 +1,78 @@
+/************************************************************************
+	scheduler.h
+
+    Priority utterance scheduler with frame-boundary preemption
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include <stdint.h>
+
+#include "latency.h"
+#include "lpcframe.h"
+#include "lpcrender.h"
+
+// Utterances are rendered one LPC frame (25ms) at a time.  At every frame
+// boundary the most urgent ready utterance is chosen - lowest priority
+// number first, then earliest deadline - so a new urgent utterance starts
+// within one frame of being submitted.  A preempted utterance keeps its
+// own synthesiser state and resumes where it stopped.
+//
+// Times are in microseconds on whatever clock the caller drives the
+// scheduler with (normally the audio clock: one frame per 25000us).
+
+#define SCHEDULER_PRIORITIES	4		// 0 is the most urgent
+
+// Per-priority metrics
+typedef struct {
+	uint64_t submitted;
+	uint64_t completed;
+	uint64_t dropped;			// Could not start before their deadline
+	uint64_t deadlineMisses;	// Completed after their deadline
+	uint64_t preemptions;		// Times an utterance of this priority was interrupted
+	double startP50, startP99;	// Submission to first frame
+	double finishP50, finishP99;	// Submission to last frame
+} schedulerStats_t;
+
+typedef struct scheduler scheduler_t;
+
+scheduler_t *schedulerCreate(const lpcSettings_t *settings);
+void schedulerDestroy(scheduler_t *scheduler);
+
+// Queue an utterance (the frames are copied).  A deadline of 0 means none.
+// Returns the utterance's id or -1.  May be called from any thread.
+int schedulerSubmit(scheduler_t *scheduler, const lpcFrame_t *frames, int frameCount,
+	int priority, double deadline, double now);
+
+// Render the next frame into lpcFrameSamples(settings) samples of output.
+// Returns the id of the utterance played, or -1 if there was nothing to
+// play (output is then silence).
+int schedulerRenderFrame(scheduler_t *scheduler, double now, int16_t *output);
+
+// Utterances queued or playing
+int schedulerPending(scheduler_t *scheduler);
+
+void schedulerGetStats(scheduler_t *scheduler, int priority, schedulerStats_t *stats);
+
+#endif /* SCHEDULER_H_ */
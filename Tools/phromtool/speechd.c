@@ -0,0 +1,800 @@
+/************************************************************************
+	speechd.c
+
+    Speech daemon serving rendered phrases over a Unix socket
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "speechd.h"
+#include "latency.h"
+#include "lpcframe.h"
+#include "lpcrender.h"
+#include "lpcsynth.h"
+#include "phrase.h"
+#include "pcmring.h"
+
+// A rendering, shared by every request it serves until each has been sent
+typedef struct {
+	int references;
+	int sampleCount;
+	int16_t samples[];
+} speechPcm_t;
+
+typedef struct {
+	int fd;					// -1 when the slot is free
+	char input[SPEECHD_MAX_LINE];
+	int inputLength;
+	int busy;				// A SAY request is waiting for its batch or delivery
+	char output[256];		// Reply text not yet sent
+	int outputLength;
+	speechPcm_t *reply;		// PCM following the text (NULL if none)
+	size_t replySent;		// Bytes of it sent
+	double replyReceived;
+	uint32_t generation;	// Changes whenever the slot is reused
+	int passedFd;			// Descriptor received for a RING request
+	pcmRing_t ring;			// Shared memory transport (ring.shared NULL if none)
+	speechPcm_t *delivery;	// PCM still being written into the ring
+	uint32_t delivered;
+	double deliveryReceived;
+} speechClient_t;
+
+// One SAY request of a batch
+typedef struct {
+	speechClient_t *client;
+	uint32_t generation;
+	double received;
+	const phraseWord_t *words[SPEECHD_MAX_WORDS];
+	int wordCount;
+	int flags;
+	lpcSettings_t settings;
+	int renderedBy;			// Index of the job whose PCM this request uses
+	speechPcm_t *pcm;		// NULL on failure
+} speechJob_t;
+
+typedef struct {
+	const phraseIndex_t *index;
+	pcmCache_t *cache;
+	speechJob_t *jobs;
+} speechBatch_t;
+
+typedef struct {
+	const phraseIndex_t *index;
+	pcmCache_t *cache;
+	threadPool_t *pool;
+	speechServeOptions_t options;
+	int listener;
+	speechClient_t clients[SPEECHD_MAX_CLIENTS];
+	speechJob_t *jobs;
+	int jobCount;
+	latencyRecorder_t *latency;
+	speechServeStats_t stats;
+	int stopping;
+} speechServer_t;
+
+static volatile sig_atomic_t stopRequested;
+
+static void stopSignal(int signalNumber)
+{
+	(void)signalNumber;
+	stopRequested = 1;
+}
+
+static double now(void)
+{
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec * 1e6 + time.tv_nsec / 1e3;
+}
+
+// Write everything or fail (a vanished peer must not raise SIGPIPE)
+static int sendAll(int fd, const void *data, size_t length)
+{
+	const uint8_t *bytes = data;
+	while (length > 0) {
+		ssize_t sent = send(fd, bytes, length, MSG_NOSIGNAL);
+		if (sent < 0 && errno == EINTR) continue;
+		if (sent <= 0) return -1;
+		bytes += sent;
+		length -= sent;
+	}
+	return 0;
+}
+
+static void releasePcm(speechPcm_t *pcm)
+{
+	if (pcm && --pcm->references == 0) free(pcm);
+}
+
+static void closeClient(speechClient_t *client)
+{
+	if (client->fd >= 0) close(client->fd);
+	if (client->passedFd >= 0) close(client->passedFd);
+	if (client->ring.shared) pcmRingClose(&client->ring);
+	releasePcm(client->delivery);
+	releasePcm(client->reply);
+	client->fd = -1;
+	client->passedFd = -1;
+	client->delivery = NULL;
+	client->reply = NULL;
+	client->inputLength = 0;
+	client->outputLength = 0;
+	client->busy = 0;
+	client->generation++;
+}
+
+// Send as much queued output as the socket takes without blocking, so a
+// client that stops reading holds up only itself; returns TRUE once
+// everything has gone
+static int flushClient(speechServer_t *server, speechClient_t *client)
+{
+	while (client->fd >= 0 && client->outputLength > 0) {
+		ssize_t sent = send(client->fd, client->output, client->outputLength, MSG_NOSIGNAL);
+		if (sent < 0 && errno == EINTR) continue;
+		if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+		if (sent <= 0) {
+			closeClient(client);
+			return 0;
+		}
+		memmove(client->output, client->output + sent, client->outputLength - sent);
+		client->outputLength -= sent;
+	}
+	
+	while (client->fd >= 0 && client->reply) {
+		size_t length = client->reply->sampleCount * sizeof(int16_t);
+		ssize_t sent = length > client->replySent
+			? send(client->fd, (const uint8_t *)client->reply->samples + client->replySent,
+				length - client->replySent, MSG_NOSIGNAL)
+			: 0;
+		if (sent < 0 && errno == EINTR) continue;
+		if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+		if (sent < 0) {
+			closeClient(client);
+			return 0;
+		}
+		client->replySent += sent;
+		if (client->replySent == length) {
+			latencyRecord(server->latency, now() - client->replyReceived);
+			releasePcm(client->reply);
+			client->reply = NULL;
+			client->busy = 0;
+		}
+	}
+	
+	return client->fd >= 0;
+}
+
+// Queue reply text (lines are only handled once earlier replies have
+// gone, so there is always room)
+static void replyText(speechServer_t *server, speechClient_t *client, const char *text)
+{
+	int length = strlen(text);
+	if (client->fd < 0) return;
+	if (length > (int)sizeof(client->output) - client->outputLength) {
+		closeClient(client);
+		return;
+	}
+	memcpy(client->output + client->outputLength, text, length);
+	client->outputLength += length;
+	flushClient(server, client);
+}
+
+// Parse a SAY request into a job; returns NULL on success or the reason
+static const char *parseSay(speechServer_t *server, char *arguments, speechJob_t *job)
+{
+	job->wordCount = 0;
+	job->flags = 0;
+	memset(&job->settings, 0, sizeof(job->settings));
+	job->settings.chip = server->options.chip;
+	
+	for (char *token = strtok(arguments, " \t"); token; token = strtok(NULL, " \t")) {
+		if (strcmp(token, "--smooth") == 0) {
+			job->flags |= PHRASE_SMOOTH_JOINS;
+		} else if (strcmp(token, "--speed") == 0) {
+			token = strtok(NULL, " \t");
+			int frameSamples = token ? lpcSpeedFrameSamples(strtod(token, NULL)) : -1;
+			if (frameSamples < 0) return "speed must be 0.5 to 2";
+			job->settings.frameSamples = frameSamples;
+		} else if (strcmp(token, "--pitch") == 0) {
+			token = strtok(NULL, " \t");
+			long offset = token ? strtol(token, NULL, 0) : 64;
+			if (offset < -63 || offset > 63) return "pitch must be -63 to 63";
+			job->settings.pitchOffset = (int8_t)offset;
+		} else if (strcmp(token, "--pitch-scale") == 0) {
+			token = strtok(NULL, " \t");
+			int scale = token ? lpcScalePercent(strtod(token, NULL)) : -1;
+			if (scale < 0) return "pitch scale must be 0.5 to 2";
+			job->settings.pitchScale = scale;
+		} else {
+			if (job->wordCount == SPEECHD_MAX_WORDS) return "too many words";
+			job->words[job->wordCount] = phraseFindWord(server->index, token);
+			if (job->words[job->wordCount] == NULL) return "unknown word";
+			job->wordCount++;
+		}
+	}
+	
+	return job->wordCount ? NULL : "no words";
+}
+
+// Handle one request line; returns TRUE if a SAY request was queued
+static int handleLine(speechServer_t *server, speechClient_t *client, char *line)
+{
+	char reply[256];
+	
+	if (strncmp(line, "SAY", 3) == 0 && (line[3] == ' ' || line[3] == '\0')) {
+		speechJob_t *job = &server->jobs[server->jobCount];
+		const char *error = parseSay(server, line + 3, job);
+		if (error) {
+			snprintf(reply, sizeof(reply), "ERR %s\n", error);
+			replyText(server, client, reply);
+			return 0;
+		}
+		job->client = client;
+		job->generation = client->generation;
+		job->received = now();
+		job->pcm = NULL;
+		server->jobCount++;
+		client->busy = 1;
+		return 1;
+	}
+	
+	if (strcmp(line, "STATS") == 0) {
+		pcmCacheStats_t cache;
+		pcmCacheGetStats(server->cache, &cache);
+		uint64_t lookups = cache.hits + cache.misses;
+		snprintf(reply, sizeof(reply), "STATS requests %llu batches %llu coalesced %llu p50 %.0f p99 %.0f "
+			"hitrate %.1f cached %zu entries %u\n",
+			(unsigned long long)server->stats.requests, (unsigned long long)server->stats.batches,
+			(unsigned long long)server->stats.coalesced,
+			latencyPercentile(server->latency, 50), latencyPercentile(server->latency, 99),
+			lookups ? 100.0 * cache.hits / lookups : 0.0, cache.bytes, cache.entries);
+		replyText(server, client, reply);
+	} else if (strncmp(line, "RING", 4) == 0 && line[4] == '\0') {
+		// The ring's descriptor arrives with the request line
+		if (client->passedFd < 0) {
+			replyText(server, client, "ERR no shared memory descriptor\n");
+			return 0;
+		}
+		if (client->ring.shared) pcmRingClose(&client->ring);
+		int attached = pcmRingAttach(client->passedFd, &client->ring);
+		client->passedFd = -1;
+		replyText(server, client, attached == 0 ? "OK\n" : "ERR bad shared memory\n");
+	} else if (strcmp(line, "SHUTDOWN") == 0) {
+		server->stopping = 1;
+		replyText(server, client, "OK\n");
+	} else {
+		replyText(server, client, "ERR unknown request\n");
+	}
+	return 0;
+}
+
+// Take complete lines from a client's input until it has a SAY request
+// queued (later lines wait so replies stay in order)
+static void takeLines(speechServer_t *server, speechClient_t *client)
+{
+	while (client->fd >= 0 && !client->busy && client->outputLength == 0 && server->jobCount < server->options.maxBatch) {
+		char *end = memchr(client->input, '\n', client->inputLength);
+		if (end == NULL) {
+			if (client->inputLength == SPEECHD_MAX_LINE) {
+				replyText(server, client, "ERR request too long\n");
+				closeClient(client);
+			}
+			return;
+		}
+		
+		*end = '\0';
+		if (end > client->input && end[-1] == '\r') end[-1] = '\0';
+		handleLine(server, client, client->input);
+		
+		int used = end + 1 - client->input;
+		memmove(client->input, end + 1, client->inputLength - used);
+		client->inputLength -= used;
+	}
+}
+
+static int sameRequest(const speechJob_t *a, const speechJob_t *b)
+{
+	return a->wordCount == b->wordCount && a->flags == b->flags &&
+		lpcSettingsKey(&a->settings) == lpcSettingsKey(&b->settings) &&
+		memcmp(a->words, b->words, a->wordCount * sizeof(a->words[0])) == 0;
+}
+
+static void renderJob(int index, void *argument)
+{
+	speechBatch_t *batch = argument;
+	speechJob_t *job = &batch->jobs[index];
+	if (job->renderedBy != index) return;
+	
+	// Words spoken one after another come from the cache
+	if (!(job->flags & PHRASE_SMOOTH_JOINS)) {
+		int maxSamples = phraseWordSamples(&job->settings, job->words, job->wordCount);
+		job->pcm = malloc(sizeof(speechPcm_t) + maxSamples * sizeof(int16_t));
+		if (job->pcm == NULL) return;
+		job->pcm->references = 1;
+		job->pcm->sampleCount = phraseRenderWords(batch->index, batch->cache, &job->settings,
+			job->words, job->wordCount, job->pcm->samples, maxSamples);
+		if (job->pcm->sampleCount < 0) {
+			free(job->pcm);
+			job->pcm = NULL;
+		}
+		return;
+	}
+	
+	// Smoothed joins are synthesised across the words' frames
+	lpcFrame_t *frames = malloc(LPC_MAX_WORD_FRAMES * sizeof(lpcFrame_t));
+	if (frames == NULL) return;
+	
+	int frameCount = phraseAssemble(batch->index, job->words, job->wordCount, job->flags, frames, LPC_MAX_WORD_FRAMES);
+	if (frameCount >= 0) {
+		job->pcm = malloc(sizeof(speechPcm_t) + frameCount * lpcFrameSamples(&job->settings) * sizeof(int16_t));
+		if (job->pcm) {
+			job->pcm->references = 1;
+			job->pcm->sampleCount = lpcRender(&job->settings, frames, frameCount, job->pcm->samples);
+		}
+	}
+	free(frames);
+}
+
+// Render the queued requests together and queue the replies
+static void renderBatch(speechServer_t *server)
+{
+	speechBatch_t batch = { server->index, server->cache, server->jobs };
+	
+	// Identical phrases share one rendering
+	for (int i = 0; i < server->jobCount; i++) {
+		server->jobs[i].renderedBy = i;
+		for (int j = 0; j < i; j++) {
+			if (server->jobs[j].renderedBy == j && sameRequest(&server->jobs[i], &server->jobs[j])) {
+				server->jobs[i].renderedBy = j;
+				server->stats.coalesced++;
+				break;
+			}
+		}
+	}
+	
+	threadPoolParallelFor(server->pool, server->jobCount, renderJob, &batch);
+	
+	for (int i = 0; i < server->jobCount; i++) {
+		speechJob_t *job = &server->jobs[i];
+		speechJob_t *rendered = &server->jobs[job->renderedBy];
+		speechClient_t *client = job->client;
+		char header[64];
+		
+		// The client may have gone (and its slot been reused) meanwhile
+		if (client->fd < 0 || client->generation != job->generation) continue;
+		client->busy = 0;
+		
+		if (rendered->pcm == NULL) {
+			replyText(server, client, "ERR phrase too long\n");
+		} else if (client->ring.shared) {
+			// Only the header goes over the socket; the PCM follows
+			// through the ring as the client makes room
+			snprintf(header, sizeof(header), "RING %d %d\n", rendered->pcm->sampleCount, LPC_SAMPLE_RATE);
+			replyText(server, client, header);
+			if (client->fd < 0) continue;
+			client->delivery = rendered->pcm;
+			client->delivery->references++;
+			client->delivered = 0;
+			client->deliveryReceived = job->received;
+			client->busy = 1;
+			continue;
+		} else {
+			// The PCM follows the header as the client reads it
+			snprintf(header, sizeof(header), "PCM %d %d\n", rendered->pcm->sampleCount, LPC_SAMPLE_RATE);
+			client->reply = rendered->pcm;
+			client->reply->references++;
+			client->replySent = 0;
+			client->replyReceived = job->received;
+			client->busy = 1;
+			replyText(server, client, header);
+			continue;
+		}
+		latencyRecord(server->latency, now() - job->received);
+	}
+	
+	for (int i = 0; i < server->jobCount; i++) {
+		if (server->jobs[i].renderedBy == i) releasePcm(server->jobs[i].pcm);
+	}
+	server->stats.requests += server->jobCount;
+	server->stats.batches++;
+	server->jobCount = 0;
+	
+	// Requests that arrived behind a SAY can go now
+	for (int i = 0; i < SPEECHD_MAX_CLIENTS; i++) takeLines(server, &server->clients[i]);
+}
+
+// Move PCM into the rings of clients with deliveries outstanding;
+// returns TRUE if any are still waiting for ring space
+static int deliverRings(speechServer_t *server)
+{
+	int waiting = 0;
+	
+	for (int i = 0; i < SPEECHD_MAX_CLIENTS; i++) {
+		speechClient_t *client = &server->clients[i];
+		if (client->delivery == NULL) continue;
+		
+		int written = pcmRingWrite(&client->ring, client->delivery->samples + client->delivered,
+			client->delivery->sampleCount - client->delivered);
+		if (written < 0) {
+			closeClient(client);
+			continue;
+		}
+		client->delivered += written;
+		
+		if (client->delivered == (uint32_t)client->delivery->sampleCount) {
+			latencyRecord(server->latency, now() - client->deliveryReceived);
+			releasePcm(client->delivery);
+			client->delivery = NULL;
+			client->busy = 0;
+			takeLines(server, client);
+		} else {
+			waiting = 1;
+		}
+	}
+	
+	return waiting;
+}
+
+// Receive request bytes and any descriptor passed with them
+static ssize_t receiveRequest(speechClient_t *client)
+{
+	union {
+		struct cmsghdr header;
+		char buffer[CMSG_SPACE(sizeof(int))];
+	} control;
+	struct iovec vector = { client->input + client->inputLength, SPEECHD_MAX_LINE - client->inputLength };
+	struct msghdr message;
+	
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = &vector;
+	message.msg_iovlen = 1;
+	message.msg_control = control.buffer;
+	message.msg_controllen = sizeof(control.buffer);
+	
+	ssize_t length = recvmsg(client->fd, &message, MSG_CMSG_CLOEXEC);
+	for (struct cmsghdr *header = CMSG_FIRSTHDR(&message); length >= 0 && header; header = CMSG_NXTHDR(&message, header)) {
+		if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+			if (client->passedFd >= 0) close(client->passedFd);
+			memcpy(&client->passedFd, CMSG_DATA(header), sizeof(int));
+		}
+	}
+	return length;
+}
+
+static int openListener(const char *socketPath)
+{
+	struct sockaddr_un address;
+	if (strlen(socketPath) >= sizeof(address.sun_path)) return -1;
+	
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener < 0) return -1;
+	
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, socketPath);
+	unlink(socketPath);
+	
+	if (bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 64) != 0) {
+		close(listener);
+		return -1;
+	}
+	return listener;
+}
+
+// Serve an image on a Unix socket
+int speechServe(const phromImage_t *image, const char *socketPath, threadPool_t *pool,
+	const speechServeOptions_t *options, speechServeStats_t *stats)
+{
+	phraseIndex_t index;
+	if (phraseIndexBuild(&index, image, options->chip) != 0) return -1;
+	
+	speechServer_t *server = calloc(1, sizeof(speechServer_t));
+	if (server) {
+		server->jobs = malloc(options->maxBatch * sizeof(speechJob_t));
+		server->latency = malloc(sizeof(latencyRecorder_t));
+		server->cache = pcmCacheCreate(options->cacheBytes);
+	}
+	if (server == NULL || server->jobs == NULL || server->latency == NULL || server->cache == NULL ||
+		options->maxBatch < 1 || (server->listener = openListener(socketPath)) < 0) {
+		if (server) {
+			free(server->jobs);
+			free(server->latency);
+			pcmCacheDestroy(server->cache);
+		}
+		free(server);
+		phraseIndexFree(&index);
+		return -1;
+	}
+	
+	server->index = &index;
+	server->pool = pool;
+	server->options = *options;
+	latencyReset(server->latency);
+	for (int i = 0; i < SPEECHD_MAX_CLIENTS; i++) {
+		server->clients[i].fd = -1;
+		server->clients[i].passedFd = -1;
+	}
+	
+	stopRequested = 0;
+	signal(SIGINT, stopSignal);
+	signal(SIGTERM, stopSignal);
+	
+	double batchStart = 0;
+	while (!stopRequested && !server->stopping) {
+		struct pollfd fds[SPEECHD_MAX_CLIENTS + 1];
+		speechClient_t *polled[SPEECHD_MAX_CLIENTS + 1];
+		int fdCount = 0;
+		
+		fds[fdCount].fd = server->listener;
+		fds[fdCount].events = POLLIN;
+		polled[fdCount++] = NULL;
+		for (int i = 0; i < SPEECHD_MAX_CLIENTS; i++) {
+			speechClient_t *client = &server->clients[i];
+			// Busy clients are still polled so hang-ups are noticed
+			short events = (client->inputLength < SPEECHD_MAX_LINE ? POLLIN : 0) |
+				(client->outputLength || client->reply ? POLLOUT : 0);
+			if (client->fd < 0 || events == 0) continue;
+			fds[fdCount].fd = client->fd;
+			fds[fdCount].events = events;
+			polled[fdCount++] = client;
+		}
+		
+		// With a batch open, wait only until its window closes; with ring
+		// deliveries stalled, check again for space shortly
+		int queued = server->jobCount;
+		int timeout = deliverRings(server) ? 1 : 500;
+		if (queued == 0 && server->jobCount) batchStart = now();
+		if (server->jobCount) {
+			double remaining = server->options.batchWindow - (now() - batchStart);
+			timeout = remaining > 0 ? (int)((remaining + 999) / 1000) : 0;
+		}
+		
+		if (poll(fds, fdCount, timeout) < 0 && errno != EINTR) break;
+		
+		if (fds[0].revents & POLLIN) {
+			int fd = accept(server->listener, NULL, NULL);
+			int slot = 0;
+			while (slot < SPEECHD_MAX_CLIENTS && server->clients[slot].fd >= 0) slot++;
+			// Replies are sent without blocking so one slow reader cannot
+			// stall the others
+			if (fd >= 0 && (slot == SPEECHD_MAX_CLIENTS || fcntl(fd, F_SETFL, O_NONBLOCK) != 0)) close(fd);
+			else if (fd >= 0) server->clients[slot].fd = fd;
+		}
+		
+		for (int i = 1; i < fdCount; i++) {
+			speechClient_t *client = polled[i];
+			int queued = server->jobCount;
+			
+			if (fds[i].revents & POLLOUT) flushClient(server, client);
+			
+			if (client->fd >= 0 && (fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+				ssize_t length = receiveRequest(client);
+				if (length > 0) {
+					client->inputLength += length;
+				} else if (length == 0 || (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)) {
+					closeClient(client);
+					continue;
+				}
+			}
+			
+			// Requests held back behind an unsent reply can go once it has
+			takeLines(server, client);
+			if (queued == 0 && server->jobCount) batchStart = now();
+		}
+		
+		// The window also closes once every connected client is waiting,
+		// as nobody is left to join the batch
+		int connected = 0;
+		for (int i = 0; i < SPEECHD_MAX_CLIENTS; i++)
+			connected += server->clients[i].fd >= 0 && server->clients[i].delivery == NULL && server->clients[i].reply == NULL;
+		
+		if (server->jobCount && (server->jobCount >= server->options.maxBatch ||
+			server->jobCount >= connected || now() - batchStart >= server->options.batchWindow)) {
+			renderBatch(server);
+			if (server->jobCount) batchStart = now();
+		}
+	}
+	
+	// Queued replies get one last chance to go
+	if (server->jobCount) renderBatch(server);
+	for (int i = 0; i < SPEECHD_MAX_CLIENTS; i++) flushClient(server, &server->clients[i]);
+	
+	server->stats.p50 = latencyPercentile(server->latency, 50);
+	server->stats.p99 = latencyPercentile(server->latency, 99);
+	pcmCacheGetStats(server->cache, &server->stats.cache);
+	*stats = server->stats;
+	
+	for (int i = 0; i < SPEECHD_MAX_CLIENTS; i++) closeClient(&server->clients[i]);
+	close(server->listener);
+	unlink(socketPath);
+	free(server->jobs);
+	free(server->latency);
+	pcmCacheDestroy(server->cache);
+	free(server);
+	phraseIndexFree(&index);
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+	return 0;
+}
+
+int speechConnect(const char *socketPath)
+{
+	struct sockaddr_un address;
+	if (strlen(socketPath) >= sizeof(address.sun_path)) return -1;
+	
+	int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (connection < 0) return -1;
+	
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, socketPath);
+	if (connect(connection, (struct sockaddr *)&address, sizeof(address)) != 0) {
+		close(connection);
+		return -1;
+	}
+	return connection;
+}
+
+static int receiveAll(int fd, void *data, size_t length)
+{
+	uint8_t *bytes = data;
+	while (length > 0) {
+		ssize_t received = recv(fd, bytes, length, 0);
+		if (received < 0 && errno == EINTR) continue;
+		if (received <= 0) return -1;
+		bytes += received;
+		length -= received;
+	}
+	return 0;
+}
+
+// Read a reply line (a byte at a time, so no PCM is consumed with it)
+static int receiveLine(int fd, char *line, int size)
+{
+	int length = 0;
+	while (length < size - 1) {
+		if (receiveAll(fd, &line[length], 1) != 0) return -1;
+		if (line[length] == '\n') break;
+		length++;
+	}
+	line[length] = '\0';
+	return length;
+}
+
+// Send a request and read its one-line reply
+int speechCommand(int connection, const char *request, char *reply, int replySize)
+{
+	if (sendAll(connection, request, strlen(request)) != 0 || sendAll(connection, "\n", 1) != 0) return -1;
+	return receiveLine(connection, reply, replySize) < 0 ? -1 : 0;
+}
+
+// Send a SAY request and read the PCM
+int speechSay(int connection, const char *request, int16_t **samples, uint32_t *rate, char *reply, int replySize)
+{
+	int sampleCount;
+	
+	*samples = NULL;
+	if (speechCommand(connection, request, reply, replySize) != 0) return -1;
+	if (sscanf(reply, "PCM %d %u", &sampleCount, rate) != 2 || sampleCount < 0) return -1;
+	
+	*samples = malloc(sampleCount * sizeof(int16_t) + 1);
+	if (*samples == NULL || receiveAll(connection, *samples, sampleCount * sizeof(int16_t)) != 0) {
+		free(*samples);
+		*samples = NULL;
+		return -1;
+	}
+	return sampleCount;
+}
+
+// Create a ring and hand it to the daemon; SAY replies then arrive
+// through it
+int speechAttachRing(int connection, uint32_t capacity, pcmRing_t *ring, char *reply, int replySize)
+{
+	union {
+		struct cmsghdr header;
+		char buffer[CMSG_SPACE(sizeof(int))];
+	} control;
+	char request[] = "RING\n";
+	struct iovec vector = { request, sizeof(request) - 1 };
+	struct msghdr message;
+	
+	if (pcmRingCreate(capacity, ring) != 0) {
+		snprintf(reply, replySize, "ERR cannot create shared memory");
+		return -1;
+	}
+	
+	memset(&message, 0, sizeof(message));
+	memset(&control, 0, sizeof(control));
+	message.msg_iov = &vector;
+	message.msg_iovlen = 1;
+	message.msg_control = control.buffer;
+	message.msg_controllen = sizeof(control.buffer);
+	struct cmsghdr *header = CMSG_FIRSTHDR(&message);
+	header->cmsg_level = SOL_SOCKET;
+	header->cmsg_type = SCM_RIGHTS;
+	header->cmsg_len = CMSG_LEN(sizeof(int));
+	memcpy(CMSG_DATA(header), &ring->fd, sizeof(int));
+	
+	ssize_t sent;
+	do sent = sendmsg(connection, &message, MSG_NOSIGNAL);
+	while (sent < 0 && errno == EINTR);
+	
+	if (sent != (ssize_t)vector.iov_len || receiveLine(connection, reply, replySize) < 0 || strcmp(reply, "OK") != 0) {
+		pcmRingClose(ring);
+		return -1;
+	}
+	return 0;
+}
+
+// Send a SAY request and collect the PCM from the ring
+int speechSayRing(int connection, const char *request, pcmRing_t *ring, int16_t **samples, uint32_t *rate,
+	char *reply, int replySize)
+{
+	int sampleCount;
+	
+	*samples = NULL;
+	if (speechCommand(connection, request, reply, replySize) != 0) return -1;
+	if (sscanf(reply, "RING %d %u", &sampleCount, rate) != 2 || sampleCount < 0) return -1;
+	
+	*samples = malloc(sampleCount * sizeof(int16_t) + 1);
+	if (*samples == NULL) return -1;
+	
+	// Spin briefly, then back off, while the daemon fills the ring; when
+	// backing off, check the daemon is still there
+	int idle = 0, hungUp = 0;
+	for (int received = 0; received < sampleCount;) {
+		uint32_t count = pcmRingRead(ring, *samples + received, sampleCount - received);
+		received += count;
+		if (count) {
+			idle = 0;
+		} else if (hungUp) {
+			// Nothing more arrived before it went
+			free(*samples);
+			*samples = NULL;
+			snprintf(reply, replySize, "ERR daemon went away");
+			return -1;
+		} else if (++idle > 64) {
+			struct pollfd fd = { connection, POLLIN, 0 };
+			char byte;
+			if (poll(&fd, 1, 0) > 0 && ((fd.revents & (POLLHUP | POLLERR)) ||
+				recv(connection, &byte, 1, MSG_PEEK | MSG_DONTWAIT) == 0)) {
+				// Drain whatever it wrote before going
+				hungUp = 1;
+				continue;
+			}
+			struct timespec pause = { 0, 20000 };
+			nanosleep(&pause, NULL);
+		}
+	}
+	return sampleCount;
+}
@@ -0,0 +1,98 @@
+/************************************************************************
+	speechd.h
+
+    Speech daemon serving rendered phrases over a Unix socket
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef SPEECHD_H_
+#define SPEECHD_H_
+
+#include <stdint.h>
+
+#include "pcmcache.h"
+#include "pcmring.h"
+#include "phromimage.h"
+#include "threadpool.h"
+
+// Protocol (one request per line; replies in request order per client):
+//
+//   SAY [--smooth] [--speed <x>] [--pitch <n>]
+//       [--pitch-scale <x>] <word>...	Words are numbers, 0x addresses
+//										or text, as for 'phromtool phrase';
+//										speed and pitch scale are 0.5 to 2
+//										and pitch offset -63 to 63
+//     -> "PCM <samples> <rate>\n" followed by the 16-bit host order PCM
+//   STATS
+//     -> "STATS requests <n> batches <n> coalesced <n> p50 <us> p99 <us>
+//         hitrate <percent> cached <bytes> entries <n>\n" (on one line;
+//        the last three describe the word PCM cache)
+//   RING								With a shared memory descriptor
+//										attached (SCM_RIGHTS)
+//     -> "OK\n"; later SAY replies are "RING <samples> <rate>\n" and the
+//        PCM is written into the client's pcmRing_t instead of the socket
+//   SHUTDOWN							Stop the daemon
+//
+// Failures reply "ERR <reason>\n".  SAY requests arriving within the batch
+// window are rendered together on the thread pool; identical phrases in a
+// batch are rendered once.  Words are rendered through a PCM cache, so a
+// phrase of words already spoken is only copied (--smooth phrases join
+// their words' frames and always go through the synthesiser).
+
+#define SPEECHD_MAX_CLIENTS	64
+#define SPEECHD_MAX_LINE	4096
+#define SPEECHD_MAX_WORDS	256
+
+typedef struct {
+	int batchWindow;		// Microseconds to wait for a batch to fill
+	int maxBatch;			// Requests that end the window early
+	int chip;				// LPC_CHIP_ variant every request is spoken as
+	size_t cacheBytes;		// PCM the word cache may hold
+} speechServeOptions_t;
+
+typedef struct {
+	uint64_t requests;
+	uint64_t batches;
+	uint64_t coalesced;		// Requests served by another's rendering
+	double p50, p99;		// SAY latency in microseconds (receipt to reply sent)
+	pcmCacheStats_t cache;
+} speechServeStats_t;
+
+// Serve an image on a Unix socket until SHUTDOWN, SIGINT or SIGTERM.
+// Returns 0 on a clean shutdown or -1 if the socket cannot be set up.
+int speechServe(const phromImage_t *image, const char *socketPath, threadPool_t *pool,
+	const speechServeOptions_t *options, speechServeStats_t *stats);
+
+// Client side: connect, send one request line and read the reply.
+// speechSay() returns the sample count (setting *samples to a malloc'd
+// buffer and *rate) or -1 with the error in reply.
+int speechConnect(const char *socketPath);
+int speechSay(int connection, const char *request, int16_t **samples, uint32_t *rate, char *reply, int replySize);
+int speechCommand(int connection, const char *request, char *reply, int replySize);
+
+// Client side shared memory transport: create a ring of at least capacity
+// samples and pass it to the daemon, then make SAY requests through it
+int speechAttachRing(int connection, uint32_t capacity, pcmRing_t *ring, char *reply, int replySize);
+int speechSayRing(int connection, const char *request, pcmRing_t *ring, int16_t **samples, uint32_t *rate,
+	char *reply, int replySize);
+
+#endif /* SPEECHD_H_ */
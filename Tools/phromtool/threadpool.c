@@ -0,0 +1,336 @@
+/************************************************************************
+	threadpool.c
+
+    Work-stealing thread pool
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "threadpool.h"
+
+typedef struct {
+	threadPoolTask_t task;
+	void *argument;
+} threadPoolEntry_t;
+
+// A worker's deque (a growable ring; the owner uses the tail, thieves the head)
+typedef struct {
+	pthread_mutex_t lock;
+	threadPoolEntry_t *entries;
+	uint32_t capacity;		// Always a power of 2
+	uint32_t head, tail;
+} threadPoolDeque_t;
+
+struct threadPool {
+	int workerCount;
+	pthread_t *threads;
+	threadPoolDeque_t *deques;
+	
+	// Sleeping workers and waiters use a single lock and condition pair;
+	// it is only taken when a worker runs dry or a task count hits zero
+	pthread_mutex_t lock;
+	pthread_cond_t workAvailable;
+	pthread_cond_t allDone;
+	long queued;			// Tasks sitting in deques
+	long outstanding;		// Tasks submitted but not yet finished
+	uint32_t nextDeque;
+	int stopping;
+};
+
+// The worker (deque index) the calling thread belongs to, or -1
+static __thread int currentWorker = -1;
+static __thread threadPool_t *currentPool = NULL;
+
+// Returns 0 if the deque is full and cannot grow
+static int dequePush(threadPoolDeque_t *deque, threadPoolEntry_t entry)
+{
+	pthread_mutex_lock(&deque->lock);
+	
+	if (deque->tail - deque->head == deque->capacity) {
+		// Grow the ring, unwrapping the entries into the new storage
+		uint32_t capacity = deque->capacity * 2;
+		threadPoolEntry_t *entries = malloc(capacity * sizeof(threadPoolEntry_t));
+		if (entries == NULL) {
+			pthread_mutex_unlock(&deque->lock);
+			return 0;
+		}
+		for (uint32_t i = deque->head; i != deque->tail; i++)
+			entries[i & (capacity - 1)] = deque->entries[i & (deque->capacity - 1)];
+		free(deque->entries);
+		deque->entries = entries;
+		deque->capacity = capacity;
+	}
+	
+	deque->entries[deque->tail++ & (deque->capacity - 1)] = entry;
+	pthread_mutex_unlock(&deque->lock);
+	return 1;
+}
+
+// Take from the owner's end (newest first, for cache locality)
+static int dequePop(threadPoolDeque_t *deque, threadPoolEntry_t *entry)
+{
+	int found = 0;
+	
+	pthread_mutex_lock(&deque->lock);
+	if (deque->tail != deque->head) {
+		*entry = deque->entries[--deque->tail & (deque->capacity - 1)];
+		found = 1;
+	}
+	pthread_mutex_unlock(&deque->lock);
+	
+	return found;
+}
+
+// Take from the thief's end (oldest first)
+static int dequeSteal(threadPoolDeque_t *deque, threadPoolEntry_t *entry)
+{
+	int found = 0;
+	
+	// Don't queue behind the owner; try another victim instead
+	if (pthread_mutex_trylock(&deque->lock) != 0) return 0;
+	if (deque->tail != deque->head) {
+		*entry = deque->entries[deque->head++ & (deque->capacity - 1)];
+		found = 1;
+	}
+	pthread_mutex_unlock(&deque->lock);
+	
+	return found;
+}
+
+// Find a task for a worker: its own deque first, then the others
+static int findTask(threadPool_t *pool, int worker, threadPoolEntry_t *entry)
+{
+	if (dequePop(&pool->deques[worker], entry)) return 1;
+	
+	for (int i = 1; i < pool->workerCount; i++) {
+		if (dequeSteal(&pool->deques[(worker + i) % pool->workerCount], entry)) return 1;
+	}
+	
+	return 0;
+}
+
+static void runTask(threadPool_t *pool, threadPoolEntry_t *entry)
+{
+	pthread_mutex_lock(&pool->lock);
+	pool->queued--;
+	pthread_mutex_unlock(&pool->lock);
+	
+	entry->task(entry->argument);
+	
+	pthread_mutex_lock(&pool->lock);
+	if (--pool->outstanding == 0) pthread_cond_broadcast(&pool->allDone);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+static void *workerThread(void *argument)
+{
+	threadPool_t *pool = currentPool = argument;
+	threadPoolEntry_t entry;
+	
+	// Claim a deque index
+	pthread_mutex_lock(&pool->lock);
+	currentWorker = pool->nextDeque++;
+	pthread_mutex_unlock(&pool->lock);
+	
+	while (1) {
+		if (findTask(pool, currentWorker, &entry)) {
+			runTask(pool, &entry);
+			continue;
+		}
+		
+		// Nothing to do; sleep until something is queued
+		pthread_mutex_lock(&pool->lock);
+		while (pool->queued == 0 && !pool->stopping) pthread_cond_wait(&pool->workAvailable, &pool->lock);
+		int stopping = pool->stopping && pool->queued == 0;
+		pthread_mutex_unlock(&pool->lock);
+		
+		if (stopping) break;
+	}
+	
+	return NULL;
+}
+
+// Stop and join the first started workers, then free the pool
+static void freePool(threadPool_t *pool, int started)
+{
+	pthread_mutex_lock(&pool->lock);
+	pool->stopping = 1;
+	pthread_cond_broadcast(&pool->workAvailable);
+	pthread_mutex_unlock(&pool->lock);
+	
+	for (int i = 0; i < started; i++) pthread_join(pool->threads[i], NULL);
+	for (int i = 0; pool->deques && i < pool->workerCount; i++) {
+		pthread_mutex_destroy(&pool->deques[i].lock);
+		free(pool->deques[i].entries);
+	}
+	
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->workAvailable);
+	pthread_cond_destroy(&pool->allDone);
+	free(pool->threads);
+	free(pool->deques);
+	free(pool);
+}
+
+// Create a pool of workers (0 selects one per online CPU); returns NULL if
+// memory or threads run out
+threadPool_t *threadPoolCreate(int workers)
+{
+	if (workers <= 0) workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (workers <= 0) workers = 1;
+	
+	threadPool_t *pool = calloc(1, sizeof(threadPool_t));
+	if (pool == NULL) return NULL;
+	
+	pool->workerCount = workers;
+	pool->threads = calloc(workers, sizeof(pthread_t));
+	pool->deques = calloc(workers, sizeof(threadPoolDeque_t));
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->workAvailable, NULL);
+	pthread_cond_init(&pool->allDone, NULL);
+	if (pool->threads == NULL || pool->deques == NULL) {
+		free(pool->deques);
+		pool->deques = NULL;
+		freePool(pool, 0);
+		return NULL;
+	}
+	
+	int ready = 1;
+	for (int i = 0; i < workers; i++) {
+		pthread_mutex_init(&pool->deques[i].lock, NULL);
+		pool->deques[i].capacity = 64;
+		pool->deques[i].entries = malloc(64 * sizeof(threadPoolEntry_t));
+		if (pool->deques[i].entries == NULL) ready = 0;
+	}
+	if (!ready) {
+		freePool(pool, 0);
+		return NULL;
+	}
+	
+	// Deques are claimed by the workers as they start; the counter is then
+	// reused to deal out external submissions
+	for (int i = 0; i < workers; i++) {
+		if (pthread_create(&pool->threads[i], NULL, workerThread, pool) != 0) {
+			freePool(pool, i);
+			return NULL;
+		}
+	}
+	
+	pthread_mutex_lock(&pool->lock);
+	while (pool->nextDeque < (uint32_t)workers) {
+		pthread_mutex_unlock(&pool->lock);
+		sched_yield();
+		pthread_mutex_lock(&pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	
+	return pool;
+}
+
+void threadPoolDestroy(threadPool_t *pool)
+{
+	if (pool == NULL) return;
+	
+	threadPoolWait(pool);
+	freePool(pool, pool->workerCount);
+}
+
+int threadPoolWorkers(const threadPool_t *pool)
+{
+	return pool->workerCount;
+}
+
+// Queue a task
+void threadPoolSubmit(threadPool_t *pool, threadPoolTask_t task, void *argument)
+{
+	threadPoolEntry_t entry = { task, argument };
+	uint32_t deque;
+	
+	pthread_mutex_lock(&pool->lock);
+	pool->queued++;
+	pool->outstanding++;
+	
+	// Workers push to their own deque, everyone else deals round-robin
+	if (currentPool == pool) deque = currentWorker;
+	else deque = pool->nextDeque++ % pool->workerCount;
+	pthread_mutex_unlock(&pool->lock);
+	
+	// If the deque cannot grow the task runs here instead
+	if (!dequePush(&pool->deques[deque], entry)) {
+		runTask(pool, &entry);
+		return;
+	}
+	
+	pthread_mutex_lock(&pool->lock);
+	pthread_cond_signal(&pool->workAvailable);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+// Wait until every submitted task has finished
+void threadPoolWait(threadPool_t *pool)
+{
+	pthread_mutex_lock(&pool->lock);
+	while (pool->outstanding != 0) pthread_cond_wait(&pool->allDone, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+// Parallel for: the range is cut into a few chunks per worker so stealing
+// can even out uneven item costs
+typedef struct {
+	threadPoolIndexTask_t task;
+	void *argument;
+	int first, last;
+} threadPoolRange_t;
+
+static void runRange(void *argument)
+{
+	threadPoolRange_t *range = argument;
+	for (int i = range->first; i < range->last; i++) range->task(i, range->argument);
+}
+
+void threadPoolParallelFor(threadPool_t *pool, int count, threadPoolIndexTask_t task, void *argument)
+{
+	int chunks = pool->workerCount * 4;
+	if (chunks > count) chunks = count;
+	if (chunks <= 0) return;
+	
+	threadPoolRange_t *ranges = malloc(chunks * sizeof(threadPoolRange_t));
+	if (ranges == NULL) {
+		// Out of memory: run the range here
+		for (int i = 0; i < count; i++) task(i, argument);
+		return;
+	}
+	for (int i = 0; i < chunks; i++) {
+		ranges[i].task = task;
+		ranges[i].argument = argument;
+		ranges[i].first = (int)((long)count * i / chunks);
+		ranges[i].last = (int)((long)count * (i + 1) / chunks);
+		threadPoolSubmit(pool, runRange, &ranges[i]);
+	}
+	
+	threadPoolWait(pool);
+	free(ranges);
+}
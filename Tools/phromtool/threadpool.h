@@ -0,0 +1,57 @@
+/************************************************************************
+	threadpool.h
+
+    Work-stealing thread pool
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <stdint.h>
+
+// Each worker owns a deque of tasks; it takes work from its own end and,
+// when empty, steals from the other end of another worker's deque.  Tasks
+// submitted from outside the pool are dealt round-robin across the deques.
+
+typedef void (*threadPoolTask_t)(void *argument);
+typedef void (*threadPoolIndexTask_t)(int index, void *argument);
+
+typedef struct threadPool threadPool_t;
+
+// Create a pool of workers (0 selects one per online CPU)
+threadPool_t *threadPoolCreate(int workers);
+void threadPoolDestroy(threadPool_t *pool);
+
+int threadPoolWorkers(const threadPool_t *pool);
+
+// Queue a task (tasks may themselves submit further tasks)
+void threadPoolSubmit(threadPool_t *pool, threadPoolTask_t task, void *argument);
+
+// Wait until every submitted task has finished (not callable from a task)
+void threadPoolWait(threadPool_t *pool);
+
+// Run task(index, argument) for index 0 to count-1 and wait for them
+// (not callable from a task)
+void threadPoolParallelFor(threadPool_t *pool, int count, threadPoolIndexTask_t task, void *argument);
+
+#endif /* THREADPOOL_H_ */
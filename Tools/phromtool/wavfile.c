@@ -0,0 +1,191 @@
+/************************************************************************
+	wavfile.c
+
+    WAV file output
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "wavfile.h"
+
+#define WAV_HEADER_SIZE	44
+
+// Store little-endian values into the header
+static void put16(uint8_t *buffer, uint16_t value)
+{
+	buffer[0] = value & 0xFF;
+	buffer[1] = value >> 8;
+}
+
+static void put32(uint8_t *buffer, uint32_t value)
+{
+	put16(buffer, value & 0xFFFF);
+	put16(buffer + 2, value >> 16);
+}
+
+// Build the RIFF header for dataBytes of 16-bit mono audio
+static void buildHeader(uint8_t *header, uint32_t sampleRate, uint32_t dataBytes)
+{
+	memcpy(header, "RIFF", 4);
+	put32(header + 4, 36 + dataBytes);
+	memcpy(header + 8, "WAVEfmt ", 8);
+	put32(header + 16, 16);				// fmt chunk size
+	put16(header + 20, 1);				// PCM
+	put16(header + 22, 1);				// Mono
+	put32(header + 24, sampleRate);
+	put32(header + 28, sampleRate * 2);	// Byte rate
+	put16(header + 32, 2);				// Block align
+	put16(header + 34, 16);				// Bits per sample
+	memcpy(header + 36, "data", 4);
+	put32(header + 40, dataBytes);
+}
+
+FILE *wavOpen(const char *path, uint32_t sampleRate)
+{
+	uint8_t header[WAV_HEADER_SIZE];
+	FILE *file = fopen(path, "w+b");
+	if (file == NULL) return NULL;
+	
+	buildHeader(header, sampleRate, 0);
+	if (fwrite(header, 1, WAV_HEADER_SIZE, file) != WAV_HEADER_SIZE) {
+		fclose(file);
+		return NULL;
+	}
+	
+	return file;
+}
+
+int wavWrite(FILE *file, const int16_t *samples, uint32_t sampleCount)
+{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	for (uint32_t i = 0; i < sampleCount; i++) {
+		uint8_t bytes[2];
+		put16(bytes, (uint16_t)samples[i]);
+		if (fwrite(bytes, 1, 2, file) != 2) return -1;
+	}
+	return 0;
+#else
+	return (fwrite(samples, sizeof(int16_t), sampleCount, file) == sampleCount) ? 0 : -1;
+#endif
+}
+
+int wavClose(FILE *file)
+{
+	uint8_t header[WAV_HEADER_SIZE];
+	uint8_t rate[4];
+	long length = ftell(file);
+	int result = 0;
+	
+	// Recover the sample rate from the header written by wavOpen()
+	if (length < WAV_HEADER_SIZE || fseek(file, 24, SEEK_SET) != 0 || fread(rate, 1, 4, file) != 4) {
+		result = -1;
+	} else {
+		uint32_t sampleRate = rate[0] | (rate[1] << 8) | (rate[2] << 16) | ((uint32_t)rate[3] << 24);
+		buildHeader(header, sampleRate, (uint32_t)(length - WAV_HEADER_SIZE));
+		if (fseek(file, 0, SEEK_SET) != 0 || fwrite(header, 1, WAV_HEADER_SIZE, file) != WAV_HEADER_SIZE) result = -1;
+	}
+	
+	if (fclose(file) != 0) result = -1;
+	return result;
+}
+
+// Write a 16-bit mono PCM WAV file
+int wavWriteFile(const char *path, const int16_t *samples, uint32_t sampleCount, uint32_t sampleRate)
+{
+	FILE *file = wavOpen(path, sampleRate);
+	if (file == NULL) return -1;
+	
+	int result = wavWrite(file, samples, sampleCount);
+	if (wavClose(file) != 0) result = -1;
+	return result;
+}
+
+// Fetch little-endian values from a header
+static uint32_t get16(const uint8_t *buffer)
+{
+	return buffer[0] | (buffer[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *buffer)
+{
+	return get16(buffer) | (get16(buffer + 2) << 16);
+}
+
+// Read a PCM WAV file as 16-bit mono
+int wavReadFile(const char *path, int16_t **samples, uint32_t *sampleCount, uint32_t *sampleRate)
+{
+	uint8_t chunk[16];
+	uint32_t channels = 0, bits = 0;
+	FILE *file = fopen(path, "rb");
+	if (file == NULL) return -1;
+	
+	if (fread(chunk, 1, 12, file) != 12 || memcmp(chunk, "RIFF", 4) != 0 || memcmp(chunk + 8, "WAVE", 4) != 0) {
+		fclose(file);
+		return -1;
+	}
+	
+	// Walk the chunks up to the data (fmt must come first)
+	while (fread(chunk, 1, 8, file) == 8) {
+		uint32_t size = get32(chunk + 4);
+		
+		if (memcmp(chunk, "fmt ", 4) == 0) {
+			if (size < 16 || fread(chunk, 1, 16, file) != 16) break;
+			channels = get16(chunk + 2);
+			*sampleRate = get32(chunk + 4);
+			bits = get16(chunk + 14);
+			if (get16(chunk) != 1 || channels < 1 || channels > 2 || (bits != 8 && bits != 16)) break;
+			if (fseek(file, size - 16 + (size & 1), SEEK_CUR) != 0) break;
+		} else if (memcmp(chunk, "data", 4) == 0 && channels) {
+			uint32_t frameBytes = channels * bits / 8;
+			uint8_t *data = malloc(size ? size : 1);
+			*samples = malloc((size / frameBytes + 1) * sizeof(int16_t));
+			if (data == NULL || *samples == NULL) {
+				free(data);
+				free(*samples);
+				break;
+			}
+			
+			// A truncated data chunk (e.g. from an interrupted recording) is
+			// read as far as it goes
+			*sampleCount = fread(data, 1, size, file) / frameBytes;
+			for (uint32_t i = 0; i < *sampleCount; i++) {
+				int32_t sum = 0;
+				for (uint32_t c = 0; c < channels; c++) {
+					const uint8_t *sample = data + i * frameBytes + c * bits / 8;
+					sum += (bits == 8) ? (sample[0] - 128) * 256 : (int16_t)get16(sample);
+				}
+				(*samples)[i] = (int16_t)(sum / (int32_t)channels);
+			}
+			
+			free(data);
+			fclose(file);
+			return 0;
+		} else if (fseek(file, size + (size & 1), SEEK_CUR) != 0) {
+			break;
+		}
+	}
+	
+	fclose(file);
+	return -1;
+}
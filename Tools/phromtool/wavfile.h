@@ -0,0 +1,46 @@
+/************************************************************************
+	wavfile.h
+
+    WAV file output
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef WAVFILE_H_
+#define WAVFILE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Write a 16-bit mono PCM WAV file (returns 0 on success)
+int wavWriteFile(const char *path, const int16_t *samples, uint32_t sampleCount, uint32_t sampleRate);
+
+// Streamed writing: the header is written with a zero length and patched
+// by wavClose() once the number of samples is known
+FILE *wavOpen(const char *path, uint32_t sampleRate);
+int wavWrite(FILE *file, const int16_t *samples, uint32_t sampleCount);
+int wavClose(FILE *file);
+
+// Read a 16-bit or 8-bit PCM WAV file (stereo is mixed down to mono) into
+// a malloc()ed buffer (returns 0 on success)
+int wavReadFile(const char *path, int16_t **samples, uint32_t *sampleCount, uint32_t *sampleRate);
+
+#endif /* WAVFILE_H_ */
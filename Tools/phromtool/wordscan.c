@@ -0,0 +1,221 @@
+/************************************************************************
+	wordscan.c
+
+    Word boundary discovery in undocumented PHROM dumps
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+// A PHROM without documentation is just 16K of bits; almost any offset
+// decodes as *something* because the LPC stream re-synchronises quickly.
+// A candidate utterance start must:
+//
+// - Reach a stop frame within a sensible number of frames
+// - Not begin with a repeat frame (there is nothing to repeat)
+// - Be followed by 1s from the stop frame up to the byte boundary, which is
+//   how both shipped images pad their words
+//
+// That still leaves starts inside words (and inside the index bytes some
+// images keep between words) which re-synchronise to a real stop frame
+// after a few frames of junk.  Junk looks unlike speech - implausibly high
+// pitch and jumps in energy or pitch between neighbouring frames - so each
+// candidate gets a penalty counting those.
+//
+// The image is then segmented by dynamic programming: choose the set of
+// non-overlapping candidates that maximises the bytes covered less a cost
+// per penalty point and per word.  Real words tile the image with small
+// gaps, so they win over both junk prefixes and fragments.
+//
+// Every byte offset is checked in parallel, in batches written as separate
+// arrays; the segmentation is a single linear pass.
+
+#include <stdlib.h>
+
+#include "wordscan.h"
+#include "bitreader.h"
+#include "lpcdecode.h"
+#include "lpcframe.h"
+#include "lpctables.h"
+
+// Offsets checked per task
+#define WORDSCAN_BATCH	256
+
+// Segmentation costs (in bytes of coverage)
+#define WORDSCAN_PENALTY_COST	5
+#define WORDSCAN_WORD_COST		5
+
+// Thresholds for the speech-likeness penalty
+#define WORDSCAN_MIN_PITCH		8	// Pitch indexes below this are above 360Hz
+#define WORDSCAN_ENERGY_JUMP	5	// Energy index change between spoken frames
+#define WORDSCAN_PITCH_JUMP		12	// Pitch index change between voiced frames
+
+// Scan results held as one array per field
+typedef struct {
+	const uint8_t *image;
+	const lpcChip_t *chip;
+	uint32_t endBit[PHROM_SIZE];
+	uint16_t frameCount[PHROM_SIZE];
+	uint16_t penalty[PHROM_SIZE];
+} wordScanState_t;
+
+// Check a single candidate start; returns the frame count or 0
+static int scanCandidate(const lpcChip_t *chip, const uint8_t *image, uint32_t address, uint32_t *endBit, uint16_t *penalty)
+{
+	bitReader_t reader;
+	lpcFrame_t frame;
+	uint8_t previousK[10] = { 0 };
+	uint32_t bitLimit = PHROM_SIZE * 8;
+	int frameCount = 0;
+	int haveK = 0;
+	uint32_t previousEnergy = 0, previousPitch = 0;
+	
+	*penalty = 0;
+	
+	bitReaderInitialise(&reader, image, PHROM_SIZE, address * 8);
+	
+	while (frameCount < WORDSCAN_MAX_FRAMES) {
+		bitReaderEnsure(&reader, LPC_MAX_FRAME_BITS);
+		lpcDecodeFrame(chip, &reader, LPC_MAX_FRAME_BITS, previousK, &frame);
+		frameCount++;
+		
+		if (frame.type == LPC_FRAME_STOP) {
+			uint32_t position = bitReaderTell(&reader);
+			uint32_t padding = (8 - (position & 7)) & 7;
+			
+			if (position > bitLimit || frameCount < WORDSCAN_MIN_FRAMES) return 0;
+			
+			// The padding must be all 1s
+			if (padding) {
+				bitReaderEnsure(&reader, padding);
+				if (bitReaderPeek(&reader, padding) != (1U << padding) - 1) return 0;
+			}
+			
+			*endBit = position;
+			return frameCount;
+		}
+		
+		if (frame.type == LPC_FRAME_SILENT) {
+			previousEnergy = previousPitch = 0;
+			continue;
+		}
+		
+		// Score how unlike speech the frame is
+		uint32_t energy = frame.energy, pitch = frame.pitch;
+		if (pitch && pitch < WORDSCAN_MIN_PITCH) *penalty += 1;
+		if (previousEnergy && (uint32_t)abs((int)energy - (int)previousEnergy) > WORDSCAN_ENERGY_JUMP) *penalty += 1;
+		if (previousPitch && pitch && (uint32_t)abs((int)pitch - (int)previousPitch) > WORDSCAN_PITCH_JUMP) *penalty += 1;
+		previousEnergy = energy;
+		previousPitch = pitch;
+		
+		if (frame.repeat) {
+			if (!haveK) return 0;
+		} else {
+			haveK = 1;
+		}
+		
+		if (bitReaderTell(&reader) > bitLimit) return 0;
+	}
+	
+	return 0;
+}
+
+static void scanBatch(int batch, void *argument)
+{
+	wordScanState_t *state = argument;
+	int first = batch * WORDSCAN_BATCH;
+	
+	for (int address = first; address < first + WORDSCAN_BATCH; address++)
+		state->frameCount[address] = scanCandidate(state->chip, state->image, address,
+			&state->endBit[address], &state->penalty[address]);
+}
+
+// Scan every byte offset of an image for plausible utterances
+int wordScanImage(const uint8_t *image, int chip, threadPool_t *pool, wordScanResult_t *results, int maxResults)
+{
+	wordScanState_t *state = malloc(sizeof(wordScanState_t));
+	if (state == NULL) return -1;
+	state->image = image;
+	state->chip = lpcGetChip(chip) ? lpcGetChip(chip) : &lpcChipTms5220;
+	
+	threadPoolParallelFor(pool, PHROM_SIZE / WORDSCAN_BATCH, scanBatch, state);
+	
+	// best[i] is the best score for segmenting bytes 0 to i-1 and from[i]
+	// the start of the word ending there (or -1 if byte i-1 is a gap)
+	int32_t *best = malloc((PHROM_SIZE + 1) * sizeof(int32_t));
+	int16_t *from = malloc((PHROM_SIZE + 1) * sizeof(int16_t));
+	if (best == NULL || from == NULL) {
+		free(best); free(from); free(state);
+		return -1;
+	}
+	
+	for (int i = 0; i <= PHROM_SIZE; i++) {
+		best[i] = 0;
+		from[i] = -1;
+	}
+	
+	for (int address = 0; address < PHROM_SIZE; address++) {
+		// Leave this byte as a gap
+		if (best[address] > best[address + 1]) {
+			best[address + 1] = best[address];
+			from[address + 1] = -1;
+		}
+		
+		// Or take the candidate starting here
+		if (state->frameCount[address]) {
+			int end = (state->endBit[address] + 7) / 8;
+			int32_t score = best[address] + (end - address)
+				- WORDSCAN_PENALTY_COST * state->penalty[address] - WORDSCAN_WORD_COST;
+			if (score > best[end]) {
+				best[end] = score;
+				from[end] = address;
+			}
+		}
+	}
+	
+	// Walk back through the segmentation, then put the words in address order
+	int wordCount = 0;
+	for (int end = PHROM_SIZE; end > 0; ) {
+		if (from[end] < 0) {
+			end--;
+			continue;
+		}
+		
+		if (wordCount < maxResults) {
+			int address = from[end];
+			results[wordCount].address = address;
+			results[wordCount].endBit = state->endBit[address];
+			results[wordCount].frameCount = state->frameCount[address];
+			wordCount++;
+		}
+		end = from[end];
+	}
+	
+	for (int i = 0; i < wordCount / 2; i++) {
+		wordScanResult_t swap = results[i];
+		results[i] = results[wordCount - 1 - i];
+		results[wordCount - 1 - i] = swap;
+	}
+	
+	free(from);
+	free(best);
+	free(state);
+	return wordCount;
+}
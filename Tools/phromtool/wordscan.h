@@ -0,0 +1,51 @@
+/************************************************************************
+	wordscan.h
+
+    Word boundary discovery in undocumented PHROM dumps
+    Copyright (C) 2018 Simon Inns
+
+    This file is part of the TMS6100-Emulator.
+
+    The TMS6100-Emulator is free software: you can
+    redistribute it and/or modify it under the terms of the GNU
+    General Public License as published by the Free Software
+    Foundation, either version 3 of the License, or (at your
+    option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+    Email: simon.inns@gmail.com
+
+************************************************************************/
+
+#ifndef WORDSCAN_H_
+#define WORDSCAN_H_
+
+#include <stdint.h>
+
+#include "phromimage.h"
+#include "threadpool.h"
+
+// Limits on what is accepted as an utterance
+#define WORDSCAN_MIN_FRAMES		4
+#define WORDSCAN_MAX_FRAMES		400
+
+// A discovered utterance
+typedef struct {
+	uint16_t address;		// Start address
+	uint32_t endBit;		// Bit following the stop frame
+	uint16_t frameCount;
+} wordScanResult_t;
+
+// Scan every byte offset of an image for plausible utterances in a chip's
+// frame format and segment the image into words (in address order).
+// Returns the number of words found (up to maxResults) or -1 on failure.
+int wordScanImage(const uint8_t *image, int chip, threadPool_t *pool, wordScanResult_t *results, int maxResults);
+
+#endif /* WORDSCAN_H_ */